@@ -0,0 +1,425 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/frustum.h>
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// bounding volume hierarchy over the meshes of every object in the scene, in world space. an object is a list of
+// model space boxes (its meshes) under one transform. the tree is built with the surface area heuristic when the
+// meshes change (models streaming in) and only refit when transforms do: the leaves of moved objects get new world
+// boxes and every node is grown or shrunk around its children, keeping the topology. that is cheap but lets a tree
+// over a far travelling object degrade, which is fine for the freighter circling the station.
+class SceneBVH
+{
+public:
+    // nodes visited by the last Cull, and leaves it found visible
+    struct Stats
+    {
+        unsigned long nodesTested = 0;
+        unsigned long leavesVisible = 0;
+    };
+
+    uint32_t AddObject()
+    {
+        objects.push_back(Object());
+        rebuild = true;
+        return static_cast<uint32_t>(objects.size() - 1);
+    }
+
+    // replaces the meshes of an object, rebuilding the tree on the next Update
+    void SetBounds(uint32_t object, const std::vector<AABB> &bounds)
+    {
+        objects[object].bounds = bounds;
+        objects[object].visibility.assign(bounds.size(), 0);
+        rebuild = true;
+    }
+
+    size_t MeshCount(uint32_t object) const
+    {
+        return objects[object].bounds.size();
+    }
+
+    // moves an object; an unchanged transform costs nothing on the next Update
+    void SetTransform(uint32_t object, const glm::mat4 &transform)
+    {
+        Object &target = objects[object];
+        if (memcmp(&target.transform, &transform, sizeof(glm::mat4)) == 0)
+            return;
+        target.transform = transform;
+        target.moved = true;
+    }
+
+    // rebuilds the tree if meshes were added or removed, refits it if objects moved
+    void Update()
+    {
+        if (rebuild)
+            build();
+        else
+            refit();
+    }
+
+    // marks every mesh whose world box intersects the frustum visible (see Visibility). a node completely inside a
+    // plane is not tested against it again below, a node completely inside all of them accepts its whole subtree.
+    void Cull(const Frustum &frustum)
+    {
+        stats = Stats();
+        for (Object &object : objects)
+            std::fill(object.visibility.begin(), object.visibility.end(), 0);
+        if (!nodes.empty())
+            cullNode(0, frustum, (1u << 6) - 1);
+    }
+
+    // per mesh of the object, 1 if it passed the last Cull
+    const std::vector<uint8_t> &Visibility(uint32_t object) const
+    {
+        return objects[object].visibility;
+    }
+
+    // calls f(object, mesh) for every mesh whose world box intersects the sphere
+    template <typename F>
+    void QuerySphere(const glm::vec3 &center, float radius, F f) const
+    {
+        if (!nodes.empty())
+            querySphere(0, center, radius, f);
+    }
+
+    size_t NodeCount() const
+    {
+        return nodes.size();
+    }
+
+    const Stats &GetStats() const
+    {
+        return stats;
+    }
+
+private:
+    static const unsigned int MAX_LEAF_SIZE = 4;
+    static const unsigned int BINS = 12;
+
+    struct Object
+    {
+        std::vector<AABB> bounds;
+        std::vector<uint8_t> visibility;
+        glm::mat4 transform = glm::mat4(1.0f);
+        bool moved = true;
+    };
+
+    // a mesh with its world box
+    struct Leaf
+    {
+        glm::vec3 min, max;
+        uint32_t object;
+        uint32_t mesh;
+    };
+
+    // depth first: an interior node's left child follows it, right is the index of the other one. count > 0 marks
+    // a leaf node holding leaves[first, first + count).
+    struct Node
+    {
+        glm::vec3 min, max;
+        uint32_t first;
+        uint32_t right;
+        uint32_t count;
+    };
+
+    std::vector<Object> objects;
+    std::vector<Leaf> leaves;
+    std::vector<Node> nodes;
+    bool rebuild = true;
+    Stats stats;
+
+    // the box around a model space box moved by transform
+    static void transformBounds(const AABB &bounds, const glm::mat4 &transform, glm::vec3 &min, glm::vec3 &max)
+    {
+        glm::vec3 center = glm::vec3(transform * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+        glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+        glm::vec3 worldExtent(0.0f);
+        for (int row = 0; row < 3; row++)
+            for (int column = 0; column < 3; column++)
+                worldExtent[row] += std::fabs(transform[column][row]) * extent[column];
+        min = center - worldExtent;
+        max = center + worldExtent;
+    }
+
+    static float surfaceArea(const glm::vec3 &min, const glm::vec3 &max)
+    {
+        glm::vec3 size = max - min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    static bool sphereIntersects(const glm::vec3 &min, const glm::vec3 &max, const glm::vec3 &center, float radius)
+    {
+        glm::vec3 offset = center - glm::clamp(center, min, max);
+        return glm::dot(offset, offset) <= radius * radius;
+    }
+
+    void updateLeaf(Leaf &leaf)
+    {
+        const Object &object = objects[leaf.object];
+        transformBounds(object.bounds[leaf.mesh], object.transform, leaf.min, leaf.max);
+    }
+
+    void build()
+    {
+        leaves.clear();
+        nodes.clear();
+        for (uint32_t i = 0; i < objects.size(); i++)
+        {
+            for (uint32_t mesh = 0; mesh < objects[i].bounds.size(); mesh++)
+            {
+                Leaf leaf;
+                leaf.object = i;
+                leaf.mesh = mesh;
+                updateLeaf(leaf);
+                leaves.push_back(leaf);
+            }
+            objects[i].moved = false;
+        }
+        rebuild = false;
+        if (leaves.empty())
+            return;
+        nodes.reserve(2 * leaves.size());
+        buildNode(0, static_cast<uint32_t>(leaves.size()));
+    }
+
+    // builds the node over leaves[first, last) and returns its index
+    uint32_t buildNode(uint32_t first, uint32_t last)
+    {
+        uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node());
+        Node node;
+        node.min = leaves[first].min;
+        node.max = leaves[first].max;
+        glm::vec3 centroidMin = (leaves[first].min + leaves[first].max) * 0.5f;
+        glm::vec3 centroidMax = centroidMin;
+        for (uint32_t i = first; i < last; i++)
+        {
+            node.min = glm::min(node.min, leaves[i].min);
+            node.max = glm::max(node.max, leaves[i].max);
+            glm::vec3 centroid = (leaves[i].min + leaves[i].max) * 0.5f;
+            centroidMin = glm::min(centroidMin, centroid);
+            centroidMax = glm::max(centroidMax, centroid);
+        }
+        node.first = first;
+        node.count = last - first;
+        node.right = 0;
+
+        uint32_t split = last - first > MAX_LEAF_SIZE ? findSplit(first, last, node, centroidMin, centroidMax) : first;
+        if (split == first)
+        {
+            nodes[index] = node;
+            return index;
+        }
+        node.count = 0;
+        nodes[index] = node;
+        buildNode(first, split);
+        uint32_t right = buildNode(split, last);
+        nodes[index].right = right;
+        return index;
+    }
+
+    // binned SAH along the axis the centroids spread most on. partitions the leaves and returns the first leaf of
+    // the right half, or first if no split is cheaper than a leaf node (large groups are split at the median anyway)
+    uint32_t findSplit(uint32_t first, uint32_t last, const Node &node, const glm::vec3 &centroidMin,
+                       const glm::vec3 &centroidMax)
+    {
+        glm::vec3 spread = centroidMax - centroidMin;
+        int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+        uint32_t count = last - first;
+        if (!(spread[axis] > 0.0f))
+            return count > 4 * MAX_LEAF_SIZE ? first + count / 2 : first;
+
+        struct Bin
+        {
+            glm::vec3 min = glm::vec3(INFINITY), max = glm::vec3(-INFINITY);
+            uint32_t count = 0;
+        };
+        Bin bins[BINS];
+        float scale = BINS / spread[axis];
+        auto binOf = [&](const Leaf &leaf) {
+            float centroid = (leaf.min[axis] + leaf.max[axis]) * 0.5f;
+            return std::min(BINS - 1, static_cast<unsigned int>((centroid - centroidMin[axis]) * scale));
+        };
+        for (uint32_t i = first; i < last; i++)
+        {
+            Bin &bin = bins[binOf(leaves[i])];
+            bin.min = glm::min(bin.min, leaves[i].min);
+            bin.max = glm::max(bin.max, leaves[i].max);
+            bin.count++;
+        }
+
+        // cost of splitting after each bin: area * count of both sides, swept from the right then from the left
+        float rightCost[BINS];
+        Bin right;
+        for (unsigned int i = BINS - 1; i > 0; i--)
+        {
+            right.min = glm::min(right.min, bins[i].min);
+            right.max = glm::max(right.max, bins[i].max);
+            right.count += bins[i].count;
+            rightCost[i - 1] = right.count ? surfaceArea(right.min, right.max) * right.count : 0.0f;
+        }
+        float bestCost = INFINITY;
+        unsigned int bestBin = 0;
+        Bin left;
+        for (unsigned int i = 0; i < BINS - 1; i++)
+        {
+            left.min = glm::min(left.min, bins[i].min);
+            left.max = glm::max(left.max, bins[i].max);
+            left.count += bins[i].count;
+            float cost = (left.count ? surfaceArea(left.min, left.max) * left.count : 0.0f) + rightCost[i];
+            if (left.count > 0 && left.count < count && cost < bestCost)
+            {
+                bestCost = cost;
+                bestBin = i;
+            }
+        }
+        // a traversal step costs about one intersection test
+        float leafCost = surfaceArea(node.min, node.max) * count;
+        if (bestCost + surfaceArea(node.min, node.max) >= leafCost && count <= 4 * MAX_LEAF_SIZE)
+            return first;
+        if (bestCost == INFINITY)
+            return first + count / 2;
+
+        Leaf *middle = std::partition(&leaves[first], &leaves[first] + count,
+                                      [&](const Leaf &leaf) { return binOf(leaf) <= bestBin; });
+        return static_cast<uint32_t>(middle - &leaves[0]);
+    }
+
+    void refit()
+    {
+        bool moved = false;
+        for (const Object &object : objects)
+            moved = moved || object.moved;
+        if (!moved)
+            return;
+        for (Leaf &leaf : leaves)
+            if (objects[leaf.object].moved)
+                updateLeaf(leaf);
+        for (Object &object : objects)
+            object.moved = false;
+        // children follow their parents, so walking backwards sees them first
+        for (size_t i = nodes.size(); i-- > 0;)
+        {
+            Node &node = nodes[i];
+            if (node.count > 0)
+            {
+                node.min = leaves[node.first].min;
+                node.max = leaves[node.first].max;
+                for (uint32_t j = node.first + 1; j < node.first + node.count; j++)
+                {
+                    node.min = glm::min(node.min, leaves[j].min);
+                    node.max = glm::max(node.max, leaves[j].max);
+                }
+            }
+            else
+            {
+                const Node &left = nodes[i + 1];
+                const Node &right = nodes[node.right];
+                node.min = glm::min(left.min, right.min);
+                node.max = glm::max(left.max, right.max);
+            }
+        }
+    }
+
+    template <typename F>
+    void querySphere(uint32_t index, const glm::vec3 &center, float radius, F &f) const
+    {
+        const Node &node = nodes[index];
+        if (!sphereIntersects(node.min, node.max, center, radius))
+            return;
+        if (node.count == 0)
+        {
+            querySphere(index + 1, center, radius, f);
+            querySphere(node.right, center, radius, f);
+            return;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; i++)
+        {
+            const Leaf &leaf = leaves[i];
+            if (sphereIntersects(leaf.min, leaf.max, center, radius))
+                f(leaf.object, leaf.mesh);
+        }
+    }
+
+    void markVisible(uint32_t index)
+    {
+        const Node &node = nodes[index];
+        if (node.count == 0)
+        {
+            markVisible(index + 1);
+            markVisible(node.right);
+            return;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; i++)
+            objects[leaves[i].object].visibility[leaves[i].mesh] = 1;
+        stats.leavesVisible += node.count;
+    }
+
+    // planes is a mask of the planes the node is not known to be inside of
+    void cullNode(uint32_t index, const Frustum &frustum, unsigned int planes)
+    {
+        const Node &node = nodes[index];
+        stats.nodesTested++;
+        glm::vec3 center = (node.min + node.max) * 0.5f;
+        glm::vec3 extent = (node.max - node.min) * 0.5f;
+        for (unsigned int i = 0; i < 6; i++)
+        {
+            if (!(planes & 1u << i))
+                continue;
+            const glm::vec4 &plane = frustum.planes[i];
+            float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+            float radius = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+            if (distance < -radius)
+                return;
+            if (distance >= radius)
+                planes &= ~(1u << i);
+        }
+        if (planes == 0)
+        {
+            markVisible(index);
+            return;
+        }
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; i++)
+            {
+                const Leaf &leaf = leaves[i];
+                if (leafInside(leaf, frustum, planes))
+                {
+                    objects[leaf.object].visibility[leaf.mesh] = 1;
+                    stats.leavesVisible++;
+                }
+            }
+            return;
+        }
+        cullNode(index + 1, frustum, planes);
+        cullNode(node.right, frustum, planes);
+    }
+
+    static bool leafInside(const Leaf &leaf, const Frustum &frustum, unsigned int planes)
+    {
+        glm::vec3 center = (leaf.min + leaf.max) * 0.5f;
+        glm::vec3 extent = (leaf.max - leaf.min) * 0.5f;
+        for (unsigned int i = 0; i < 6; i++)
+        {
+            if (!(planes & 1u << i))
+                continue;
+            const glm::vec4 &plane = frustum.planes[i];
+            float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+            float radius = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+            if (distance < -radius)
+                return false;
+        }
+        return true;
+    }
+};
+#endif
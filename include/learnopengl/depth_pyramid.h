@@ -0,0 +1,172 @@
+#ifndef DEPTH_PYRAMID_H
+#define DEPTH_PYRAMID_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/shader_compiler.h>
+#include <learnopengl/uniforms.h>
+
+#include <algorithm>
+
+// hierarchical depth (Hi-Z) of a frame for occlusion tests on the GPU. the depth buffer is copied after the opaque
+// pass and reduced level by level, every texel keeping the farthest depth below it: texel (x, y) of level i covers
+// the screen pixels (x, y) << (i + 1) up to the next texel, and the last texel of an odd sized row or column of the
+// level below takes the one left over as well. a box whose nearest depth is behind the farthest depth of the texels
+// its screen rectangle touches is hidden, and at the level where that rectangle is two texels wide at most it touches
+// no more than four. the pyramid is read by the next frame, with the viewProjection it was drawn with.
+class DepthPyramid
+{
+public:
+    DepthPyramid() = default;
+    DepthPyramid(const DepthPyramid &) = delete;
+    DepthPyramid &operator=(const DepthPyramid &) = delete;
+
+    ~DepthPyramid()
+    {
+        release();
+        if (framebuffer)
+            glDeleteFramebuffers(1, &framebuffer);
+        if (emptyVAO)
+            GLState::Get().DeleteVertexArray(emptyVAO);
+    }
+
+    // hands the reduction program to the compiler
+    void Submit(ShaderCompiler &compiler)
+    {
+        compiler.Submit(reduceShader, "resources/shaders/depth_pyramid.vs", "resources/shaders/depth_pyramid.fs");
+    }
+
+    // copies the depth of the default framebuffer (width x height, bound for reading) and reduces it. viewProjection
+    // is the transform the depth was drawn with. leaves the default framebuffer bound with a full viewport.
+    void Build(int width, int height, const glm::mat4 &viewProjection)
+    {
+        if (reduceShader.ID == 0 || width <= 0 || height <= 0)
+            return;
+        if (width != this->width || height != this->height)
+            resize(width, height);
+
+        // the texture calls below go to the active unit, which a skipped bind does not switch
+        GLState &state = GLState::Get();
+        state.ActiveTexture(0);
+        state.BindTexture(0, GL_TEXTURE_2D, depthCopy);
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+        // no depth or stencil attachment, so neither test can reject the triangle; the culled faces could
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        state.Disable(GL_CULL_FACE);
+        state.ColorMask(true, true, true, true);
+        reduceShader.use();
+        reduceShader.set(UNIFORM("source"), 0);
+        state.BindVertexArray(emptyVAO);
+        int levelWidth = width, levelHeight = height;
+        for (int level = 0; level < levels; level++)
+        {
+            // the level below is all the shader can see of the texture, never the one being written
+            if (level > 0)
+            {
+                state.BindTexture(0, GL_TEXTURE_2D, pyramid);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+            }
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramid, level);
+            glViewport(0, 0, levelWidth, levelHeight);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        state.BindTexture(0, GL_TEXTURE_2D, pyramid);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, width, height);
+        state.Enable(GL_CULL_FACE);
+        this->viewProjection = viewProjection;
+        built = true;
+    }
+
+    // binds the pyramid to a texture unit and sets the uniforms an occlusion test reads (see
+    // common/depth_pyramid.glsl) on the bound shader. without a pyramid yet the test finds nothing hidden.
+    void Bind(Shader &shader, unsigned int unit) const
+    {
+        GLState::Get().BindTexture(unit, GL_TEXTURE_2D, pyramid);
+        shader.set(UNIFORM("depthPyramid"), static_cast<int>(unit));
+        shader.set(UNIFORM("pyramidLevels"), built ? levels : 0);
+        shader.set(UNIFORM("pyramidScreenSize"), glm::vec2(width, height));
+        shader.set(UNIFORM("pyramidViewProjection"), viewProjection);
+    }
+
+    // forgets the last Build, e.g. when nothing should be found hidden
+    void Invalidate()
+    {
+        built = false;
+    }
+
+    int Levels() const
+    {
+        return levels;
+    }
+
+private:
+    Shader reduceShader;
+    GLuint depthCopy = 0, pyramid = 0;
+    GLuint framebuffer = 0, emptyVAO = 0;
+    int width = 0, height = 0, levels = 0;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    bool built = false;
+
+    void release()
+    {
+        if (depthCopy)
+            GLState::Get().DeleteTexture(depthCopy);
+        if (pyramid)
+            GLState::Get().DeleteTexture(pyramid);
+        depthCopy = pyramid = 0;
+    }
+
+    // the copy at the size of the screen, the pyramid from half that down to a single texel
+    void resize(int width, int height)
+    {
+        release();
+        this->width = width;
+        this->height = height;
+        built = false;
+        if (framebuffer == 0)
+        {
+            glGenFramebuffers(1, &framebuffer);
+            glGenVertexArrays(1, &emptyVAO);
+        }
+        GLState &state = GLState::Get();
+        state.ActiveTexture(0);
+        glGenTextures(1, &depthCopy);
+        state.BindTexture(0, GL_TEXTURE_2D, depthCopy);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+        setNearest(0);
+
+        int levelWidth = std::max(width / 2, 1), levelHeight = std::max(height / 2, 1);
+        levels = 1;
+        for (int largest = std::max(levelWidth, levelHeight); largest > 1; largest /= 2)
+            levels++;
+        glGenTextures(1, &pyramid);
+        state.BindTexture(0, GL_TEXTURE_2D, pyramid);
+        for (int level = 0; level < levels; level++)
+        {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, levelWidth, levelHeight, 0, GL_RED, GL_FLOAT, nullptr);
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+        }
+        setNearest(levels - 1);
+    }
+
+    static void setNearest(int maxLevel)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, maxLevel > 0 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel);
+    }
+};
+#endif
@@ -0,0 +1,203 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define HANGAR_CULL_SSE
+#endif
+
+// the six planes of a view frustum, extracted from a (model-)view-projection matrix (Gribb & Hartmann). a point p is
+// inside a plane if dot(plane.xyz, p) + plane.w >= 0. the planes are normalized, so that is the distance in the units
+// of the space the matrix maps from: extracted from projection * view * model, they test model space bounds.
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    static Frustum FromMatrix(const glm::mat4 &matrix)
+    {
+        glm::vec4 row[4];
+        for (int i = 0; i < 4; i++)
+            row[i] = glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]);
+        Frustum frustum;
+        frustum.planes[0] = row[3] + row[0];    // left
+        frustum.planes[1] = row[3] - row[0];    // right
+        frustum.planes[2] = row[3] + row[1];    // bottom
+        frustum.planes[3] = row[3] - row[1];    // top
+        frustum.planes[4] = row[3] + row[2];    // near
+        frustum.planes[5] = row[3] - row[2];    // far
+        for (glm::vec4 &plane : frustum.planes)
+        {
+            float length = glm::length(glm::vec3(plane));
+            if (length > 0.0f)
+                plane = plane / length;
+        }
+        return frustum;
+    }
+};
+
+// bounding boxes and spheres of many meshes, structure of arrays so the frustum test reads 4 (SSE) or 8 (AVX) of each
+// component with one load. every array is padded to a multiple of 8 with empty bounds.
+class BoundingVolumes
+{
+public:
+    static const size_t WIDTH = 8;
+
+    // a box (min, max) and the radius of the sphere around its center; returns its index
+    size_t Add(const glm::vec3 &min, const glm::vec3 &max, float radius)
+    {
+        size_t index = count++;
+        size_t padded = (count + WIDTH - 1) / WIDTH * WIDTH;
+        for (std::vector<float> *component : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radii})
+            component->resize(padded, 0.0f);
+        glm::vec3 center = (min + max) * 0.5f;
+        glm::vec3 extent = (max - min) * 0.5f;
+        centerX[index] = center.x;
+        centerY[index] = center.y;
+        centerZ[index] = center.z;
+        extentX[index] = extent.x;
+        extentY[index] = extent.y;
+        extentZ[index] = extent.z;
+        radii[index] = radius;
+        return index;
+    }
+
+    void Clear()
+    {
+        count = 0;
+        for (std::vector<float> *component : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radii})
+            component->clear();
+    }
+
+    size_t Size() const
+    {
+        return count;
+    }
+
+    // Size() rounded up to WIDTH, the length of the visibility array Cull writes
+    size_t PaddedSize() const
+    {
+        return centerX.size();
+    }
+
+    // sets visible[i] to 1 if bounds i may intersect the frustum (neither its sphere nor its box is completely
+    // outside one of the planes), to 0 otherwise. visible needs PaddedSize() entries; returns the visible count.
+    size_t Cull(const Frustum &frustum, uint8_t *visible) const
+    {
+#if defined(__AVX__)
+        cullAVX(frustum, visible);
+#elif defined(HANGAR_CULL_SSE)
+        cullSSE(frustum, visible);
+#else
+        CullScalar(frustum, visible);
+#endif
+        size_t visibleCount = 0;
+        for (size_t i = 0; i < count; i++)
+            visibleCount += visible[i];
+        return visibleCount;
+    }
+
+    // the same one bounds at a time, the reference the SIMD paths are measured against (tools/cull_benchmark.cpp)
+    void CullScalar(const Frustum &frustum, uint8_t *visible) const
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            bool inside = true;
+            for (const glm::vec4 &plane : frustum.planes)
+            {
+                float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+                float boxRadius = std::fabs(plane.x) * extentX[i] + std::fabs(plane.y) * extentY[i] + std::fabs(plane.z) * extentZ[i];
+                if (distance < -boxRadius || distance < -radii[i])
+                {
+                    inside = false;
+                    break;
+                }
+            }
+            visible[i] = inside ? 1 : 0;
+        }
+    }
+
+private:
+    size_t count = 0;
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<float> radii;
+
+#ifdef HANGAR_CULL_SSE
+    void cullSSE(const Frustum &frustum, uint8_t *visible) const
+    {
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        for (size_t i = 0; i < count; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(&centerX[i]), y = _mm_loadu_ps(&centerY[i]), z = _mm_loadu_ps(&centerZ[i]);
+            __m128 ex = _mm_loadu_ps(&extentX[i]), ey = _mm_loadu_ps(&extentY[i]), ez = _mm_loadu_ps(&extentZ[i]);
+            __m128 radius = _mm_loadu_ps(&radii[i]);
+            __m128 outside = _mm_setzero_ps();
+            for (const glm::vec4 &plane : frustum.planes)
+            {
+                __m128 nx = _mm_set1_ps(plane.x), ny = _mm_set1_ps(plane.y), nz = _mm_set1_ps(plane.z);
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, x), _mm_mul_ps(ny, y)),
+                                             _mm_add_ps(_mm_mul_ps(nz, z), _mm_set1_ps(plane.w)));
+                __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, nx), ex),
+                                                         _mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)),
+                                              _mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+                // distance < -r  <=>  distance + r < 0
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, boxRadius), _mm_setzero_ps()));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+            }
+            int mask = _mm_movemask_ps(outside);
+            for (int lane = 0; lane < 4; lane++)
+                visible[i + lane] = (mask >> lane & 1) ? 0 : 1;
+        }
+    }
+#endif
+
+#ifdef __AVX__
+    void cullAVX(const Frustum &frustum, uint8_t *visible) const
+    {
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        for (size_t i = 0; i < count; i += 8)
+        {
+            __m256 x = _mm256_loadu_ps(&centerX[i]), y = _mm256_loadu_ps(&centerY[i]), z = _mm256_loadu_ps(&centerZ[i]);
+            __m256 ex = _mm256_loadu_ps(&extentX[i]), ey = _mm256_loadu_ps(&extentY[i]), ez = _mm256_loadu_ps(&extentZ[i]);
+            __m256 radius = _mm256_loadu_ps(&radii[i]);
+            __m256 outside = _mm256_setzero_ps();
+            for (const glm::vec4 &plane : frustum.planes)
+            {
+                __m256 nx = _mm256_set1_ps(plane.x), ny = _mm256_set1_ps(plane.y), nz = _mm256_set1_ps(plane.z);
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, x), _mm256_mul_ps(ny, y)),
+                                                _mm256_add_ps(_mm256_mul_ps(nz, z), _mm256_set1_ps(plane.w)));
+                __m256 boxRadius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, nx), ex),
+                                                               _mm256_mul_ps(_mm256_andnot_ps(signMask, ny), ey)),
+                                                 _mm256_mul_ps(_mm256_andnot_ps(signMask, nz), ez));
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, boxRadius), _mm256_setzero_ps(), _CMP_LT_OQ));
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+            }
+            int mask = _mm256_movemask_ps(outside);
+            for (int lane = 0; lane < 8; lane++)
+                visible[i + lane] = (mask >> lane & 1) ? 0 : 1;
+        }
+    }
+#endif
+};
+
+// meshes tested against the frustum and meshes that passed, counted for the ImGui panel
+struct CullingStats
+{
+    unsigned long tested = 0;
+    unsigned long visible = 0;
+
+    static CullingStats &Global()
+    {
+        static CullingStats stats;
+        return stats;
+    }
+};
+#endif
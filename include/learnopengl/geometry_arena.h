@@ -0,0 +1,168 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/vertex_layout.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// where a mesh's data landed in an arena: the values glDrawElementsBaseVertex takes
+struct ArenaAllocation {
+    GLint baseVertex;
+    size_t indexOffset;     // in bytes
+};
+
+// one big vertex buffer and one big index buffer for all static meshes of vertex format V, set up in a single VAO.
+// meshes are appended (never freed) and drawn with a base vertex, so any number of them can go into one
+// glMultiDrawElementsBaseVertex. full buffers are reallocated at twice the size and the old contents copied over.
+template <typename V>
+class GeometryArena
+{
+public:
+    static GeometryArena &Get()
+    {
+        static GeometryArena arena;
+        return arena;
+    }
+
+    // the VAO every mesh of this format draws with
+    unsigned int VAO()
+    {
+        if (vao == 0)
+            create();
+        return vao;
+    }
+
+    // another VAO over the arena's buffers, for attributes of the caller's own to be added to (e.g. per instance
+    // ones from a buffer of theirs). it is kept pointing at the arena's buffers when they grow.
+    unsigned int CreateVAO()
+    {
+        if (vao == 0)
+            create();
+        unsigned int extra;
+        glGenVertexArrays(1, &extra);
+        extraVAOs.push_back(extra);
+        bindToVAO(extra);
+        return extra;
+    }
+
+    // deletes a VAO of CreateVAO, which the arena stops rebinding when its buffers grow
+    void DeleteVAO(unsigned int extra)
+    {
+        extraVAOs.erase(std::remove(extraVAOs.begin(), extraVAOs.end(), extra), extraVAOs.end());
+        GLState::Get().DeleteVertexArray(extra);
+    }
+
+    // appends the vertices and indices (relative to the mesh's first vertex). indices are 2 or 4 bytes wide, their
+    // offset is aligned to that size.
+    ArenaAllocation Allocate(const V *vertices, size_t vertexCount, const void *indices, size_t indexCount, size_t indexSize)
+    {
+        if (vao == 0)
+            create();
+        indexUsed = (indexUsed + indexSize - 1) / indexSize * indexSize;
+        reserve(vertexBuffer, vertexCapacity, vertexUsed + vertexCount * sizeof(V), GL_ARRAY_BUFFER);
+        reserve(indexBuffer, indexCapacity, indexUsed + indexCount * indexSize, GL_ELEMENT_ARRAY_BUFFER);
+
+        ArenaAllocation allocation;
+        allocation.baseVertex = vertexUsed / sizeof(V);
+        allocation.indexOffset = indexUsed;
+        GLState &state = GLState::Get();
+        state.BindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, vertexUsed, vertexCount * sizeof(V), vertices);
+        state.BindBuffer(GL_ARRAY_BUFFER, 0);
+        state.BindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, indexUsed, indexCount * indexSize, indices);
+        state.BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        vertexUsed += vertexCount * sizeof(V);
+        indexUsed += indexCount * indexSize;
+        return allocation;
+    }
+
+    size_t VertexBytes() const
+    {
+        return vertexUsed;
+    }
+
+    size_t IndexBytes() const
+    {
+        return indexUsed;
+    }
+
+private:
+    static const size_t INITIAL_VERTEX_BYTES = 8 << 20;
+    static const size_t INITIAL_INDEX_BYTES = 4 << 20;
+
+    unsigned int vao = 0, vertexBuffer = 0, indexBuffer = 0;
+    size_t vertexCapacity = 0, vertexUsed = 0;
+    size_t indexCapacity = 0, indexUsed = 0;
+    std::vector<unsigned int> extraVAOs;
+
+    GeometryArena() = default;
+    GeometryArena(const GeometryArena &) = delete;
+    GeometryArena &operator=(const GeometryArena &) = delete;
+
+    void create()
+    {
+        glGenVertexArrays(1, &vao);
+        vertexBuffer = createBuffer(INITIAL_VERTEX_BYTES);
+        indexBuffer = createBuffer(INITIAL_INDEX_BYTES);
+        vertexCapacity = INITIAL_VERTEX_BYTES;
+        indexCapacity = INITIAL_INDEX_BYTES;
+        bindToVAO();
+    }
+
+    static unsigned int createBuffer(size_t size)
+    {
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        GLState &state = GLState::Get();
+        state.BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+        state.BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    }
+
+    // the attribute pointers and the element buffer are VAO state and have to be redone for a new buffer
+    void bindToVAO()
+    {
+        bindToVAO(vao);
+        for (unsigned int extra : extraVAOs)
+            bindToVAO(extra);
+    }
+
+    void bindToVAO(unsigned int target)
+    {
+        GLState &state = GLState::Get();
+        state.BindVertexArray(target);
+        state.BindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        VertexFormat<V>::Layout::Enable();
+        state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        state.BindVertexArray(0);
+        state.BindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void reserve(unsigned int &buffer, size_t &capacity, size_t required, GLenum binding)
+    {
+        if (required <= capacity)
+            return;
+        size_t grown = capacity;
+        while (grown < required)
+            grown *= 2;
+        unsigned int replacement = createBuffer(grown);
+        GLState &state = GLState::Get();
+        state.BindBuffer(GL_COPY_READ_BUFFER, buffer);
+        state.BindBuffer(GL_COPY_WRITE_BUFFER, replacement);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, binding == GL_ARRAY_BUFFER ? vertexUsed : indexUsed);
+        state.BindBuffer(GL_COPY_READ_BUFFER, 0);
+        state.BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        state.DeleteBuffer(buffer);
+        buffer = replacement;
+        capacity = grown;
+        bindToVAO();
+    }
+};
+#endif
@@ -0,0 +1,134 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// glad was generated for the GL 3.3 core profile only. newer entry points the renderer can use when the driver has
+// them are declared here and loaded by LoadGLExtensions; they stay null (and the flags false) otherwise.
+
+// GL 4.1 / ARB_get_program_binary
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#endif
+
+// KHR_parallel_shader_compile (ARB_parallel_shader_compile has the same values)
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// GL 4.3: compute shaders, shader storage buffers and multi-draw-indirect (IndirectRenderer)
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#define GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS 0x90D6
+#endif
+
+// GL 4.6 / ARB_indirect_parameters
+#ifndef GL_PARAMETER_BUFFER_ARB
+#define GL_PARAMETER_BUFFER_ARB 0x80EE
+#endif
+
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+typedef void (APIENTRYP DispatchComputeProc)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+typedef void (APIENTRYP MemoryBarrierProc)(GLbitfield barriers);
+typedef void (APIENTRYP ClearBufferDataProc)(GLenum target, GLenum internalFormat, GLenum format, GLenum type, const void *data);
+typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void *indirect, GLsizei drawCount, GLsizei stride);
+typedef void (APIENTRYP MultiDrawElementsIndirectCountProc)(GLenum mode, GLenum type, const void *indirect, GLintptr drawCount, GLsizei maxDrawCount, GLsizei stride);
+
+struct GLExtensions
+{
+    bool programBinary = false;
+    GetProgramBinaryProc GetProgramBinary = nullptr;
+    ProgramBinaryProc ProgramBinary = nullptr;
+    ProgramParameteriProc ProgramParameteri = nullptr;
+
+    bool parallelShaderCompile = false;
+    MaxShaderCompilerThreadsProc MaxShaderCompilerThreads = nullptr;
+
+    // the multi-draw-indirect rendering tier: everything it needs is GL 4.3 core
+    bool indirectTier = false;
+    DispatchComputeProc DispatchCompute = nullptr;
+    MemoryBarrierProc MemoryBarrier = nullptr;
+    ClearBufferDataProc ClearBufferData = nullptr;
+    MultiDrawElementsIndirectProc MultiDrawElementsIndirect = nullptr;
+    // null without ARB_indirect_parameters: the draw count then comes from the CPU
+    MultiDrawElementsIndirectCountProc MultiDrawElementsIndirectCount = nullptr;
+};
+
+inline GLExtensions &GLExt()
+{
+    static GLExtensions extensions;
+    return extensions;
+}
+
+inline bool HasGLExtension(const char *extension)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *name = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (name && strcmp(name, extension) == 0)
+            return true;
+    }
+    return false;
+}
+
+inline bool HasGLVersion(int major, int minor)
+{
+    GLint contextMajor = 0, contextMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+    return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+// call once after gladLoadGLLoader, with the same loader
+inline void LoadGLExtensions(GLADloadproc load)
+{
+    GLExtensions &ext = GLExt();
+    if (HasGLVersion(4, 1) || HasGLExtension("GL_ARB_get_program_binary"))
+    {
+        ext.GetProgramBinary = reinterpret_cast<GetProgramBinaryProc>(load("glGetProgramBinary"));
+        ext.ProgramBinary = reinterpret_cast<ProgramBinaryProc>(load("glProgramBinary"));
+        ext.ProgramParameteri = reinterpret_cast<ProgramParameteriProc>(load("glProgramParameteri"));
+        // a driver may expose the entry points without supporting a single binary format
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        ext.programBinary = ext.GetProgramBinary && ext.ProgramBinary && ext.ProgramParameteri && formats > 0;
+    }
+    if (HasGLExtension("GL_KHR_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(load("glMaxShaderCompilerThreadsKHR"));
+    else if (HasGLExtension("GL_ARB_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(load("glMaxShaderCompilerThreadsARB"));
+    ext.parallelShaderCompile = ext.MaxShaderCompilerThreads != nullptr;
+    // a 3.3 core context request gets the highest core version the driver has, so 4.3 shows up here when it exists
+    if (HasGLVersion(4, 3))
+    {
+        ext.DispatchCompute = reinterpret_cast<DispatchComputeProc>(load("glDispatchCompute"));
+        ext.MemoryBarrier = reinterpret_cast<MemoryBarrierProc>(load("glMemoryBarrier"));
+        ext.ClearBufferData = reinterpret_cast<ClearBufferDataProc>(load("glClearBufferData"));
+        ext.MultiDrawElementsIndirect = reinterpret_cast<MultiDrawElementsIndirectProc>(load("glMultiDrawElementsIndirect"));
+        // the vertex stage reads the scene from storage buffers, and 4.3 lets a driver give it none
+        GLint vertexStorageBlocks = 0;
+        glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertexStorageBlocks);
+        ext.indirectTier = ext.DispatchCompute && ext.MemoryBarrier && ext.ClearBufferData &&
+                           ext.MultiDrawElementsIndirect && vertexStorageBlocks >= 3;
+    }
+    if (ext.indirectTier && HasGLVersion(4, 6))
+        ext.MultiDrawElementsIndirectCount = reinterpret_cast<MultiDrawElementsIndirectCountProc>(load("glMultiDrawElementsIndirectCount"));
+    else if (ext.indirectTier && HasGLExtension("GL_ARB_indirect_parameters"))
+        ext.MultiDrawElementsIndirectCount = reinterpret_cast<MultiDrawElementsIndirectCountProc>(load("glMultiDrawElementsIndirectCountARB"));
+}
+#endif
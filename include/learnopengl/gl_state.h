@@ -0,0 +1,321 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// shadow copy of the GL state the renderer changes. every call compares against what was last set and only reaches
+// the driver if something actually changes, so code can state what it needs without knowing what is current.
+// binds and deletes of the renderer all go through it; code changing state behind its back has to restore it or call
+// Invalidate(), after which the next call of every kind is issued. calls that edit a texture need ActiveTexture()
+// before the bind, since a bind that is skipped leaves the active unit as it is.
+class GLState
+{
+public:
+    static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+    // calls that went to the driver and calls that were dropped because the state was already set
+    struct Stats
+    {
+        unsigned long issued = 0;
+        unsigned long skipped = 0;
+    };
+
+    static GLState &Get()
+    {
+        static GLState state;
+        return state;
+    }
+
+    GLState(const GLState &) = delete;
+    GLState &operator=(const GLState &) = delete;
+
+    void Invalidate()
+    {
+        program = vao = UNKNOWN;
+        activeUnit = UNKNOWN;
+        for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+        {
+            textures[unit][0] = textures[unit][1] = UNKNOWN;
+            samplers[unit] = UNKNOWN;
+        }
+        for (uint32_t &buffer : buffers)
+            buffer = UNKNOWN;
+        for (int8_t &cap : caps)
+            cap = -1;
+        depthFunc = depthMask = UNKNOWN;
+        stencilFunc[0] = stencilFunc[1] = stencilFunc[2] = UNKNOWN;
+        stencilMask = UNKNOWN;
+        stencilOp[0] = stencilOp[1] = stencilOp[2] = UNKNOWN;
+        blendFunc[0] = blendFunc[1] = UNKNOWN;
+        cullFace = UNKNOWN;
+        colorMask = UNKNOWN;
+    }
+
+    const Stats &GetStats() const
+    {
+        return stats;
+    }
+
+    void ResetStats()
+    {
+        stats = Stats();
+    }
+
+    void UseProgram(GLuint id)
+    {
+        if (changed(program, id))
+            glUseProgram(id);
+    }
+
+    void BindVertexArray(GLuint id)
+    {
+        if (changed(vao, id))
+            glBindVertexArray(id);
+    }
+
+    void ActiveTexture(unsigned int unit)
+    {
+        if (changed(activeUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    // binds the texture to the unit, switching the active unit only if the binding changes
+    void BindTexture(unsigned int unit, GLenum target, GLuint texture)
+    {
+        int slot = target == GL_TEXTURE_2D ? 0 : target == GL_TEXTURE_CUBE_MAP ? 1 : -1;
+        if (unit >= MAX_TEXTURE_UNITS || slot < 0)
+        {
+            ActiveTexture(unit);
+            stats.issued++;
+            glBindTexture(target, texture);
+            return;
+        }
+        if (!changed(textures[unit][slot], texture))
+            return;
+        ActiveTexture(unit);
+        glBindTexture(target, texture);
+    }
+
+    void BindSampler(unsigned int unit, GLuint sampler)
+    {
+        if (unit >= MAX_TEXTURE_UNITS)
+        {
+            stats.issued++;
+            glBindSampler(unit, sampler);
+        }
+        else if (changed(samplers[unit], sampler))
+            glBindSampler(unit, sampler);
+    }
+
+    // GL_ELEMENT_ARRAY_BUFFER is part of the VAO and passes straight through
+    void BindBuffer(GLenum target, GLuint buffer)
+    {
+        int slot = bufferSlot(target);
+        if (slot < 0)
+        {
+            stats.issued++;
+            glBindBuffer(target, buffer);
+        }
+        else if (changed(buffers[slot], buffer))
+            glBindBuffer(target, buffer);
+    }
+
+    // deleting an object unbinds it; GL hands its id out again, which must not look bound already
+    void DeleteVertexArray(GLuint id)
+    {
+        if (vao == id)
+            vao = 0;
+        glDeleteVertexArrays(1, &id);
+    }
+
+    void DeleteTexture(GLuint texture)
+    {
+        for (auto &unit : textures)
+            for (uint32_t &bound : unit)
+                if (bound == texture)
+                    bound = 0;
+        glDeleteTextures(1, &texture);
+    }
+
+    void DeleteBuffer(GLuint buffer)
+    {
+        for (uint32_t &bound : buffers)
+            if (bound == buffer)
+                bound = 0;
+        glDeleteBuffers(1, &buffer);
+    }
+
+    void Set(GLenum cap, bool enabled)
+    {
+        int slot = capSlot(cap);
+        if (slot >= 0)
+        {
+            if (caps[slot] == (enabled ? 1 : 0))
+            {
+                stats.skipped++;
+                return;
+            }
+            caps[slot] = enabled ? 1 : 0;
+        }
+        stats.issued++;
+        if (enabled)
+            glEnable(cap);
+        else
+            glDisable(cap);
+    }
+
+    void Enable(GLenum cap)
+    {
+        Set(cap, true);
+    }
+
+    void Disable(GLenum cap)
+    {
+        Set(cap, false);
+    }
+
+    void DepthFunc(GLenum func)
+    {
+        if (changed(depthFunc, func))
+            glDepthFunc(func);
+    }
+
+    void DepthMask(GLboolean write)
+    {
+        if (changed(depthMask, write))
+            glDepthMask(write);
+    }
+
+    void StencilFunc(GLenum func, GLint ref, GLuint mask)
+    {
+        uint32_t value[3] = {func, static_cast<uint32_t>(ref), mask};
+        if (changed(stencilFunc, value))
+            glStencilFunc(func, ref, mask);
+    }
+
+    void StencilMask(GLuint mask)
+    {
+        if (changed(stencilMask, mask))
+            glStencilMask(mask);
+    }
+
+    void StencilOp(GLenum stencilFail, GLenum depthFail, GLenum pass)
+    {
+        uint32_t value[3] = {stencilFail, depthFail, pass};
+        if (changed(stencilOp, value))
+            glStencilOp(stencilFail, depthFail, pass);
+    }
+
+    void BlendFunc(GLenum source, GLenum destination)
+    {
+        uint32_t value[2] = {source, destination};
+        if (changed(blendFunc, value))
+            glBlendFunc(source, destination);
+    }
+
+    void CullFace(GLenum mode)
+    {
+        if (changed(cullFace, mode))
+            glCullFace(mode);
+    }
+
+    void ColorMask(bool red, bool green, bool blue, bool alpha)
+    {
+        uint32_t mask = red | green << 1 | blue << 2 | alpha << 3;
+        if (changed(colorMask, mask))
+            glColorMask(red, green, blue, alpha);
+    }
+
+private:
+    static const uint32_t UNKNOWN = 0xFFFFFFFF;
+    enum { CAP_BLEND, CAP_DEPTH_TEST, CAP_STENCIL_TEST, CAP_CULL_FACE, CAP_SCISSOR_TEST, CAP_COUNT };
+    enum { BUFFER_ARRAY, BUFFER_UNIFORM, BUFFER_COPY_READ, BUFFER_COPY_WRITE, BUFFER_PIXEL_UNPACK, BUFFER_COUNT };
+
+    Stats stats;
+    uint32_t program, vao, activeUnit;
+    uint32_t textures[MAX_TEXTURE_UNITS][2];    // GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP
+    uint32_t samplers[MAX_TEXTURE_UNITS];
+    uint32_t buffers[BUFFER_COUNT];
+    int8_t caps[CAP_COUNT];                     // -1 unknown
+    uint32_t depthFunc, depthMask;
+    uint32_t stencilFunc[3], stencilMask, stencilOp[3];
+    uint32_t blendFunc[2];
+    uint32_t cullFace;
+    uint32_t colorMask;
+
+    GLState()
+    {
+        Invalidate();
+    }
+
+    // stores value and returns true if it differs from the shadowed one, counting either way
+    bool changed(uint32_t &shadow, uint32_t value)
+    {
+        if (shadow == value)
+        {
+            stats.skipped++;
+            return false;
+        }
+        shadow = value;
+        stats.issued++;
+        return true;
+    }
+
+    template <size_t N>
+    bool changed(uint32_t (&shadow)[N], const uint32_t (&value)[N])
+    {
+        bool same = true;
+        for (size_t i = 0; i < N; i++)
+            same = same && shadow[i] == value[i];
+        if (same)
+        {
+            stats.skipped++;
+            return false;
+        }
+        for (size_t i = 0; i < N; i++)
+            shadow[i] = value[i];
+        stats.issued++;
+        return true;
+    }
+
+    static int capSlot(GLenum cap)
+    {
+        switch (cap)
+        {
+        case GL_BLEND:
+            return CAP_BLEND;
+        case GL_DEPTH_TEST:
+            return CAP_DEPTH_TEST;
+        case GL_STENCIL_TEST:
+            return CAP_STENCIL_TEST;
+        case GL_CULL_FACE:
+            return CAP_CULL_FACE;
+        case GL_SCISSOR_TEST:
+            return CAP_SCISSOR_TEST;
+        default:
+            return -1;
+        }
+    }
+
+    static int bufferSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER:
+            return BUFFER_ARRAY;
+        case GL_UNIFORM_BUFFER:
+            return BUFFER_UNIFORM;
+        case GL_COPY_READ_BUFFER:
+            return BUFFER_COPY_READ;
+        case GL_COPY_WRITE_BUFFER:
+            return BUFFER_COPY_WRITE;
+        case GL_PIXEL_UNPACK_BUFFER:
+            return BUFFER_PIXEL_UNPACK;
+        default:
+            return -1;
+        }
+    }
+};
+#endif
@@ -0,0 +1,82 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stb_image.h>
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+// 8-bit image kept in memory with tightly packed rows (no row padding), 1 to 4 channels.
+struct Image
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<unsigned char> pixels;
+};
+
+// decodes an image file with stb_image. flipping is done here instead of through stbi_set_flip_vertically_on_load,
+// which is global state, so images can be decoded from several threads at once with different orientations.
+inline bool LoadImageFile(const std::string &path, Image &image, bool flipVertically)
+{
+    int width, height, channels;
+    unsigned char *data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+    if (!data)
+        return false;
+
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    size_t rowSize = (size_t)width * channels;
+    image.pixels.resize(rowSize * height);
+    for (int y = 0; y < height; y++)
+    {
+        int source = flipVertically ? height - 1 - y : y;
+        memcpy(&image.pixels[rowSize * y], data + rowSize * source, rowSize);
+    }
+    stbi_image_free(data);
+    return true;
+}
+
+// halves an image with a 2x2 box filter. odd dimensions clamp the last row/column so every level stays valid.
+inline Image DownsampleImage(const Image &src)
+{
+    Image dst;
+    dst.width = src.width > 1 ? src.width / 2 : 1;
+    dst.height = src.height > 1 ? src.height / 2 : 1;
+    dst.channels = src.channels;
+    dst.pixels.resize((size_t)dst.width * dst.height * dst.channels);
+
+    const int c = src.channels;
+    for (int y = 0; y < dst.height; y++)
+    {
+        int y0 = std::min(y * 2, src.height - 1);
+        int y1 = std::min(y * 2 + 1, src.height - 1);
+        for (int x = 0; x < dst.width; x++)
+        {
+            int x0 = std::min(x * 2, src.width - 1);
+            int x1 = std::min(x * 2 + 1, src.width - 1);
+            const unsigned char *p00 = &src.pixels[((size_t)y0 * src.width + x0) * c];
+            const unsigned char *p01 = &src.pixels[((size_t)y0 * src.width + x1) * c];
+            const unsigned char *p10 = &src.pixels[((size_t)y1 * src.width + x0) * c];
+            const unsigned char *p11 = &src.pixels[((size_t)y1 * src.width + x1) * c];
+            unsigned char *out = &dst.pixels[((size_t)y * dst.width + x) * c];
+            for (int i = 0; i < c; i++)
+                out[i] = (unsigned char)((p00[i] + p01[i] + p10[i] + p11[i] + 2) / 4);
+        }
+    }
+    return dst;
+}
+
+// builds the full mip chain down to 1x1; level 0 is a copy of the base image.
+inline std::vector<Image> BuildMipChain(const Image &base)
+{
+    std::vector<Image> levels;
+    levels.push_back(base);
+    while (levels.back().width > 1 || levels.back().height > 1)
+        levels.push_back(DownsampleImage(levels.back()));
+    return levels;
+}
+#endif
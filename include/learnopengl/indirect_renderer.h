@@ -0,0 +1,329 @@
+#ifndef INDIRECT_RENDERER_H
+#define INDIRECT_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/depth_pyramid.h>
+#include <learnopengl/geometry_arena.h>
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/material.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/shader_compiler.h>
+#include <learnopengl/uniforms.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// the multi-draw-indirect rendering tier, for drivers with GL 4.3 (GLExtensions::indirectTier). the meshes of the
+// scene are uploaded once, with the transforms of their objects and the constants of their materials, to shader
+// storage buffers (common/indirect_draws.glsl). every frame Cull() dispatches indirect_cull.comp, which tests each
+// mesh against the frustum and the depth pyramid and packs the draw commands of the visible ones into a
+// GL_DRAW_INDIRECT_BUFFER, and Draw() submits them with a glMultiDrawElementsIndirect per group: the CPU neither
+// looks at a mesh nor sets a uniform per object or material.
+//
+// textures cannot change within a multi-draw without bindless textures, so meshes are grouped by program, texture
+// set, index type and quantization box, the rest of what tells them apart is read per draw (lit_indirect.vs).
+class IndirectRenderer
+{
+public:
+    // the record of each draw as lit_indirect.vs reads it, advanced once per instance from the base instance on
+    static const GLuint DRAW_RECORD_LOCATION = 9;
+    // the texture unit the depth pyramid is bound to while culling
+    static const unsigned int PYRAMID_UNIT = 0;
+
+    // meshes in the scene and the multi-draws the last Draw issued for them
+    struct Stats
+    {
+        unsigned long meshes = 0;
+        unsigned long multiDraws = 0;
+    };
+
+    IndirectRenderer() = default;
+    IndirectRenderer(const IndirectRenderer &) = delete;
+    IndirectRenderer &operator=(const IndirectRenderer &) = delete;
+
+    ~IndirectRenderer()
+    {
+        if (vao == 0)
+            return;
+        GLuint buffers[] = {recordBuffer, objectBuffer, materialBuffer, commandBuffer, countBuffer, identityBuffer};
+        for (GLuint buffer : buffers)
+            GLState::Get().DeleteBuffer(buffer);
+        GeometryArena<GpuVertex>::Get().DeleteVAO(vao);
+    }
+
+    static bool Supported()
+    {
+        return GLExt().indirectTier;
+    }
+
+    // hands the culling program to the compiler
+    void Submit(ShaderCompiler &compiler)
+    {
+        compiler.SubmitCompute(cullShader, "resources/shaders/indirect_cull.comp");
+    }
+
+    // an object meshes are added to, with an identity transform until SetObject
+    uint32_t AddObject()
+    {
+        objects.push_back(ObjectData{glm::mat4(1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)});
+        return static_cast<uint32_t>(objects.size() - 1);
+    }
+
+    // the object's transform, and the opacity and fog color its meshes are drawn with
+    void SetObject(uint32_t object, const glm::mat4 &model, float opacity, const glm::vec3 &fogColor)
+    {
+        objects[object] = ObjectData{model, glm::vec4(fogColor, opacity)};
+    }
+
+    // adds a mesh of an object, drawn with shader (a program compiled with INDIRECT) and the material's textures
+    // bound under names. the mesh has to stay where it is until the next Clear; nothing is drawn before Upload.
+    void AddMesh(const Mesh &mesh, uint32_t object, Shader &shader, const MaterialUniforms &names)
+    {
+        std::string key(reinterpret_cast<const char *>(&mesh.quantization), sizeof(AABB));
+        key += ' ' + std::to_string(reinterpret_cast<uintptr_t>(&shader));
+        key += ' ' + std::to_string(reinterpret_cast<uintptr_t>(&names));
+        key += ' ' + std::to_string(mesh.indexType);
+        for (const Texture &texture : mesh.textures)
+            key += ' ' + std::to_string(texture.id) + ':' + std::to_string(static_cast<unsigned int>(texture.type));
+        auto group = groupIndex.find(key);
+        if (group == groupIndex.end())
+        {
+            group = groupIndex.emplace(key, groups.size()).first;
+            groups.push_back(Group{&shader, &mesh, &names, mesh.indexType, 0, {}});
+        }
+
+        std::string constants(reinterpret_cast<const char *>(&mesh.material), sizeof(MaterialConstants));
+        auto material = materialIndex.find(constants);
+        if (material == materialIndex.end())
+        {
+            material = materialIndex.emplace(constants, materials.size()).first;
+            materials.push_back(MaterialData{glm::vec4(mesh.material.diffuse, mesh.material.shininess),
+                                             glm::vec4(mesh.material.specular, mesh.material.opacity),
+                                             glm::vec4(mesh.material.emissive, 0.0f)});
+        }
+
+        size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+        DrawRecord record = {};
+        record.sphere = glm::vec4((mesh.bounds.min + mesh.bounds.max) * 0.5f, mesh.radius);
+        record.count = mesh.indexCount;
+        record.firstIndex = static_cast<GLuint>(mesh.indexOffset / indexSize);
+        record.baseVertex = mesh.baseVertex;
+        record.object = object;
+        record.material = static_cast<GLuint>(material->second);
+        record.group = static_cast<GLuint>(group->second);
+        groups[group->second].records.push_back(record);
+    }
+
+    // forgets the meshes, the objects stay
+    void Clear()
+    {
+        groups.clear();
+        groupIndex.clear();
+        materials.clear();
+        materialIndex.clear();
+        records.clear();
+        stats.meshes = 0;
+    }
+
+    // lays the meshes out group after group and uploads them with the materials
+    void Upload()
+    {
+        if (vao == 0)
+            create();
+        records.clear();
+        for (size_t i = 0; i < groups.size(); i++)
+        {
+            Group &group = groups[i];
+            group.firstCommand = records.size();
+            for (DrawRecord record : group.records)
+            {
+                record.groupFirst = static_cast<GLuint>(group.firstCommand);
+                records.push_back(record);
+            }
+        }
+        stats.meshes = records.size();
+
+        GLState &state = GLState::Get();
+        upload(recordBuffer, records.data(), records.size() * sizeof(DrawRecord), GL_STATIC_DRAW);
+        upload(materialBuffer, materials.data(), materials.size() * sizeof(MaterialData), GL_STATIC_DRAW);
+        upload(commandBuffer, nullptr, records.size() * sizeof(DrawCommand), GL_DYNAMIC_COPY);
+        upload(countBuffer, nullptr, groups.size() * sizeof(GLuint), GL_DYNAMIC_COPY);
+        // the record numbers the base instance of each command points into
+        if (identityCount < records.size())
+        {
+            std::vector<GLuint> identity(records.size());
+            for (size_t i = 0; i < identity.size(); i++)
+                identity[i] = static_cast<GLuint>(i);
+            state.BindBuffer(GL_ARRAY_BUFFER, identityBuffer);
+            glBufferData(GL_ARRAY_BUFFER, identity.size() * sizeof(GLuint), identity.data(), GL_STATIC_DRAW);
+            identityCount = identity.size();
+        }
+    }
+
+    // writes the commands of the meshes in the frustum of this frame (FrameData) that the pyramid does not hide.
+    // best issued early in the frame, ahead of the draws that read the commands.
+    void Cull(const DepthPyramid &pyramid)
+    {
+        if (records.empty() || cullShader.ID == 0)
+            return;
+        const GLExtensions &ext = GLExt();
+        upload(objectBuffer, objects.data(), objects.size() * sizeof(ObjectData), GL_STREAM_DRAW);
+        // the groups start empty; without draw counts from the GPU the commands nobody wrote must draw nothing
+        GLState &state = GLState::Get();
+        state.BindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+        ext.ClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        if (!ext.MultiDrawElementsIndirectCount)
+        {
+            state.BindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+            ext.ClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        }
+
+        cullShader.use();
+        pyramid.Bind(cullShader, PYRAMID_UNIT);
+        cullShader.set(UNIFORM("drawCount"), static_cast<int>(records.size()));
+        bindStorage();
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, commandBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, countBuffer);
+        ext.DispatchCompute(static_cast<GLuint>((records.size() + 63) / 64), 1, 1);
+        ext.MemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // draws what the last Cull kept, a glMultiDrawElementsIndirect per group. the lights, fog and the rest of the
+    // per frame uniforms of the programs are the caller's to set.
+    void Draw()
+    {
+        stats.multiDraws = 0;
+        if (records.empty())
+            return;
+        const GLExtensions &ext = GLExt();
+        GLState &state = GLState::Get();
+        state.BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        if (ext.MultiDrawElementsIndirectCount)
+            state.BindBuffer(GL_PARAMETER_BUFFER_ARB, countBuffer);
+        bindStorage();
+        state.BindVertexArray(vao);
+        for (size_t i = 0; i < groups.size(); i++)
+        {
+            const Group &group = groups[i];
+            group.shader->use();
+            group.first->BindMaterial(*group.shader, *group.names);
+            group.first->SetVertexFormatUniforms(*group.shader);
+            const void *commands = reinterpret_cast<const void *>(group.firstCommand * sizeof(DrawCommand));
+            GLsizei maxCount = static_cast<GLsizei>(group.records.size());
+            if (ext.MultiDrawElementsIndirectCount)
+                ext.MultiDrawElementsIndirectCount(GL_TRIANGLES, group.indexType, commands,
+                                                   static_cast<GLintptr>(i * sizeof(GLuint)), maxCount, 0);
+            else
+                ext.MultiDrawElementsIndirect(GL_TRIANGLES, group.indexType, commands, maxCount, 0);
+            stats.multiDraws++;
+        }
+    }
+
+    const Stats &GetStats() const
+    {
+        return stats;
+    }
+
+private:
+    // the std430 structs of common/indirect_draws.glsl
+    struct DrawRecord
+    {
+        glm::vec4 sphere;
+        GLuint count;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint object;
+        GLuint material;
+        GLuint group;
+        GLuint groupFirst;
+        GLuint padding;
+    };
+    static_assert(sizeof(DrawRecord) == 48, "DrawRecord has the std430 layout of indirect_draws.glsl");
+
+    struct ObjectData
+    {
+        glm::mat4 model;
+        glm::vec4 fogColorOpacity;
+    };
+
+    struct MaterialData
+    {
+        glm::vec4 diffuseShininess;
+        glm::vec4 specularOpacity;
+        glm::vec4 emissive;
+    };
+
+    // as glMultiDrawElementsIndirect reads it
+    struct DrawCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // the meshes one multi-draw covers, the first of them binding the textures for all
+    struct Group
+    {
+        Shader *shader;
+        const Mesh *first;
+        const MaterialUniforms *names;
+        GLenum indexType;
+        size_t firstCommand;
+        std::vector<DrawRecord> records;
+    };
+
+    Shader cullShader;
+    std::vector<Group> groups;
+    std::unordered_map<std::string, size_t> groupIndex;
+    std::vector<MaterialData> materials;
+    std::unordered_map<std::string, size_t> materialIndex;
+    std::vector<ObjectData> objects;
+    std::vector<DrawRecord> records;
+    GLuint recordBuffer = 0, objectBuffer = 0, materialBuffer = 0;
+    GLuint commandBuffer = 0, countBuffer = 0, identityBuffer = 0;
+    size_t identityCount = 0;
+    GLuint vao = 0;
+    Stats stats;
+
+    // the vertex layout and index buffer of the geometry arena, and the record numbers at DRAW_RECORD_LOCATION
+    void create()
+    {
+        GLuint buffers[6];
+        glGenBuffers(6, buffers);
+        recordBuffer = buffers[0];
+        objectBuffer = buffers[1];
+        materialBuffer = buffers[2];
+        commandBuffer = buffers[3];
+        countBuffer = buffers[4];
+        identityBuffer = buffers[5];
+        vao = GeometryArena<GpuVertex>::Get().CreateVAO();
+        GLState &state = GLState::Get();
+        state.BindVertexArray(vao);
+        state.BindBuffer(GL_ARRAY_BUFFER, identityBuffer);
+        glEnableVertexAttribArray(DRAW_RECORD_LOCATION);
+        glVertexAttribIPointer(DRAW_RECORD_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), nullptr);
+        glVertexAttribDivisor(DRAW_RECORD_LOCATION, 1);
+    }
+
+    static void upload(GLuint buffer, const void *data, size_t size, GLenum usage)
+    {
+        GLState::Get().BindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(size), data, usage);
+    }
+
+    void bindStorage() const
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, recordBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, objectBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, materialBuffer);
+    }
+};
+#endif
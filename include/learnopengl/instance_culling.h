@@ -0,0 +1,235 @@
+#ifndef INSTANCE_CULLING_H
+#define INSTANCE_CULLING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/depth_pyramid.h>
+#include <learnopengl/geometry_arena.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/shader_compiler.h>
+
+#include <cstddef>
+#include <vector>
+
+// one instance of a model drawn through InstanceCuller: its transform and the sphere around it, both world space
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::vec4 sphere;   // center, radius
+};
+
+// culls large instance populations on the GPU without the CPU looking at a single instance. Cull() draws one point
+// per instance with the rasterizer discarded (instance_cull.vs/gs): the vertex shader tests the instance's sphere
+// against the frustum and the depth pyramid of the previous frame, the geometry shader emits the visible ones and
+// transform feedback packs their transforms into a buffer. the model is then drawn instanced from that buffer, the
+// instance count read from a GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN query.
+//
+// GL 3.3 has no way to draw straight from the transform feedback count without the CPU (glDrawTransformFeedback-
+// Instanced is GL 4.2), so the CPU reads the query, but never waits for it: there are two buffers, and if this
+// frame's count is not ready by the time the model is drawn, the previous frame's buffer is drawn with its count.
+class InstanceCuller
+{
+public:
+    // the transform of each instance as the draw reads it: a column per location, from here to INSTANCE_LOCATION + 3
+    static const GLuint INSTANCE_LOCATION = 5;
+    // the texture unit the depth pyramid is bound to while culling
+    static const unsigned int PYRAMID_UNIT = 0;
+
+    // instances, how many of them the last Resolve drew, and whether those are the previous frame's
+    struct Stats
+    {
+        unsigned long instances = 0;
+        unsigned long drawn = 0;
+        bool late = false;
+    };
+
+    InstanceCuller() = default;
+    InstanceCuller(const InstanceCuller &) = delete;
+    InstanceCuller &operator=(const InstanceCuller &) = delete;
+
+    ~InstanceCuller()
+    {
+        if (source == 0)
+            return;
+        GLState &state = GLState::Get();
+        state.DeleteBuffer(source);
+        state.DeleteVertexArray(cullVAO);
+        for (Slot &slot : slots)
+        {
+            state.DeleteBuffer(slot.buffer);
+            glDeleteQueries(1, &slot.query);
+            if (slot.vao)
+                slot.deleteVAO(slot.vao);
+        }
+    }
+
+    // hands the culling program to the compiler
+    void Submit(ShaderCompiler &compiler)
+    {
+        cullShader.SetFeedbackVaryings({"visibleModel"});
+        compiler.Submit(cullShader, "resources/shaders/instance_cull.vs", "resources/shaders/instance_cull.fs",
+                        "resources/shaders/instance_cull.gs");
+    }
+
+    // replaces the instances, as often as they move
+    void SetInstances(const std::vector<InstanceData> &instances)
+    {
+        if (source == 0)
+            create();
+        count = instances.size();
+        GLState &state = GLState::Get();
+        state.BindBuffer(GL_ARRAY_BUFFER, source);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(InstanceData), instances.data(), GL_DYNAMIC_DRAW);
+        // the output buffers only grow, the VAOs keep pointing at them
+        for (Slot &slot : slots)
+        {
+            if (slot.capacity >= count)
+                continue;
+            state.BindBuffer(GL_ARRAY_BUFFER, slot.buffer);
+            glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::mat4), nullptr, GL_DYNAMIC_COPY);
+            slot.capacity = count;
+        }
+        stats.instances = count;
+    }
+
+    // writes the transforms of the instances in the frustum of this frame (FrameData) that the pyramid does not
+    // hide to the next buffer. best issued early in the frame, so the GPU is done with it by Resolve.
+    void Cull(const DepthPyramid &pyramid)
+    {
+        if (count == 0 || cullShader.ID == 0)
+            return;
+        current = (current + 1) % SLOTS;
+        Slot &slot = slots[current];
+        GLState &state = GLState::Get();
+        cullShader.use();
+        pyramid.Bind(cullShader, PYRAMID_UNIT);
+        state.BindVertexArray(cullVAO);
+        state.Enable(GL_RASTERIZER_DISCARD);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, slot.buffer);
+        glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, slot.query);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+        glEndTransformFeedback();
+        glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        state.Disable(GL_RASTERIZER_DISCARD);
+        slot.pending = true;
+        // so the pass is on its way while the CPU records the rest of the frame
+        glFlush();
+    }
+
+    // picks the buffer to draw: the last Cull's if its count is available, otherwise the one before it, whose
+    // count is a frame old and read even if that means waiting. returns the number of instances in it.
+    GLsizei Resolve()
+    {
+        drawn = current;
+        stats.late = !collect(slots[current], false);
+        if (stats.late)
+        {
+            drawn = (current + SLOTS - 1) % SLOTS;
+            collect(slots[drawn], true);
+        }
+        stats.drawn = slots[drawn].visible;
+        return static_cast<GLsizei>(slots[drawn].visible);
+    }
+
+    // the VAO to draw the resolved buffer with: the vertex layout and index buffer of the geometry arena of vertex
+    // format V, and the transforms of the visible instances from INSTANCE_LOCATION on, advanced once per instance
+    template <typename V>
+    GLuint VAO()
+    {
+        Slot &slot = slots[drawn];
+        if (slot.vao != 0)
+            return slot.vao;
+        slot.vao = GeometryArena<V>::Get().CreateVAO();
+        slot.deleteVAO = [](GLuint vao) { GeometryArena<V>::Get().DeleteVAO(vao); };
+        GLState &state = GLState::Get();
+        state.BindVertexArray(slot.vao);
+        state.BindBuffer(GL_ARRAY_BUFFER, slot.buffer);
+        for (GLuint column = 0; column < 4; column++)
+        {
+            glEnableVertexAttribArray(INSTANCE_LOCATION + column);
+            glVertexAttribPointer(INSTANCE_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                                  reinterpret_cast<void *>(column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(INSTANCE_LOCATION + column, 1);
+        }
+        return slot.vao;
+    }
+
+    size_t Size() const
+    {
+        return count;
+    }
+
+    const Stats &GetStats() const
+    {
+        return stats;
+    }
+
+private:
+    static const size_t SLOTS = 2;
+
+    // an output buffer, the query counting what was written to it and the VAO drawing it, given back to the arena
+    // it came from with deleteVAO
+    struct Slot
+    {
+        GLuint buffer = 0;
+        GLuint query = 0;
+        GLuint vao = 0;
+        void (*deleteVAO)(GLuint) = nullptr;
+        size_t capacity = 0;
+        bool pending = false;
+        GLuint visible = 0;
+    };
+
+    Shader cullShader;
+    GLuint source = 0, cullVAO = 0;
+    size_t count = 0;
+    Slot slots[SLOTS];
+    size_t current = 0, drawn = 0;
+    Stats stats;
+
+    // the instances as points: the transform at locations 0 to 3, the sphere at 4
+    void create()
+    {
+        glGenBuffers(1, &source);
+        glGenVertexArrays(1, &cullVAO);
+        for (Slot &slot : slots)
+        {
+            glGenBuffers(1, &slot.buffer);
+            glGenQueries(1, &slot.query);
+        }
+        GLState &state = GLState::Get();
+        state.BindVertexArray(cullVAO);
+        state.BindBuffer(GL_ARRAY_BUFFER, source);
+        for (GLuint column = 0; column < 4; column++)
+        {
+            glEnableVertexAttribArray(column);
+            glVertexAttribPointer(column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  reinterpret_cast<void *>(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        }
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              reinterpret_cast<void *>(offsetof(InstanceData, sphere)));
+    }
+
+    // reads the count of the slot's last cull, if it is there or wait is set; false if it is not there yet
+    static bool collect(Slot &slot, bool wait)
+    {
+        if (!slot.pending)
+            return true;
+        if (!wait)
+        {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(slot.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return false;
+        }
+        glGetQueryObjectuiv(slot.query, GL_QUERY_RESULT, &slot.visible);
+        slot.pending = false;
+        return true;
+    }
+};
+#endif
@@ -0,0 +1,114 @@
+#ifndef KTX_H
+#define KTX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// block-compressed texture in memory: every mip level as the bytes glCompressedTexImage2D takes
+struct CompressedLevel
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> data;
+};
+
+struct CompressedTexture
+{
+    uint32_t internalFormat = 0;   // GL_COMPRESSED_*
+    uint32_t baseFormat = 0;       // GL_RGB, GL_RGBA, GL_RED or GL_RG
+    std::vector<CompressedLevel> levels;
+};
+
+// KTX 1.1 container (https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html), only what the texture cache
+// needs: a single 2D image of a compressed format with its mip levels, little endian, no key/value data.
+struct KTXHeader
+{
+    unsigned char identifier[12];
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+static_assert(sizeof(KTXHeader) == 64, "KTX header layout");
+
+const unsigned char KTX_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+const uint32_t KTX_ENDIANNESS = 0x04030201;
+
+inline bool WriteKTX(const std::string &path, const CompressedTexture &texture)
+{
+    if (texture.levels.empty())
+        return false;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    KTXHeader header = {};
+    memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    header.endianness = KTX_ENDIANNESS;
+    header.glTypeSize = 1;   // glType and glFormat stay 0 for compressed data
+    header.glInternalFormat = texture.internalFormat;
+    header.glBaseInternalFormat = texture.baseFormat;
+    header.pixelWidth = texture.levels[0].width;
+    header.pixelHeight = texture.levels[0].height;
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = texture.levels.size();
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    // block sizes are multiples of 4 bytes, so no mip padding is ever needed
+    for (const CompressedLevel &level : texture.levels)
+    {
+        uint32_t imageSize = level.data.size();
+        out.write(reinterpret_cast<const char *>(&imageSize), sizeof(imageSize));
+        out.write(reinterpret_cast<const char *>(level.data.data()), imageSize);
+    }
+    out.close();
+    return !out.fail();
+}
+
+inline bool ReadKTX(const std::string &path, CompressedTexture &texture)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    KTXHeader header;
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        return false;
+    if (memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 || header.endianness != KTX_ENDIANNESS ||
+        header.glType != 0 || header.numberOfFaces != 1 || header.numberOfArrayElements != 0 || header.pixelDepth != 0)
+        return false;
+    in.seekg(header.bytesOfKeyValueData, std::ios::cur);
+
+    texture.internalFormat = header.glInternalFormat;
+    texture.baseFormat = header.glBaseInternalFormat;
+    texture.levels.assign(std::max<uint32_t>(header.numberOfMipmapLevels, 1), CompressedLevel());
+    for (size_t i = 0; i < texture.levels.size(); i++)
+    {
+        CompressedLevel &level = texture.levels[i];
+        level.width = std::max<uint32_t>(header.pixelWidth >> i, 1);
+        level.height = std::max<uint32_t>(header.pixelHeight >> i, 1);
+        // 4x4 blocks of 8 (BC1, BC4) or 16 bytes (BC5)
+        size_t blocks = (size_t)((level.width + 3) / 4) * ((level.height + 3) / 4);
+        uint32_t imageSize;
+        if (!in.read(reinterpret_cast<char *>(&imageSize), sizeof(imageSize)) || (imageSize != blocks * 8 && imageSize != blocks * 16))
+            return false;
+        level.data.resize(imageSize);
+        if (!in.read(reinterpret_cast<char *>(level.data.data()), imageSize))
+            return false;
+        in.seekg((4 - imageSize % 4) % 4, std::ios::cur);
+    }
+    return true;
+}
+#endif
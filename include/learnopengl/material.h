@@ -0,0 +1,70 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/uniforms.h>
+
+#include <cstdint>
+#include <string>
+
+// material slot of a texture, named texture_diffuseN, texture_specularN, ... in the shaders
+enum class TextureType : uint32_t
+{
+    Diffuse,
+    Specular,
+    Normal,
+    Height
+};
+
+const unsigned int TEXTURE_TYPE_COUNT = 4;
+const char *const TEXTURE_TYPE_NAMES[TEXTURE_TYPE_COUNT] = {"texture_diffuse", "texture_specular", "texture_normal", "texture_height"};
+
+// textures of one type a material can have (texture_diffuse1, texture_diffuse2); further ones are not bound
+const unsigned int MAX_TEXTURES_PER_TYPE = 2;
+const unsigned int MATERIAL_TEXTURE_UNITS = TEXTURE_TYPE_COUNT * MAX_TEXTURES_PER_TYPE;
+
+// every material binds the Nth texture of a type to the same unit, so the sampler uniforms never change between
+// materials: texture_diffuse1 is always unit 0, texture_specular1 unit 1, ..., texture_diffuse2 unit 4
+inline unsigned int MaterialTextureUnit(TextureType type, unsigned int index)
+{
+    return index * TEXTURE_TYPE_COUNT + static_cast<unsigned int>(type);
+}
+
+// the constant part of a material, from the MTL statements of the same name
+struct MaterialConstants
+{
+    glm::vec3 diffuse = glm::vec3(1.0f);     // Kd
+    glm::vec3 specular = glm::vec3(1.0f);    // Ks
+    glm::vec3 emissive = glm::vec3(0.0f);    // Ke
+    float shininess = 32.0f;                 // Ns
+    float opacity = 1.0f;                    // d
+};
+static_assert(sizeof(MaterialConstants) == 44, "MaterialConstants is compared and hashed as raw bytes");
+
+// the uniforms of a material struct in a shader, hashed once per name prefix (e.g. "material.")
+struct MaterialUniforms
+{
+    UniformName samplers[MATERIAL_TEXTURE_UNITS];     // by texture unit
+    UniformName diffuse, specular, emissive, shininess, opacity;
+
+    explicit MaterialUniforms(const std::string &prefix = "")
+    {
+        for (unsigned int index = 0; index < MAX_TEXTURES_PER_TYPE; index++)
+            for (unsigned int type = 0; type < TEXTURE_TYPE_COUNT; type++)
+                samplers[MaterialTextureUnit(static_cast<TextureType>(type), index)] =
+                    name(prefix + TEXTURE_TYPE_NAMES[type] + std::to_string(index + 1));
+        diffuse = name(prefix + "diffuse");
+        specular = name(prefix + "specular");
+        emissive = name(prefix + "emissive");
+        shininess = name(prefix + "shininess");
+        opacity = name(prefix + "opacity");
+    }
+
+private:
+    static UniformName name(const std::string &text)
+    {
+        return UniformName{UniformHash(text.c_str())};
+    }
+};
+#endif
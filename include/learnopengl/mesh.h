@@ -6,8 +6,14 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/geometry_arena.h>
+#include <learnopengl/material.h>
+#include <learnopengl/meshlets.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/vertex_layout.h>
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <vector>
 using namespace std;
@@ -25,115 +31,313 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+template <> struct VertexFormat<Vertex>
+{
+    typedef VertexLayout<VertexAttribute<Vertex, glm::vec3, &Vertex::Position, 0>,
+                         VertexAttribute<Vertex, glm::vec3, &Vertex::Normal, 1>,
+                         VertexAttribute<Vertex, glm::vec2, &Vertex::TexCoords, 2>,
+                         VertexAttribute<Vertex, glm::vec3, &Vertex::Tangent, 3>,
+                         VertexAttribute<Vertex, glm::vec3, &Vertex::Bitangent, 4>> Layout;
+};
+
+// 20 byte GPU vertex, encoded from Vertex at upload when built with HANGAR_COMPACT_VERTICES.
+// the vertex shaders decode it when compiled with VERTEX_FORMAT_DEFINES.
+struct CompactVertex {
+    // position quantized to the mesh bounds (dequantized with positionScale/positionOffset),
+    // w is the bitangent sign: 0 for -1, 65535 for +1
+    uint16_t Position[4];
+    // octahedral normal in xy, octahedral tangent in zw
+    int16_t NormalTangent[4];
+    half TexCoords[2];
+};
+static_assert(sizeof(CompactVertex) == 20, "CompactVertex must stay tightly packed");
+
+template <> struct VertexFormat<CompactVertex>
+{
+    typedef VertexLayout<VertexAttribute<CompactVertex, uint16_t[4], &CompactVertex::Position, 0, true>,
+                         VertexAttribute<CompactVertex, int16_t[4], &CompactVertex::NormalTangent, 1, true>,
+                         VertexAttribute<CompactVertex, half[2], &CompactVertex::TexCoords, 2>> Layout;
+};
 
+#ifdef HANGAR_COMPACT_VERTICES
+typedef CompactVertex GpuVertex;
+const char *const VERTEX_FORMAT_DEFINES = "#define COMPACT_VERTICES\n";
+#else
+typedef Vertex GpuVertex;
+const char *const VERTEX_FORMAT_DEFINES = "";
+#endif
 
 struct Texture {
     unsigned int id;
-    string type;
+    TextureType type;
     string path;
 };
 
+// axis aligned bounding box in model space
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+inline AABB ComputeBounds(const Vertex *vertices, size_t count)
+{
+    AABB bounds;
+    bounds.min = count ? vertices[0].Position : glm::vec3(0.0f);
+    bounds.max = bounds.min;
+    for (size_t i = 1; i < count; i++)
+    {
+        bounds.min = glm::min(bounds.min, vertices[i].Position);
+        bounds.max = glm::max(bounds.max, vertices[i].Position);
+    }
+    return bounds;
+}
+
+// radius of the sphere around center that holds every vertex, tighter than the half diagonal of the bounds
+inline float ComputeBoundingRadius(const Vertex *vertices, size_t count, const glm::vec3 &center)
+{
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 offset = vertices[i].Position - center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    return std::sqrt(radiusSquared);
+}
+
+inline AABB MergeBounds(const AABB &a, const AABB &b)
+{
+    AABB merged;
+    merged.min = glm::min(a.min, b.min);
+    merged.max = glm::max(a.max, b.max);
+    return merged;
+}
+
+// quantizes the position to 16 bits per axis within bounds; the bitangent is rebuilt in the shader as
+// cross(normal, tangent) * sign
+inline void EncodeVertex(const Vertex &in, const AABB &bounds, CompactVertex &out)
+{
+    glm::vec3 extent = bounds.max - bounds.min;
+    for (int i = 0; i < 3; i++)
+    {
+        float t = extent[i] > 0.0f ? (in.Position[i] - bounds.min[i]) / extent[i] : 0.0f;
+        out.Position[i] = (uint16_t)std::lround(glm::clamp(t, 0.0f, 1.0f) * 65535.0f);
+    }
+    out.Position[3] = glm::dot(glm::cross(in.Normal, in.Tangent), in.Bitangent) < 0.0f ? 0 : 65535;
+    OctEncode(in.Normal, &out.NormalTangent[0]);
+    OctEncode(in.Tangent, &out.NormalTangent[2]);
+    out.TexCoords[0] = FloatToHalf(in.TexCoords.x);
+    out.TexCoords[1] = FloatToHalf(in.TexCoords.y);
+}
+
+// 1x1 white texture for the diffuse unit of materials without a diffuse map, so their Kd comes through unchanged
+inline unsigned int WhiteTexture()
+{
+    static unsigned int texture = 0;
+    if (texture == 0)
+    {
+        const unsigned char white[4] = {255, 255, 255, 255};
+        glGenTextures(1, &texture);
+        GLState::Get().ActiveTexture(0);
+        GLState::Get().BindTexture(0, GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    return texture;
+}
+
+// CPU-side mesh as produced by the importer, before anything is uploaded to GL.
+// texture ids are left at 0, only type and path (relative to the model directory) are filled in.
+struct MeshData {
+    string               name;
+    vector<Vertex>       vertices;
+    vector<unsigned int> indices;
+    vector<Texture>      textures;
+    MaterialConstants    material;
+};
+
 class Mesh {
 public:
     // mesh Data
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    // Kd only tints materials without a diffuse map, exporters write their default Kd next to the map
+    MaterialConstants    material;
 
+    // the VAO of the geometry arena the mesh is stored in, shared by every mesh of the same vertex format
     unsigned int VAO;
-    std::string glslIdentifierPrefix;
+    unsigned int indexCount;
+    // GL_UNSIGNED_SHORT when the mesh has at most 65536 vertices
+    GLenum indexType;
+    // where the mesh starts in the arena buffers, as glDrawElementsBaseVertex takes it
+    GLint baseVertex;
+    size_t indexOffset;
+    AABB bounds;
+    // bounding sphere around the center of bounds
+    float radius;
+    // the index buffer in runs of triangles with their own bounds and normal cones, culled one by one in Model::Submit
+    vector<Meshlet> meshlets;
+    // box the positions are quantized to (HANGAR_COMPACT_VERTICES), the mesh bounds unless given.
+    // meshes can only be drawn in one batch if they share it.
+    AABB quantization;
+    // false while a streamed mesh still waits for its textures, Model::Draw skips it until then
+    bool resident = true;
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, const MaterialConstants &material,
+         const AABB *quantization = nullptr)
     {
         this->vertices = vertices;
         this->indices = indices;
-        this->textures = textures;
+        setupMaterial(textures, material);
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(&this->vertices[0], this->vertices.size(), &this->indices[0], this->indices.size(), quantization);
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    // constructs a mesh straight from packed vertex/index data (e.g. a memory mapped scene archive).
+    // the data is only read during construction and no CPU-side copy is kept.
+    Mesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount, vector<Texture> textures,
+         const MaterialConstants &material, const AABB *quantization = nullptr)
+    {
+        setupMaterial(textures, material);
+        setupMesh(vertexData, vertexCount, indexData, indexCount, quantization);
+    }
+
+    // binds the textures to their fixed units (see MaterialTextureUnit) and sets the material constants. units of
+    // texture types the material lacks sample black instead of another material's map, white for a missing diffuse map.
+    // the samplers are set too, but as the units are the same for every material that is a no-op after the first.
+    void BindMaterial(const Shader &shader, const MaterialUniforms &names) const
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+        GLState &state = GLState::Get();
+        for (unsigned int i = 0; i < bindingCount; i++)
+        {
+            state.BindTexture(bindings[i].unit, GL_TEXTURE_2D, bindings[i].texture);
+            shader.set(names.samplers[bindings[i].unit], static_cast<int>(bindings[i].unit));
+        }
+        for (unsigned int type = 0; type < TEXTURE_TYPE_COUNT; type++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            if (typeCounts[type] != 0)
+                continue;
+            state.BindTexture(type, GL_TEXTURE_2D, type == static_cast<unsigned int>(TextureType::Diffuse) ? WhiteTexture() : 0);
+            shader.set(names.samplers[type], static_cast<int>(type));
         }
+        shader.set(names.diffuse, material.diffuse);
+        shader.set(names.specular, material.specular);
+        shader.set(names.emissive, material.emissive);
+        shader.set(names.shininess, material.shininess);
+        shader.set(names.opacity, material.opacity);
+    }
 
+    bool HasTexture(TextureType type) const
+    {
+        return typeCounts[static_cast<unsigned int>(type)] != 0;
+    }
 
+    // uniforms the vertex shader needs to decode the GPU vertex format
+    void SetVertexFormatUniforms(Shader &shader) const
+    {
+#ifdef HANGAR_COMPACT_VERTICES
+        // positions are quantized to the quantization box
+        shader.set(UNIFORM("positionScale"), quantization.max - quantization.min);
+        shader.set(UNIFORM("positionOffset"), quantization.min);
+#endif
+    }
 
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    // render the mesh on its own, Model::Draw batches meshes that share a material instead
+    void Draw(Shader &shader)
+    {
+        static const MaterialUniforms unprefixed;
+        Draw(shader, unprefixed);
+    }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    void Draw(Shader &shader, const MaterialUniforms &names)
+    {
+        BindMaterial(shader, names);
+        SetVertexFormatUniforms(shader);
+
+        // draw mesh
+        GLState::Get().BindVertexArray(VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, indexType, (void*)indexOffset, baseVertex);
     }
 
 private:
-    // render data
-    unsigned int VBO, EBO;
-
-    // initializes all the buffer objects/arrays
-    void setupMesh()
-    {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-        glBindVertexArray(0);
+    struct TextureBinding
+    {
+        unsigned int texture;
+        unsigned int unit;
+    };
+    TextureBinding bindings[MATERIAL_TEXTURE_UNITS];
+    unsigned int bindingCount = 0;
+    unsigned int typeCounts[TEXTURE_TYPE_COUNT] = {};
+
+    // resolves each texture to its unit once, so binding the material is nothing but integer binds
+    void setupMaterial(const vector<Texture> &textures, const MaterialConstants &material)
+    {
+        this->textures = textures;
+        this->material = material;
+        for (const Texture &texture : textures)
+        {
+            unsigned int &count = typeCounts[static_cast<unsigned int>(texture.type)];
+            if (count == MAX_TEXTURES_PER_TYPE)
+                continue;
+            bindings[bindingCount].texture = texture.id;
+            bindings[bindingCount].unit = MaterialTextureUnit(texture.type, count++);
+            bindingCount++;
+        }
+        if (HasTexture(TextureType::Diffuse))
+            this->material.diffuse = glm::vec3(1.0f);
+    }
+
+    // converts the vertices to the GPU format V, returns them in storage
+    template <typename V>
+    static const V *encodeVertices(const Vertex *vertexData, size_t vertexCount, const AABB &quantization, vector<V> &storage)
+    {
+        storage.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+            EncodeVertex(vertexData[i], quantization, storage[i]);
+        return storage.data();
+    }
+
+    // float vertices are uploaded as they are
+    static const Vertex *encodeVertices(const Vertex *vertexData, size_t vertexCount, const AABB &quantization, vector<Vertex> &storage)
+    {
+        return vertexData;
+    }
+
+    // suballocates the vertex and index data from the arena of the GPU vertex format
+    void setupMesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount, const AABB *quantization)
+    {
+        this->indexCount = indexCount;
+        this->bounds = ComputeBounds(vertexData, vertexCount);
+        this->radius = ComputeBoundingRadius(vertexData, vertexCount, (bounds.min + bounds.max) * 0.5f);
+        this->quantization = quantization ? *quantization : bounds;
+        // the triangles are uploaded in meshlet order, and kept so if the mesh has a CPU-side copy
+        vector<unsigned int> clustered;
+        BuildMeshlets(vertexData, vertexCount, indexData, indexCount, clustered, meshlets);
+        indexData = clustered.data();
+
+        vector<GpuVertex> encoded;
+        const GpuVertex *gpuVertices = encodeVertices(vertexData, vertexCount, this->quantization, encoded);
+
+        GeometryArena<GpuVertex> &arena = GeometryArena<GpuVertex>::Get();
+        ArenaAllocation allocation;
+        if (vertexCount <= 65536)
+        {
+            vector<uint16_t> shortIndices(indexData, indexData + indexCount);
+            allocation = arena.Allocate(gpuVertices, vertexCount, shortIndices.data(), indexCount, sizeof(uint16_t));
+            indexType = GL_UNSIGNED_SHORT;
+        }
+        else
+        {
+            allocation = arena.Allocate(gpuVertices, vertexCount, indexData, indexCount, sizeof(unsigned int));
+            indexType = GL_UNSIGNED_INT;
+        }
+        VAO = arena.VAO();
+        baseVertex = allocation.baseVertex;
+        indexOffset = allocation.indexOffset;
+        if (!indices.empty())
+            indices = clustered;
     }
 };
 #endif
\ No newline at end of file
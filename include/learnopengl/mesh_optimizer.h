@@ -0,0 +1,243 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/vertex_cache.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// Import-time geometry optimization: vertex welding, triangle order for the post-transform vertex cache
+// (Forsyth, "Linear-Speed Vertex Cache Optimisation"), cluster order against overdraw (Sander, Nehab, Barczak,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw") and vertex order for fetch locality.
+
+static_assert(sizeof(Vertex) == 14 * sizeof(float), "Vertex has padding, welding compares raw bytes");
+
+// average cache miss ratio: vertices transformed per triangle with a FIFO cache of the given size.
+// 3.0 means no reuse at all, 0.5 is the limit for large regular grids.
+inline float ComputeACMR(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = 16)
+{
+    if (indices.size() < 3)
+        return 0.0f;
+    // a vertex is in the FIFO while fewer than cacheSize misses happened since it was loaded
+    vector<unsigned int> loadedAt(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    size_t misses = 0;
+    for (unsigned int index : indices)
+    {
+        if (time - loadedAt[index] > cacheSize)
+        {
+            loadedAt[index] = time++;
+            misses++;
+        }
+    }
+    return (float)misses / (float)(indices.size() / 3);
+}
+
+// merges vertices whose attributes are bit-identical. OBJ imports emit one vertex per face corner, so this
+// usually removes two thirds of them.
+inline void WeldVertices(vector<Vertex> &vertices, vector<unsigned int> &indices)
+{
+    struct VertexHash
+    {
+        size_t operator()(const Vertex *v) const
+        {
+            // FNV-1a over the raw attribute bytes
+            const unsigned char *bytes = reinterpret_cast<const unsigned char *>(v);
+            size_t hash = 2166136261u;
+            for (size_t i = 0; i < sizeof(Vertex); i++)
+                hash = (hash ^ bytes[i]) * 16777619u;
+            return hash;
+        }
+    };
+    struct VertexEqual
+    {
+        bool operator()(const Vertex *a, const Vertex *b) const
+        {
+            return memcmp(a, b, sizeof(Vertex)) == 0;
+        }
+    };
+
+    std::unordered_map<const Vertex *, unsigned int, VertexHash, VertexEqual> unique;
+    unique.reserve(vertices.size());
+    vector<unsigned int> remap(vertices.size());
+    vector<Vertex> welded;
+    welded.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        auto found = unique.find(&vertices[i]);
+        if (found != unique.end())
+        {
+            remap[i] = found->second;
+            continue;
+        }
+        remap[i] = welded.size();
+        unique.emplace(&vertices[i], remap[i]);
+        welded.push_back(vertices[i]);
+    }
+    for (unsigned int &index : indices)
+        index = remap[index];
+    vertices.swap(welded);
+}
+
+// reorders clusters of the cache-optimized triangle list so outward facing surfaces come first and hide what
+// is behind them. clusters are cut where the cache order already restarts or where cutting costs at most
+// threshold times the cluster's ACMR, so cache efficiency is mostly kept. the outside is the side GL draws: the
+// counterclockwise one unless culledFace is GL_FRONT.
+inline void OptimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices, GLenum culledFace = GL_BACK,
+                             float threshold = 1.05f)
+{
+    const unsigned int cacheSize = 16;
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return;
+
+    vector<unsigned int> loadedAt(vertices.size(), 0);
+    unsigned int time = cacheSize + 1;
+    auto misses = [&](size_t t) {
+        unsigned int count = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = indices[t * 3 + k];
+            if (time - loadedAt[v] > cacheSize)
+            {
+                loadedAt[v] = time++;
+                count++;
+            }
+        }
+        return count;
+    };
+    auto resetCache = [&]() { time += cacheSize + 1; };
+
+    // hard boundaries: triangles where all three vertices miss, the cache optimizer jumped elsewhere
+    vector<size_t> hard;
+    for (size_t t = 0; t < triangleCount; t++)
+        if (misses(t) == 3)
+            hard.push_back(t);
+    hard.push_back(triangleCount);
+
+    // soft boundaries inside every hard cluster
+    vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); h++)
+    {
+        size_t begin = hard[h], end = hard[h + 1];
+        resetCache();
+        unsigned int clusterMisses = 0;
+        for (size_t t = begin; t < end; t++)
+            clusterMisses += misses(t);
+        float target = threshold * clusterMisses / (float)(end - begin);
+
+        resetCache();
+        clusters.push_back(begin);
+        unsigned int runMisses = 0;
+        size_t runStart = begin;
+        for (size_t t = begin; t < end; t++)
+        {
+            runMisses += misses(t);
+            if (t + 1 < end && runMisses / (float)(t + 1 - runStart) <= target)
+            {
+                clusters.push_back(t + 1);
+                runMisses = 0;
+                runStart = t + 1;
+                resetCache();
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // area weighted centroid and normal per cluster and for the whole mesh
+    size_t clusterCount = clusters.size() - 1;
+    vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f)), normals(clusterCount, glm::vec3(0.0f));
+    vector<float> areas(clusterCount, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            const glm::vec3 &a = vertices[indices[t * 3]].Position;
+            const glm::vec3 &b = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3 &p = vertices[indices[t * 3 + 2]].Position;
+            glm::vec3 normal = glm::cross(b - a, p - a);
+            float area = glm::length(normal);
+            centroids[c] += (a + b + p) * (area / 3.0f);
+            normals[c] += normal;
+            areas[c] += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += areas[c];
+        if (areas[c] > 0.0f)
+            centroids[c] = centroids[c] / areas[c];
+    }
+    if (meshArea > 0.0f)
+        meshCentroid = meshCentroid / meshArea;
+
+    // the normals above are counterclockwise ones
+    float facing = culledFace == GL_FRONT ? -1.0f : 1.0f;
+    vector<float> sortKey(clusterCount);
+    vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        float length = glm::length(normals[c]);
+        glm::vec3 normal = length > 0.0f ? normals[c] / length : glm::vec3(0.0f);
+        sortKey[c] = facing * glm::dot(centroids[c] - meshCentroid, normal);
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order)
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    indices.swap(result);
+}
+
+// stores vertices in the order the index buffer first references them, unreferenced vertices are dropped.
+inline void OptimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices)
+{
+    const unsigned int unused = ~0u;
+    vector<unsigned int> remap(vertices.size(), unused);
+    vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+    for (unsigned int &index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = ordered.size();
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(ordered);
+}
+
+struct MeshOptimizationStats {
+    size_t verticesBefore;
+    size_t verticesAfter;
+    float acmrBefore;
+    float acmrAfter;
+};
+
+// runs all stages in order: weld, vertex cache, overdraw, vertex fetch. culledFace is the face GL culls when the
+// mesh is drawn.
+inline MeshOptimizationStats OptimizeMesh(vector<Vertex> &vertices, vector<unsigned int> &indices, GLenum culledFace = GL_BACK)
+{
+    MeshOptimizationStats stats;
+    stats.verticesBefore = vertices.size();
+    stats.acmrBefore = ComputeACMR(indices, vertices.size());
+
+    WeldVertices(vertices, indices);
+    OptimizeVertexCache(indices, vertices.size());
+    OptimizeOverdraw(indices, vertices, culledFace);
+    OptimizeVertexFetch(vertices, indices);
+
+    stats.verticesAfter = vertices.size();
+    stats.acmrAfter = ComputeACMR(indices, vertices.size());
+    return stats;
+}
+#endif
@@ -0,0 +1,307 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/frustum.h>
+#include <learnopengl/vertex_cache.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// a meshlet is a run of consecutive triangles of a mesh's index buffer with at most MESHLET_MAX_VERTICES distinct
+// vertices and MESHLET_MAX_TRIANGLES triangles. BuildMeshlets grows each from a seed triangle over its neighbors,
+// preferring those that add no vertices and face the same way, and writes the index buffer in meshlet order, so the
+// meshlets that survive culling are ranges of it and draw with no index data rewritten per frame. seeds are taken in
+// the order of the input, so the overdraw order of mesh_optimizer.h survives between meshlets; within a meshlet the
+// triangles are put back in vertex cache order.
+const unsigned int MESHLET_MAX_VERTICES = 64;
+const unsigned int MESHLET_MAX_TRIANGLES = 124;
+// meshlets whose bounding sphere projects smaller than this (diameter in pixels) are skipped
+const float MESHLET_MIN_PIXELS = 0.5f;
+
+struct Meshlet
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // bounding sphere, model space
+    glm::vec3 center;
+    float radius;
+    // the normals of the triangles (counterclockwise) are within the cone around coneAxis whose half angle has the
+    // sine coneCutoff; 1 if they spread over more than a hemisphere and the meshlet always has a face to each side
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+namespace detail
+{
+// bounding sphere and normal cone of the triangles of a meshlet
+template <typename V>
+void computeMeshletBounds(const V *vertices, const unsigned int *triangles, Meshlet &meshlet)
+{
+    glm::vec3 min = vertices[triangles[0]].Position, max = min;
+    for (uint32_t i = 1; i < meshlet.indexCount; i++)
+    {
+        min = glm::min(min, vertices[triangles[i]].Position);
+        max = glm::max(max, vertices[triangles[i]].Position);
+    }
+    meshlet.center = (min + max) * 0.5f;
+    float radiusSquared = 0.0f;
+    for (uint32_t i = 0; i < meshlet.indexCount; i++)
+    {
+        glm::vec3 offset = vertices[triangles[i]].Position - meshlet.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+
+    // the axis is the average of the face normals, the cutoff comes from the one farthest from it
+    glm::vec3 sum(0.0f);
+    for (uint32_t i = 0; i < meshlet.indexCount; i += 3)
+    {
+        const glm::vec3 &a = vertices[triangles[i]].Position;
+        glm::vec3 normal = glm::cross(vertices[triangles[i + 1]].Position - a, vertices[triangles[i + 2]].Position - a);
+        float length = glm::length(normal);
+        if (length > 0.0f)
+            sum += normal / length;
+    }
+    float sumLength = glm::length(sum);
+    meshlet.coneAxis = sumLength > 0.0f ? sum / sumLength : glm::vec3(0.0f, 0.0f, 1.0f);
+    float minDot = sumLength > 0.0f ? 1.0f : -1.0f;
+    for (uint32_t i = 0; i < meshlet.indexCount; i += 3)
+    {
+        const glm::vec3 &a = vertices[triangles[i]].Position;
+        glm::vec3 normal = glm::cross(vertices[triangles[i + 1]].Position - a, vertices[triangles[i + 2]].Position - a);
+        float length = glm::length(normal);
+        if (length > 0.0f)
+            minDot = std::min(minDot, glm::dot(normal / length, meshlet.coneAxis));
+    }
+    meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+}
+
+// reorders the triangles of a meshlet for the vertex cache, on indices local to it so the cost follows its size
+inline void optimizeMeshletTriangles(unsigned int *triangles, uint32_t indexCount)
+{
+    std::vector<unsigned int> vertices, local(indexCount);
+    for (uint32_t i = 0; i < indexCount; i++)
+    {
+        auto found = std::find(vertices.begin(), vertices.end(), triangles[i]);
+        local[i] = static_cast<unsigned int>(found - vertices.begin());
+        if (found == vertices.end())
+            vertices.push_back(triangles[i]);
+    }
+    OptimizeVertexCache(local, vertices.size());
+    for (uint32_t i = 0; i < indexCount; i++)
+        triangles[i] = vertices[local[i]];
+}
+}
+
+// orders the triangles of indices into meshlets, writing the new index order to ordered and the meshlets with their
+// bounds to meshlets. vertices are any type with a Position. triangles are neighbors if they share a position, so
+// creases that split the vertices do not split the meshlets.
+template <typename V>
+void BuildMeshlets(const V *vertices, size_t vertexCount, const unsigned int *indices, size_t indexCount,
+                   std::vector<unsigned int> &ordered, std::vector<Meshlet> &meshlets)
+{
+    meshlets.clear();
+    ordered.clear();
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+    ordered.reserve(triangleCount * 3);
+
+    std::vector<glm::vec3> normals(triangleCount), centroids(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const glm::vec3 &a = vertices[indices[t * 3]].Position, &b = vertices[indices[t * 3 + 1]].Position,
+                        &c = vertices[indices[t * 3 + 2]].Position;
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float length = glm::length(normal);
+        normals[t] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+        centroids[t] = (a + b + c) / 3.0f;
+    }
+
+    // the triangles around each position, vertices of equal position share the first one's list
+    std::vector<uint32_t> positionOf(vertexCount);
+    {
+        std::unordered_map<std::string, uint32_t> byPosition;
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            std::string key(reinterpret_cast<const char *>(&vertices[v].Position), sizeof(glm::vec3));
+            positionOf[v] = byPosition.emplace(key, static_cast<uint32_t>(v)).first->second;
+        }
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0), adjacency(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        adjacencyOffsets[positionOf[indices[i]] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    {
+        std::vector<uint32_t> filled(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            adjacency[filled[positionOf[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    // a candidate scores the vertices it adds, plus CONE_WEIGHT for a normal at right angles to the meshlet's and
+    // DISTANCE_WEIGHT for a centroid as far from the meshlet's center as the meshlet reaches; the lowest is added
+    const float CONE_WEIGHT = 2.0f, DISTANCE_WEIGHT = 1.0f;
+    const uint32_t NONE = 0xFFFFFFFF;
+    std::vector<uint8_t> assigned(triangleCount, 0);
+    // the meshlet a vertex was last added to, and a triangle last became a candidate of
+    std::vector<uint32_t> vertexMeshlet(vertexCount, NONE), candidateMeshlet(triangleCount, NONE);
+    std::vector<uint32_t> candidates;
+    size_t seed = 0;
+    while (ordered.size() < triangleCount * 3)
+    {
+        while (assigned[seed])
+            seed++;
+        uint32_t id = static_cast<uint32_t>(meshlets.size());
+        Meshlet meshlet;
+        meshlet.firstIndex = static_cast<uint32_t>(ordered.size());
+        unsigned int vertexTotal = 0, triangleTotal = 0;
+        glm::vec3 normalSum(0.0f), centroidSum(0.0f);
+        // how far the triangles reach from the seed, the scale distances are measured in
+        float extent = 0.0f;
+        candidates.clear();
+        uint32_t next = static_cast<uint32_t>(seed);
+        while (next != NONE)
+        {
+            assigned[next] = 1;
+            triangleTotal++;
+            normalSum += normals[next];
+            centroidSum += centroids[next];
+            extent = std::max(extent, glm::length(centroids[next] - centroids[seed]));
+            for (int corner = 0; corner < 3; corner++)
+            {
+                unsigned int vertex = indices[next * 3 + corner];
+                ordered.push_back(vertex);
+                if (vertexMeshlet[vertex] != id)
+                {
+                    vertexMeshlet[vertex] = id;
+                    vertexTotal++;
+                }
+                uint32_t position = positionOf[vertex];
+                for (uint32_t j = adjacencyOffsets[position]; j < adjacencyOffsets[position + 1]; j++)
+                {
+                    uint32_t neighbor = adjacency[j];
+                    if (!assigned[neighbor] && candidateMeshlet[neighbor] != id)
+                    {
+                        candidateMeshlet[neighbor] = id;
+                        candidates.push_back(neighbor);
+                    }
+                }
+            }
+            if (triangleTotal == MESHLET_MAX_TRIANGLES)
+                break;
+
+            // the candidate adding the fewest vertices, facing closest to the meshlet and nearest its center
+            float normalLength = glm::length(normalSum);
+            glm::vec3 axis = normalLength > 0.0f ? normalSum / normalLength : glm::vec3(0.0f);
+            glm::vec3 center = centroidSum / static_cast<float>(triangleTotal);
+            float bestScore = INFINITY;
+            next = NONE;
+            for (size_t c = 0; c < candidates.size();)
+            {
+                uint32_t triangle = candidates[c];
+                if (assigned[triangle])
+                {
+                    candidates[c] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                c++;
+                unsigned int added = 0;
+                for (int corner = 0; corner < 3; corner++)
+                    added += vertexMeshlet[indices[triangle * 3 + corner]] != id;
+                if (vertexTotal + added > MESHLET_MAX_VERTICES)
+                    continue;
+                float score = added + CONE_WEIGHT * (1.0f - glm::dot(normals[triangle], axis)) +
+                              DISTANCE_WEIGHT * glm::length(centroids[triangle] - center) / (extent + 1e-6f);
+                if (score < bestScore)
+                {
+                    bestScore = score;
+                    next = triangle;
+                }
+            }
+        }
+        meshlet.indexCount = static_cast<uint32_t>(ordered.size() - meshlet.firstIndex);
+        detail::optimizeMeshletTriangles(ordered.data() + meshlet.firstIndex, meshlet.indexCount);
+        detail::computeMeshletBounds(vertices, ordered.data() + meshlet.firstIndex, meshlet);
+        meshlets.push_back(meshlet);
+    }
+}
+
+// the view a frame's meshlets are culled against, in the model space of the object they belong to. model matrices
+// are taken to be rotations, translations and uniform scales, which keep the normal cones valid.
+struct MeshletView
+{
+    Frustum frustum;
+    glm::vec3 camera;
+    // clip space w, the view depth, is dot(depthRow, (position, 1))
+    glm::vec4 depthRow;
+    // model units to world units
+    float scale;
+    // pixels a world unit at depth 1 covers on screen, 0 to keep small meshlets
+    float pixelsPerUnit;
+    // 1 if back faces are culled, -1 for front faces, 0 if both sides are drawn
+    float culledSide;
+
+    static MeshletView From(const glm::mat4 &view, const glm::mat4 &projection, const glm::mat4 &model,
+                            int viewportHeight, GLenum culledFace)
+    {
+        MeshletView result;
+        glm::mat4 modelViewProjection = projection * view * model;
+        result.frustum = Frustum::FromMatrix(modelViewProjection);
+        result.camera = glm::vec3(glm::inverse(view * model)[3]);
+        result.depthRow = glm::vec4(modelViewProjection[0][3], modelViewProjection[1][3], modelViewProjection[2][3],
+                                    modelViewProjection[3][3]);
+        result.scale = std::max(glm::length(glm::vec3(model[0])),
+                                std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        result.pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+        result.culledSide = culledFace == GL_BACK ? 1.0f : culledFace == GL_FRONT ? -1.0f : 0.0f;
+        return result;
+    }
+};
+
+// meshlets tested and culled (by frustum, facing and size), and triangles submitted, reset by the application
+struct MeshletStats
+{
+    unsigned long tested = 0;
+    unsigned long culled = 0;
+    unsigned long triangles = 0;
+    unsigned long trianglesBefore = 0;
+
+    static MeshletStats &Global()
+    {
+        static MeshletStats stats;
+        return stats;
+    }
+};
+
+// false if the meshlet is outside the frustum, shows only culled faces, or is too small to cover a pixel
+inline bool MeshletVisible(const Meshlet &meshlet, const MeshletView &view)
+{
+    for (const glm::vec4 &plane : view.frustum.planes)
+        if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius)
+            return false;
+
+    // every triangle faces the culled side if each direction from the camera into the sphere is within 90 degrees
+    // minus the cone's half angle of the (signed) axis
+    glm::vec3 toCenter = meshlet.center - view.camera;
+    float distance = glm::length(toCenter);
+    if (view.culledSide * glm::dot(toCenter, meshlet.coneAxis) >=
+        meshlet.coneCutoff * distance + meshlet.radius * (1.0f + meshlet.coneCutoff))
+        return false;
+
+    float radius = meshlet.radius * view.scale;
+    float depth = glm::dot(view.depthRow, glm::vec4(meshlet.center, 1.0f));
+    if (view.pixelsPerUnit > 0.0f && depth > radius &&
+        2.0f * radius * view.pixelsPerUnit < MESHLET_MIN_PIXELS * (depth - radius))
+        return false;
+    return true;
+}
+#endif
@@ -10,18 +10,37 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <learnopengl/frustum.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/indirect_renderer.h>
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/obj_loader.h>
+#include <learnopengl/render_queue.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/shader_permutations.h>
+#include <learnopengl/scene_archive.h>
+#include <learnopengl/software_occlusion.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
 
+#include <algorithm>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false, TextureLoader *loader = nullptr,
+                             TextureEncoding encoding = TextureEncoding::Raw);
+unsigned int TextureFromArchive(const SceneArchive &archive, const ArchiveTexture &texture);
+
+// the face GL culls when drawing models: their visible sides wind clockwise. import orders triangles against
+// overdraw for it.
+const GLenum MODEL_CULLED_FACE = GL_FRONT;
 
 
 
@@ -29,51 +48,521 @@ class Model
 {
 public:
     // model data
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// the textures this model holds a reference to in TextureRegistry::Global(), each once
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    // if an opened scene archive contains the model it is uploaded straight from the archive, otherwise the file is imported with ASSIMP.
+    // with a texture loader the material images are decoded in the background and arrive with its Update()/Finish().
+    Model(string const &path, bool gamma = false, const SceneArchive *archive = nullptr, TextureLoader *textureLoader = nullptr)
+        : gammaCorrection(gamma), textureLoader(textureLoader)
+    {
+        if (archive == nullptr || !loadFromArchive(*archive, path))
+            loadModel(path);
+    }
+
+    // textures are shared through the registry, copies would release them twice
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+
+    ~Model()
     {
-        loadModel(path);
+        for (const Texture &texture : textures_loaded)
+            TextureRegistry::Global().Release(texture.id);
     }
 
-    // draws the model, and thus all its meshes
+    // draws the model, and thus all its meshes: one glMultiDrawElementsBaseVertex per material, all from the
+    // arena VAO. meshes that are still streaming in are skipped.
     void Draw(Shader &shader)
     {
-        for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+        drawBatches([&](const Mesh &) -> Shader & { return shader; });
+    }
+
+    // draws each material with its permutation: the given features, plus NORMAL_MAP for materials with a normal map
+    // if that permutation was required. the permutations are bound here, their shared uniforms set by the caller.
+    void Draw(ShaderPermutations &permutations, unsigned int features, unsigned int numLights = 1)
+    {
+        drawPermutations(permutations, features, numLights, 0, 0);
+    }
+
+    // draws instanceCount copies of the model with the INSTANCED permutations of the features, each copy with its
+    // own transform from the instance attributes of vao (InstanceCuller::VAO). GL 3.3 has no instanced multi-draw,
+    // so this is a glDrawElementsInstancedBaseVertex per mesh.
+    void DrawInstanced(ShaderPermutations &permutations, unsigned int features, GLuint vao, GLsizei instanceCount,
+                       unsigned int numLights = 1)
+    {
+        if (instanceCount > 0)
+            drawPermutations(permutations, features | SHADER_INSTANCED, numLights, vao, instanceCount);
     }
 
+    // queues one item per material for queue.Draw, with the object's uniforms and only the meshes whose bounds
+    // intersect the view frustum (or that the object's visibility marks). a material is translucent if it or the object is not fully opaque.
+    void Submit(RenderQueue &queue, uint32_t object, Shader &shader, RenderPass pass = RenderPass::Scene)
+    {
+        submitBatches(queue, object, pass, [&](const Mesh &) { return &shader; });
+    }
+
+    // like Draw(permutations, ...), each material with its permutation
+    void Submit(RenderQueue &queue, uint32_t object, ShaderPermutations &permutations, unsigned int features,
+                unsigned int numLights = 1)
+    {
+        Shader *plain = permutations.Find(features, numLights);
+        Shader *normalMapped = permutations.Find(features | SHADER_NORMAL_MAP, numLights);
+        if (!plain)
+            plain = normalMapped;
+        if (!plain)
+            return;
+        submitBatches(queue, object, RenderPass::Scene, [&](const Mesh &mesh) {
+            return normalMapped && mesh.HasTexture(TextureType::Normal) ? normalMapped : plain;
+        });
+    }
+
+    // adds the resident opaque meshes to the multi-draw-indirect tier as meshes of object, each material with its
+    // permutation of programs compiled with INDIRECT. culling and grouping are the renderer's. meshes whose material
+    // is not fully opaque are left out: they have to be blended after everything opaque, so they go through a
+    // RenderQueue with a visibility that only has them.
+    void SubmitIndirect(IndirectRenderer &renderer, uint32_t object, ShaderPermutations &permutations,
+                        unsigned int features, unsigned int numLights = 1)
+    {
+        Shader *plain = permutations.Find(features, numLights);
+        Shader *normalMapped = permutations.Find(features | SHADER_NORMAL_MAP, numLights);
+        if (!plain)
+            plain = normalMapped;
+        if (!plain)
+            return;
+        for (const Mesh &mesh : meshes)
+        {
+            if (!mesh.resident || mesh.material.opacity < 1.0f)
+                continue;
+            Shader *shader = normalMapped && mesh.HasTexture(TextureType::Normal) ? normalMapped : plain;
+            renderer.AddMesh(mesh, object, *shader, materialUniforms);
+        }
+    }
+
+    // draw calls Draw issues, one per material
+    size_t DrawCalls()
+    {
+        if (batchesDirty)
+            buildBatches();
+        return batches.size();
+    }
+
+    // the material uniforms are looked up as prefix + texture_diffuse1, prefix + shininess, ...
     void SetShaderTextureNamePrefix(std::string prefix) {
-        for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+        materialUniforms = MaterialUniforms(prefix);
+    }
+
+    // true once every mesh is uploaded and has all its textures
+    bool IsResident() const
+    {
+        return resident;
+    }
+
+    // bounds of the meshes that cannot be drawn yet, see ModelLoader::DrawPlaceholders
+    const vector<AABB> &Placeholders() const
+    {
+        return placeholders;
+    }
+
+    // keeps the positions and indices of the meshes added from now on that can hide others for SoftwareOcclusion:
+    // the largest side of the mesh is at least minRelativeSize of the model's, and it has at most maxTriangles
+    void KeepOccluders(size_t maxTriangles, float minRelativeSize = 0.1f)
+    {
+        occluderTriangles = maxTriangles;
+        occluderRelativeSize = minRelativeSize;
+    }
+
+    const vector<OccluderGeometry> &Occluders() const
+    {
+        return occluders;
+    }
+
+    // reads a model file into CPU-side mesh data, OBJ files with the native parser (see obj_loader.h) and everything
+    // else with ASSIMP. nothing is uploaded, so this also works without a GL context (hangar_bake). the OBJ parser
+    // splits its work over pool, which may be the one this runs on.
+    static bool Import(string const &path, vector<MeshData> &meshes, ThreadPool *pool = nullptr)
+    {
+        size_t first = meshes.size();
+        if (!isOBJ(path) || !LoadOBJ(path, meshes, pool))
+        {
+            // read file via ASSIMP
+            Assimp::Importer importer;
+            const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+            // check for errors
+            if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+            {
+                cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+                return false;
+            }
+
+            // process ASSIMP's root node recursively
+            processNode(scene->mRootNode, scene, meshes);
         }
+
+        // weld the per-corner vertices and reorder for the vertex cache, overdraw and vertex fetch
+        for (size_t i = first; i < meshes.size(); i++)
+        {
+            MeshData &mesh = meshes[i];
+            MeshOptimizationStats stats = OptimizeMesh(mesh.vertices, mesh.indices, MODEL_CULLED_FACE);
+            cout << "MESH::OPTIMIZE:: " << path << " [" << mesh.name << "] vertices " << stats.verticesBefore << " -> " << stats.verticesAfter
+                 << ", ACMR " << stats.acmrBefore << " -> " << stats.acmrAfter << endl;
+        }
+        return true;
     }
+
 private:
+    // streamed models are created empty and filled in over several frames by the loader
+    friend class ModelLoader;
+
+    TextureLoader *textureLoader;
+    MaterialUniforms materialUniforms;
+    bool resident = true;
+    vector<AABB> placeholders;
+    // the model's bounds. meshes at least 1/SHARED_QUANTIZATION of its size are quantized to them, so meshes of one
+    // material can be drawn together: their positions are off by at most 1/2048 of their own size. smaller ones
+    // keep their own bounds and the precision 16 bits give them.
+    static const int SHARED_QUANTIZATION = 64;
+    AABB quantization;
+    // meshes grouped by material, rebuilt when meshes are added or become resident
+    struct Batch
+    {
+        size_t firstMesh;
+        uint32_t material;      // RenderMaterialId
+        AABB bounds;
+        GLenum indexType;
+        vector<GLsizei> counts;
+        vector<const void *> offsets;
+        vector<GLint> baseVertices;
+        vector<uint32_t> meshIndices;
+    };
+    vector<Batch> batches;
+    bool batchesDirty = true;
+    // bounds of every mesh, by mesh index, and which of them the last Submit found in the frustum
+    BoundingVolumes volumes;
+    vector<uint8_t> visibility;
+    // texture path (archive texture index) -> GL texture, so each is acquired from the registry once per model
+    unordered_map<string, unsigned int> fileTextures;
+    map<uint32_t, unsigned int> archiveTextures;
+    // CPU copies of the occluder meshes, see KeepOccluders
+    vector<OccluderGeometry> occluders;
+    size_t occluderTriangles = 0;
+    float occluderRelativeSize = 0.0f;
+
+    Model(string const &path, TextureLoader *textureLoader)
+        : directory(path.substr(0, path.find_last_of('/'))), gammaCorrection(false), textureLoader(textureLoader), resident(false)
+    {
+    }
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-        {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+        vector<MeshData> data;
+        if (!Import(path, data))
             return;
-        }
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        vector<AABB> bounds;
+        for (MeshData &mesh : data)
+            bounds.push_back(ComputeBounds(mesh.vertices.data(), mesh.vertices.size()));
+        setQuantization(bounds);
+        for (MeshData &mesh : data)
+            addMesh(mesh);
+    }
+
+    // uploads a baked model straight from the memory mapped archive: no ASSIMP and no image decoding.
+    bool loadFromArchive(const SceneArchive &archive, string const &path)
+    {
+        const ArchiveModel *model = archive.FindModel(path);
+        if (model == nullptr)
+            return false;
+        directory = path.substr(0, path.find_last_of('/'));
+
+        vector<AABB> bounds;
+        for (uint32_t i = 0; i < model->meshCount; i++)
+        {
+            const ArchiveMesh &mesh = archive.GetMesh(model->firstMesh + i);
+            bounds.push_back(ComputeBounds(static_cast<const Vertex *>(archive.Bytes(mesh.vertexOffset)), mesh.vertexCount));
+        }
+        setQuantization(bounds);
+        for (uint32_t i = 0; i < model->meshCount; i++)
+            addMesh(archive, archive.GetMesh(model->firstMesh + i));
+        return true;
+    }
+
+    void setQuantization(const vector<AABB> &meshBounds)
+    {
+        if (meshBounds.empty())
+            return;
+        quantization = meshBounds[0];
+        for (const AABB &bounds : meshBounds)
+            quantization = MergeBounds(quantization, bounds);
+    }
+
+    // the box a mesh of these bounds is quantized to, null for its own (see SHARED_QUANTIZATION)
+    const AABB *quantizationFor(const AABB &bounds) const
+    {
+        glm::vec3 size = bounds.max - bounds.min, modelSize = quantization.max - quantization.min;
+        float largest = std::max(size.x, std::max(size.y, size.z));
+        float modelLargest = std::max(modelSize.x, std::max(modelSize.y, modelSize.z));
+        return largest * SHARED_QUANTIZATION >= modelLargest ? &quantization : nullptr;
+    }
+
+    // Draw and DrawInstanced with permutations; an instanceVAO of 0 draws the model once from the arena VAO
+    void drawPermutations(ShaderPermutations &permutations, unsigned int features, unsigned int numLights, GLuint instanceVAO,
+                          GLsizei instanceCount)
+    {
+        Shader *plain = permutations.Find(features, numLights);
+        Shader *normalMapped = permutations.Find(features | SHADER_NORMAL_MAP, numLights);
+        if (!plain)
+            plain = normalMapped;
+        if (!plain)
+            return;
+        Shader *bound = nullptr;
+        drawBatches([&](const Mesh &mesh) -> Shader & {
+            Shader *shader = normalMapped && mesh.HasTexture(TextureType::Normal) ? normalMapped : plain;
+            if (shader != bound)
+            {
+                shader->use();
+                bound = shader;
+            }
+            return *shader;
+        }, instanceVAO, instanceCount);
+    }
+
+    // groups the resident meshes by material (textures, sampler types and constants), index type and quantization
+    // one glMultiDrawElementsBaseVertex per batch, with the shader shaderFor(first mesh of the batch) returns. with
+    // an instanceVAO every mesh of the batch is drawn instanceCount times from that VAO instead.
+    template <typename ShaderFor>
+    void drawBatches(ShaderFor shaderFor, GLuint instanceVAO = 0, GLsizei instanceCount = 0)
+    {
+        if (batchesDirty)
+            buildBatches();
+        for (const Batch &batch : batches)
+        {
+            const Mesh &first = meshes[batch.firstMesh];
+            Shader &shader = shaderFor(first);
+            first.BindMaterial(shader, materialUniforms);
+            first.SetVertexFormatUniforms(shader);
+            if (instanceVAO != 0)
+            {
+                GLState::Get().BindVertexArray(instanceVAO);
+                for (size_t i = 0; i < batch.counts.size(); i++)
+                    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, batch.counts[i], batch.indexType, batch.offsets[i], instanceCount,
+                                                      batch.baseVertices[i]);
+                continue;
+            }
+            GLState::Get().BindVertexArray(first.VAO);
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, batch.counts.data(), batch.indexType, batch.offsets.data(), batch.counts.size(),
+                                          batch.baseVertices.data());
+        }
+    }
+
+    template <typename ShaderFor>
+    void submitBatches(RenderQueue &queue, uint32_t object, RenderPass pass, ShaderFor shaderFor)
+    {
+        if (batchesDirty)
+            buildBatches();
+        const RenderObject &placement = queue.Object(object);
+        const uint8_t *visible = placement.visibility;
+        if (!visible)
+        {
+            visibility.resize(volumes.PaddedSize());
+            volumes.Cull(Frustum::FromMatrix(queue.ViewProjection() * placement.model), visibility.data());
+            visible = visibility.data();
+        }
+        CullingStats &culling = CullingStats::Global();
+        MeshletView meshletView;
+        if (placement.cullMeshlets)
+            meshletView = queue.MeshletViewFor(object);
+        for (const Batch &batch : batches)
+        {
+            for (size_t i = 0; i < batch.meshIndices.size(); i++)
+            {
+                culling.tested++;
+                if (!visible[batch.meshIndices[i]])
+                    continue;
+                culling.visible++;
+                if (placement.cullMeshlets)
+                    addMeshletDraws(queue, meshes[batch.meshIndices[i]], meshletView);
+                else
+                    queue.AddDraw(batch.counts[i], batch.offsets[i], batch.baseVertices[i]);
+            }
+            const Mesh &first = meshes[batch.firstMesh];
+            RenderItem item;
+            item.shader = shaderFor(first);
+            item.material = &first;
+            item.materialUniforms = &materialUniforms;
+            item.vao = first.VAO;
+            item.indexType = batch.indexType;
+            item.object = object;
+            glm::vec3 center = glm::vec3(placement.model * glm::vec4((batch.bounds.min + batch.bounds.max) * 0.5f, 1.0f));
+            bool translucent = placement.opacity < 1.0f || first.material.opacity < 1.0f;
+            queue.Submit(pass, translucent, batch.material, center, item);
+        }
+    }
+
+    // draws the meshlets of the mesh that pass MeshletVisible, consecutive ones merged into one range
+    static void addMeshletDraws(RenderQueue &queue, const Mesh &mesh, const MeshletView &view)
+    {
+        MeshletStats &stats = MeshletStats::Global();
+        size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+        auto addRange = [&](size_t first, size_t end) {
+            queue.AddDraw(static_cast<GLsizei>(end - first), reinterpret_cast<const void *>(mesh.indexOffset + first * indexSize),
+                          mesh.baseVertex);
+        };
+        bool open = false;
+        size_t rangeStart = 0, rangeEnd = 0;
+        for (const Meshlet &meshlet : mesh.meshlets)
+        {
+            stats.tested++;
+            stats.trianglesBefore += meshlet.indexCount / 3;
+            if (!MeshletVisible(meshlet, view))
+            {
+                stats.culled++;
+                continue;
+            }
+            stats.triangles += meshlet.indexCount / 3;
+            if (open && meshlet.firstIndex != rangeEnd)
+            {
+                addRange(rangeStart, rangeEnd);
+                open = false;
+            }
+            if (!open)
+            {
+                rangeStart = meshlet.firstIndex;
+                open = true;
+            }
+            rangeEnd = meshlet.firstIndex + meshlet.indexCount;
+        }
+        if (open)
+            addRange(rangeStart, rangeEnd);
+    }
+
+    void buildBatches()
+    {
+        batches.clear();
+        unordered_map<string, size_t> byMaterial;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            const Mesh &mesh = meshes[i];
+            if (!mesh.resident)
+                continue;
+            string key(reinterpret_cast<const char *>(&mesh.quantization), sizeof(AABB));
+            key += std::to_string(mesh.indexType);
+            string material(reinterpret_cast<const char *>(&mesh.material), sizeof(MaterialConstants));
+            for (const Texture &texture : mesh.textures)
+                material += ' ' + std::to_string(texture.id) + ':' + std::to_string(static_cast<unsigned int>(texture.type));
+            key += material;
+
+            auto found = byMaterial.find(key);
+            if (found == byMaterial.end())
+            {
+                found = byMaterial.emplace(key, batches.size()).first;
+                Batch batch;
+                batch.firstMesh = i;
+                batch.material = RenderMaterialId(material);
+                batch.bounds = mesh.bounds;
+                batch.indexType = mesh.indexType;
+                batches.push_back(batch);
+            }
+            Batch &batch = batches[found->second];
+            batch.bounds = MergeBounds(batch.bounds, mesh.bounds);
+            batch.counts.push_back(mesh.indexCount);
+            batch.offsets.push_back(reinterpret_cast<const void *>(mesh.indexOffset));
+            batch.baseVertices.push_back(mesh.baseVertex);
+            batch.meshIndices.push_back(static_cast<uint32_t>(i));
+        }
+        batchesDirty = false;
+    }
+
+    // resolves the mesh's textures and uploads it
+    Mesh &addMesh(MeshData &data)
+    {
+        for (Texture &texture : data.textures)
+            texture.id = loadTexture(texture);
+        AABB bounds = ComputeBounds(data.vertices.data(), data.vertices.size());
+        meshes.push_back(Mesh(data.vertices, data.indices, data.textures, data.material, quantizationFor(bounds)));
+        volumes.Add(meshes.back().bounds.min, meshes.back().bounds.max, meshes.back().radius);
+        keepOccluder(data.vertices.data(), data.indices.data(), data.indices.size());
+        batchesDirty = true;
+        return meshes.back();
+    }
+
+    Mesh &addMesh(const SceneArchive &archive, const ArchiveMesh &mesh)
+    {
+        vector<Texture> textures;
+        for (uint32_t j = 0; j < mesh.textureRefCount; j++)
+        {
+            const ArchiveTextureRef &ref = archive.GetTextureRef(mesh.firstTextureRef + j);
+            Texture texture;
+            texture.type = static_cast<TextureType>(ref.type);
+            texture.path = archive.String(archive.GetTexture(ref.texture).path);
+            auto uploaded = archiveTextures.find(ref.texture);
+            if (uploaded == archiveTextures.end())
+            {
+                const ArchiveTexture &stored = archive.GetTexture(ref.texture);
+                texture.id = TextureRegistry::Global().Acquire(texture.path, TextureEncodingFor(texture.type),
+                                                               [&] { return TextureFromArchive(archive, stored); });
+                archiveTextures[ref.texture] = texture.id;
+                textures_loaded.push_back(texture);
+            }
+            else
+            {
+                texture.id = uploaded->second;
+            }
+            textures.push_back(texture);
+        }
+        const Vertex *vertices = static_cast<const Vertex *>(archive.Bytes(mesh.vertexOffset));
+        AABB bounds = ComputeBounds(vertices, mesh.vertexCount);
+        meshes.push_back(Mesh(vertices, mesh.vertexCount, static_cast<const unsigned int *>(archive.Bytes(mesh.indexOffset)),
+                              mesh.indexCount, textures, ToMaterialConstants(mesh.material), quantizationFor(bounds)));
+        volumes.Add(meshes.back().bounds.min, meshes.back().bounds.max, meshes.back().radius);
+        keepOccluder(static_cast<const Vertex *>(archive.Bytes(mesh.vertexOffset)),
+                     static_cast<const unsigned int *>(archive.Bytes(mesh.indexOffset)), mesh.indexCount);
+        batchesDirty = true;
+        return meshes.back();
+    }
+
+    // copies the last added mesh for the software rasterizer if it qualifies as an occluder, only the vertices its
+    // indices use
+    void keepOccluder(const Vertex *vertices, const unsigned int *indices, size_t indexCount)
+    {
+        if (indexCount / 3 > occluderTriangles)
+            return;
+        glm::vec3 size = meshes.back().bounds.max - meshes.back().bounds.min;
+        glm::vec3 modelSize = quantization.max - quantization.min;
+        float largest = std::max(size.x, std::max(size.y, size.z));
+        if (largest < occluderRelativeSize * std::max(modelSize.x, std::max(modelSize.y, modelSize.z)))
+            return;
+
+        OccluderGeometry occluder;
+        occluder.mesh = static_cast<uint32_t>(meshes.size() - 1);
+        unordered_map<unsigned int, uint32_t> remap;
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            auto inserted = remap.insert(std::make_pair(indices[i], static_cast<uint32_t>(occluder.positions.size())));
+            if (inserted.second)
+                occluder.positions.push_back(vertices[indices[i]].Position);
+            occluder.indices.push_back(inserted.first->second);
+        }
+        occluders.push_back(std::move(occluder));
+    }
+
+    static bool isOBJ(const string &path)
+    {
+        size_t dot = path.find_last_of('.');
+        if (dot == string::npos)
+            return false;
+        string extension = path.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        return extension == "obj";
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    static void processNode(aiNode *node, const aiScene *scene, vector<MeshData> &meshes)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -86,22 +575,23 @@ private:
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, meshes);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    static MeshData processMesh(aiMesh *mesh, const aiScene *scene)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
-
+        MeshData data;
+        data.name = mesh->mName.C_Str();
+        vector<Vertex> &vertices = data.vertices;
+        vector<unsigned int> &indices = data.indices;
+        vector<Texture> &textures = data.textures;
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
+            Vertex vertex = {}; // zeroed, attributes the file doesn't have must not break welding
             glm::vec3 vector; // we declare a placeholder vector since assimp_ uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
             // positions
             vector.x = mesh->mVertices[i].x;
@@ -159,65 +649,110 @@ private:
         // diffuse: texture_diffuseN
         // specular: texture_specularN
         // normal: texture_normalN
+        MaterialConstants &constants = data.material;
         aiColor3D color(0.0f, 0.0f, 0.0f);
-        material->Get(AI_MATKEY_COLOR_AMBIENT, color);
-
+        if (material->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS)
+            constants.diffuse = glm::vec3(color.r, color.g, color.b);
+        if (material->Get(AI_MATKEY_COLOR_SPECULAR, color) == AI_SUCCESS)
+            constants.specular = glm::vec3(color.r, color.g, color.b);
+        if (material->Get(AI_MATKEY_COLOR_EMISSIVE, color) == AI_SUCCESS)
+            constants.emissive = glm::vec3(color.r, color.g, color.b);
+        material->Get(AI_MATKEY_SHININESS, constants.shininess);
+        material->Get(AI_MATKEY_OPACITY, constants.opacity);
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, TextureType::Diffuse);
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, TextureType::Specular);
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, TextureType::Normal);
         textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, TextureType::Height);
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
 
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return the extracted mesh data, textures are resolved when the mesh is uploaded
+        return data;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // collects all material textures of a given type. only the references are gathered here, the images are loaded
+    // when the mesh is uploaded (see loadTexture).
+    static vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, TextureType typeName)
     {
         vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            Texture texture;
+            texture.id = 0;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
         }
         return textures;
     }
+
+    // loads the texture if it isn't loaded yet and returns its GL id. textures other models (or other files with the
+    // same contents) already loaded are shared through the registry.
+    unsigned int loadTexture(const Texture &reference)
+    {
+        auto loaded = fileTextures.find(reference.path);
+        if (loaded != fileTextures.end())
+            return loaded->second;
+
+        TextureEncoding encoding = TextureEncodingFor(reference.type);
+        Texture texture = reference;
+        texture.id = TextureRegistry::Global().AcquireFile(directory + '/' + reference.path, encoding, [&] {
+            return TextureFromFile(reference.path.c_str(), directory, gammaCorrection, textureLoader, encoding);
+        });
+        fileTextures[reference.path] = texture.id;
+        textures_loaded.push_back(texture);
+        return texture.id;
+    }
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+// uploads a pre-mipped texture from a scene archive, every level goes to glTexImage2D (or glCompressedTexImage2D
+// for block-compressed textures) as it is stored.
+unsigned int TextureFromArchive(const SceneArchive &archive, const ArchiveTexture &texture)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    GLState::Get().ActiveTexture(0);
+    GLState::Get().BindTexture(0, GL_TEXTURE_2D, textureID);
+
+    // mip levels of RGB images are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t level = 0; level < texture.levelCount; level++)
+    {
+        const ArchiveLevel &data = archive.GetLevel(texture.firstLevel + level);
+        if (texture.format == 0)
+            UploadCompressedLevel(GL_TEXTURE_2D, level, texture.internalFormat, data.width, data.height, archive.Bytes(data.offset), data.size);
+        else
+            glTexImage2D(GL_TEXTURE_2D, level, texture.internalFormat, data.width, data.height, 0, texture.format, GL_UNSIGNED_BYTE, archive.Bytes(data.offset));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (texture.levelCount > 0)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levelCount - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return textureID;
+}
+
+// creates the texture object and fills it. with a loader the image is only queued for decoding on its worker
+// threads and uploaded later on the GL thread, so the returned id can be used right away but stays empty until then.
+// block-compressed encodings come with their mip chain from the KTX cache; BC1 falls back to the raw image
+// when the driver has no S3TC.
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma, TextureLoader *loader, TextureEncoding encoding)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
@@ -225,33 +760,39 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
+    GLState::Get().ActiveTexture(0);
+    GLState::Get().BindTexture(0, GL_TEXTURE_2D, textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    if (encoding == TextureEncoding::BC1 && !HasS3TCSupport())
+        encoding = TextureEncoding::Raw;
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (loader != nullptr)
+    {
+        loader->Enqueue(textureID, GL_TEXTURE_2D, filename, true, true, encoding);
+        return textureID;
+    }
 
-        stbi_image_free(data);
+    CompressedTexture compressed;
+    Image image;
+    if (encoding != TextureEncoding::Raw)
+    {
+        if (LoadCompressedTexture(filename, encoding, true, compressed))
+            UploadCompressedTexture(GL_TEXTURE_2D, compressed);
+        else
+            std::cout << "Texture failed to load at path: " << path << std::endl;
+    }
+    else if (LoadImageFile(filename, image, true))
+    {
+        UploadImage(GL_TEXTURE_2D, image);
+        glGenerateMipmap(GL_TEXTURE_2D);
     }
     else
     {
         std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
     }
 
     return textureID;
@@ -0,0 +1,227 @@
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/model.h>
+#include <learnopengl/scene_archive.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/thread_pool.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef std::shared_ptr<Model> ModelHandle;
+
+// asynchronous model loading. Load() returns a handle to an empty model right away, the file is imported on a worker
+// thread and the meshes are uploaded a few at a time from Update(), which the render loop calls once per frame with a
+// time budget. a mesh is drawn by Model::Draw once it and all its textures are resident; until then its bounds can be
+// drawn as a flat-shaded proxy with DrawPlaceholders().
+class ModelLoader
+{
+public:
+    // the archive, if given, has to stay open until Idle() returns true
+    ModelLoader(TextureLoader &textures, const SceneArchive *archive = nullptr, unsigned int threadCount = 0)
+        : textures(textures), archive(archive), importers(threadCount)
+    {
+        createPlaceholderCube();
+    }
+
+    ~ModelLoader()
+    {
+        GLState::Get().DeleteVertexArray(cubeVAO);
+        GLState::Get().DeleteBuffer(cubeVBO);
+    }
+
+    ModelLoader(const ModelLoader &) = delete;
+    ModelLoader &operator=(const ModelLoader &) = delete;
+
+    ModelHandle Load(const string &path)
+    {
+        ModelHandle model(new Model(path, &textures));
+        std::shared_ptr<Stream> stream = std::make_shared<Stream>();
+        stream->model = model;
+        stream->path = path;
+        stream->archived = archive ? archive->FindModel(path) : nullptr;
+
+        if (stream->archived)
+        {
+            // already baked, nothing to import: the meshes are mapped and only wait for their upload
+            for (uint32_t i = 0; i < stream->archived->meshCount; i++)
+            {
+                const ArchiveMesh &mesh = archive->GetMesh(stream->archived->firstMesh + i);
+                stream->bounds.push_back(ComputeBounds(static_cast<const Vertex *>(archive->Bytes(mesh.vertexOffset)), mesh.vertexCount));
+            }
+            stream->ready = true;
+        }
+        else
+        {
+            importers.Submit([this, stream] {
+                stream->failed = !Model::Import(stream->path, stream->meshes, &importers);
+                for (const MeshData &mesh : stream->meshes)
+                    stream->bounds.push_back(ComputeBounds(mesh.vertices.data(), mesh.vertices.size()));
+                stream->ready.store(true, std::memory_order_release);
+            });
+        }
+        streams.push_back(stream);
+        return model;
+    }
+
+    // uploads decoded textures and imported meshes until budgetSeconds is used up (at least one mesh per model
+    // that has any waiting), then updates which meshes are resident. call it from the GL thread once per frame.
+    void Update(double budgetSeconds)
+    {
+        auto start = std::chrono::steady_clock::now();
+        textures.Update(budgetSeconds * 0.5);
+
+        for (size_t s = 0; s < streams.size();)
+        {
+            Stream &stream = *streams[s];
+            if (!stream.ready.load(std::memory_order_acquire))
+            {
+                s++;
+                continue;
+            }
+            Model &model = *stream.model;
+            size_t count = stream.bounds.size();
+            if (stream.next == 0)
+                model.setQuantization(stream.bounds);
+            while (stream.next < count)
+            {
+                Mesh &mesh = stream.archived ? model.addMesh(*archive, archive->GetMesh(stream.archived->firstMesh + stream.next))
+                                             : model.addMesh(stream.meshes[stream.next]);
+                mesh.resident = false;
+                if (!stream.archived)
+                    stream.meshes[stream.next] = MeshData();   // the GL buffers hold it now
+                stream.next++;
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                if (elapsed.count() >= budgetSeconds)
+                    break;
+            }
+
+            // a mesh becomes resident once none of its textures waits for an image anymore
+            model.placeholders.clear();
+            for (Mesh &mesh : model.meshes)
+            {
+                if (!mesh.resident)
+                {
+                    mesh.resident = true;
+                    for (const Texture &texture : mesh.textures)
+                        if (textures.IsPending(texture.id))
+                            mesh.resident = false;
+                    if (mesh.resident)
+                        model.batchesDirty = true;
+                }
+                if (!mesh.resident)
+                    model.placeholders.push_back(mesh.bounds);
+            }
+            for (size_t i = stream.next; i < count; i++)
+                model.placeholders.push_back(stream.bounds[i]);
+
+            if (stream.failed || (stream.next == count && model.placeholders.empty()))
+            {
+                model.resident = true;
+                streams.erase(streams.begin() + s);
+            }
+            else
+            {
+                s++;
+            }
+        }
+    }
+
+    // nothing left to import, upload or decode
+    bool Idle() const
+    {
+        return streams.empty() && textures.Pending() == 0;
+    }
+
+    // the unit cube DrawPlaceholders draws with
+    unsigned int PlaceholderVAO() const
+    {
+        return cubeVAO;
+    }
+
+    // draws the bounds of every mesh of the model that is not resident yet as a flat-shaded box.
+    // the shader (placeholder.vs/fs) needs its model, view and projection matrices set by the caller.
+    void DrawPlaceholders(const Model &model, Shader &shader)
+    {
+        if (model.Placeholders().empty())
+            return;
+        GLState &state = GLState::Get();
+        state.Disable(GL_CULL_FACE);
+        state.BindVertexArray(cubeVAO);
+        for (const AABB &bounds : model.Placeholders())
+        {
+            shader.set(UNIFORM("boundsMin"), bounds.min);
+            shader.set(UNIFORM("boundsMax"), bounds.max);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+        }
+        state.Enable(GL_CULL_FACE);
+    }
+
+private:
+    struct Stream
+    {
+        ModelHandle model;
+        string path;
+        const ArchiveModel *archived = nullptr;
+        // written by the import worker before ready is set
+        vector<MeshData> meshes;
+        vector<AABB> bounds;
+        bool failed = false;
+        std::atomic<bool> ready{false};
+        // number of meshes uploaded so far
+        size_t next = 0;
+    };
+
+    TextureLoader &textures;
+    const SceneArchive *archive;
+    vector<std::shared_ptr<Stream>> streams;
+    unsigned int cubeVAO, cubeVBO;
+    // declared last so pending imports finish before the rest of the loader goes away
+    ThreadPool importers;
+
+    // unit cube with per-face normals, scaled to the bounds in the vertex shader
+    void createPlaceholderCube()
+    {
+        static const float corners[6][4][3] = {
+            {{1, 0, 0}, {1, 1, 0}, {1, 1, 1}, {1, 0, 1}},
+            {{0, 0, 1}, {0, 1, 1}, {0, 1, 0}, {0, 0, 0}},
+            {{0, 1, 0}, {0, 1, 1}, {1, 1, 1}, {1, 1, 0}},
+            {{0, 0, 1}, {0, 0, 0}, {1, 0, 0}, {1, 0, 1}},
+            {{1, 0, 1}, {1, 1, 1}, {0, 1, 1}, {0, 0, 1}},
+            {{0, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, 0, 0}},
+        };
+        static const float normals[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+        static const int quad[6] = {0, 1, 2, 0, 2, 3};
+
+        vector<float> vertices;
+        for (int face = 0; face < 6; face++)
+        {
+            for (int corner : quad)
+            {
+                vertices.insert(vertices.end(), corners[face][corner], corners[face][corner] + 3);
+                vertices.insert(vertices.end(), normals[face], normals[face] + 3);
+            }
+        }
+
+        glGenVertexArrays(1, &cubeVAO);
+        glGenBuffers(1, &cubeVBO);
+        GLState::Get().BindVertexArray(cubeVAO);
+        GLState::Get().BindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        GLState::Get().BindVertexArray(0);
+        GLState::Get().BindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+#endif
@@ -0,0 +1,735 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/thread_pool.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// native reader for Wavefront OBJ/MTL files, the format all models of the scene are in. the file is memory mapped
+// and split at line boundaries into chunks that are parsed in parallel; the meshes (one per object and material)
+// are then built in parallel as well. the result is what Model::processMesh makes of ASSIMP's import with
+// aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace, except that
+// corners with the same position, texture coordinate and normal already share a vertex.
+namespace detail
+{
+    // chunks are at least this big, splitting small files costs more than it saves
+    const size_t OBJ_MIN_CHUNK_BYTES = 256 << 10;
+
+    // face indices as parsed: >= 0 is an absolute index, OBJ_RELATIVE + i is index i counted from the first element
+    // of the chunk (negative when a relative index reaches back into an earlier chunk). after resolving, -1 marks a
+    // missing or out of range index.
+    const int64_t OBJ_MISSING = -1;
+    const int64_t OBJ_RELATIVE = int64_t(1) << 62;
+
+    struct ObjCorner
+    {
+        int64_t position;
+        int64_t texCoord;
+        int64_t normal;
+
+        bool operator==(const ObjCorner &other) const
+        {
+            return position == other.position && texCoord == other.texCoord && normal == other.normal;
+        }
+    };
+
+    struct ObjCornerHash
+    {
+        size_t operator()(const ObjCorner &corner) const
+        {
+            uint64_t hash = (uint64_t)corner.position * 0x9E3779B97F4A7C15ull ^ (uint64_t)corner.texCoord * 0xC2B2AE3D27D4EB4Full ^
+                            (uint64_t)corner.normal * 0x165667B19E3779F9ull;
+            return hash ^ (hash >> 29);
+        }
+    };
+
+    // a change of object or material, it holds for the corners from firstCorner up to the next run
+    struct ObjRun
+    {
+        size_t firstCorner;
+        std::string object;
+        std::string material;
+        bool setsObject;
+        bool setsMaterial;
+    };
+
+    struct ObjChunk
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texCoords;
+        std::vector<glm::vec3> normals;
+        std::vector<ObjCorner> corners;     // three per triangle
+        std::vector<ObjRun> runs;           // the first one inherits the state the previous chunk ends with
+        std::vector<std::string> libraries;
+        // where the chunk's elements start in the whole file
+        size_t positionBase = 0;
+        size_t texCoordBase = 0;
+        size_t normalBase = 0;
+    };
+
+    // all triangles of one object with one material
+    struct ObjGroup
+    {
+        std::string object;
+        std::string material;
+        struct Span
+        {
+            size_t chunk;
+            size_t firstCorner;
+            size_t endCorner;
+        };
+        std::vector<Span> spans;
+    };
+
+    inline bool objIsBlank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char *objSkipBlanks(const char *p, const char *end)
+    {
+        while (p < end && objIsBlank(*p))
+            p++;
+        return p;
+    }
+
+    inline bool objIsDigit(char c)
+    {
+        return (unsigned)(c - '0') < 10;
+    }
+
+    // decimal float without locale or strtod overhead: up to 19 significant digits are accumulated as an integer and
+    // scaled once by an exact power of ten, which is correctly rounded for the 6 to 9 digits exporters write.
+    // returns the end of the number, or p if there is none (value is left alone then).
+    inline const char *objParseFloat(const char *p, const char *end, float &value)
+    {
+        static const double POWERS[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        const char *start = p;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        bool any = false;
+        for (; p < end && objIsDigit(*p); p++, any = true)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+            }
+            else
+                exponent++;
+        }
+        if (p < end && *p == '.')
+        {
+            for (p++; p < end && objIsDigit(*p); p++, any = true)
+            {
+                if (digits < 19)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    digits += mantissa != 0;
+                    exponent--;
+                }
+            }
+        }
+        if (!any)
+            return start;
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char *q = p + 1;
+            bool negativeExponent = false;
+            if (q < end && (*q == '-' || *q == '+'))
+                negativeExponent = *q++ == '-';
+            if (q < end && objIsDigit(*q))
+            {
+                int e = 0;
+                for (; q < end && objIsDigit(*q); q++)
+                    e = std::min(e * 10 + (*q - '0'), 10000);
+                exponent += negativeExponent ? -e : e;
+                p = q;
+            }
+        }
+
+        double result = (double)mantissa;
+        if (exponent < 0)
+            result = exponent >= -22 ? result / POWERS[-exponent] : result * std::pow(10.0, exponent);
+        else if (exponent > 0)
+            result = exponent <= 22 ? result * POWERS[exponent] : result * std::pow(10.0, exponent);
+        value = (float)(negative ? -result : result);
+        return p;
+    }
+
+    inline const char *objParseInt(const char *p, const char *end, int64_t &value)
+    {
+        const char *start = p;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        if (p == end || !objIsDigit(*p))
+            return start;
+        int64_t result = 0;
+        for (; p < end && objIsDigit(*p); p++)
+            result = result * 10 + (*p - '0');
+        value = negative ? -result : result;
+        return p;
+    }
+
+    // OBJ indices are 1-based, or negative counting back from the last element read so far
+    inline int64_t objIndex(int64_t value, size_t chunkCount)
+    {
+        if (value > 0)
+            return value - 1;
+        if (value < 0)
+            return OBJ_RELATIVE + (int64_t)chunkCount + value;
+        return OBJ_MISSING;
+    }
+
+    inline int64_t objResolve(int64_t index, size_t base, size_t count)
+    {
+        if (index == OBJ_MISSING)
+            return -1;
+        if (index >= OBJ_RELATIVE / 2)
+            index = (int64_t)base + (index - OBJ_RELATIVE);
+        return index >= 0 && index < (int64_t)count ? index : -1;
+    }
+
+    // true if the line starts with the keyword followed by a blank or the line end; rest is set to what follows
+    inline bool objKeyword(const char *p, const char *end, const char *keyword, const char *&rest)
+    {
+        size_t length = strlen(keyword);
+        if ((size_t)(end - p) < length || memcmp(p, keyword, length) != 0)
+            return false;
+        p += length;
+        if (p < end && !objIsBlank(*p))
+            return false;
+        rest = p;
+        return true;
+    }
+
+    // names may contain blanks ("mtllib Space Station Scene.mtl"), so they run to the end of the line
+    inline std::string objRestOfLine(const char *p, const char *end)
+    {
+        p = objSkipBlanks(p, end);
+        while (end > p && objIsBlank(end[-1]))
+            end--;
+        return std::string(p, end);
+    }
+
+    inline const char *objParseVector(const char *p, const char *end, float *components, int count)
+    {
+        for (int i = 0; i < count; i++)
+            p = objParseFloat(objSkipBlanks(p, end), end, components[i]);
+        return p;
+    }
+
+    inline void objSetState(ObjChunk &chunk, const std::string *object, const std::string *material)
+    {
+        // statements between two faces only change the state of the next ones
+        if (chunk.runs.back().firstCorner != chunk.corners.size())
+            chunk.runs.push_back(ObjRun{chunk.corners.size(), "", "", false, false});
+        ObjRun &run = chunk.runs.back();
+        if (object)
+        {
+            run.object = *object;
+            run.setsObject = true;
+        }
+        if (material)
+        {
+            run.material = *material;
+            run.setsMaterial = true;
+        }
+    }
+
+    inline void objParseLine(const char *p, const char *end, ObjChunk &chunk, std::vector<ObjCorner> &polygon)
+    {
+        if (p == end)
+            return;
+        const char *rest;
+        switch (*p)
+        {
+        case 'v':
+            if (objKeyword(p, end, "v", rest))
+            {
+                glm::vec3 position(0.0f);
+                objParseVector(rest, end, &position.x, 3);
+                chunk.positions.push_back(position);
+            }
+            else if (objKeyword(p, end, "vt", rest))
+            {
+                glm::vec2 texCoord(0.0f);
+                objParseVector(rest, end, &texCoord.x, 2);
+                chunk.texCoords.push_back(texCoord);
+            }
+            else if (objKeyword(p, end, "vn", rest))
+            {
+                glm::vec3 normal(0.0f);
+                objParseVector(rest, end, &normal.x, 3);
+                chunk.normals.push_back(normal);
+            }
+            break;
+        case 'f':
+            if (objKeyword(p, end, "f", rest))
+            {
+                polygon.clear();
+                for (;;)
+                {
+                    rest = objSkipBlanks(rest, end);
+                    int64_t values[3] = {0, 0, 0};
+                    const char *next = objParseInt(rest, end, values[0]);
+                    if (next == rest)
+                        break;
+                    // v, v/vt, v//vn or v/vt/vn
+                    for (int i = 1; i < 3 && next < end && *next == '/'; i++)
+                        next = objParseInt(next + 1, end, values[i]);
+                    rest = next;
+                    polygon.push_back(ObjCorner{objIndex(values[0], chunk.positions.size()), objIndex(values[1], chunk.texCoords.size()),
+                                                objIndex(values[2], chunk.normals.size())});
+                }
+                // polygons are triangulated as fans like aiProcess_Triangulate does for convex ones
+                for (size_t i = 2; i < polygon.size(); i++)
+                {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i - 1]);
+                    chunk.corners.push_back(polygon[i]);
+                }
+            }
+            break;
+        case 'o':
+        case 'g':
+            if (objKeyword(p, end, "o", rest) || objKeyword(p, end, "g", rest))
+            {
+                std::string object = objRestOfLine(rest, end);
+                objSetState(chunk, &object, nullptr);
+            }
+            break;
+        case 'u':
+            if (objKeyword(p, end, "usemtl", rest))
+            {
+                std::string material = objRestOfLine(rest, end);
+                objSetState(chunk, nullptr, &material);
+            }
+            break;
+        case 'm':
+            if (objKeyword(p, end, "mtllib", rest))
+                chunk.libraries.push_back(objRestOfLine(rest, end));
+            break;
+        }
+    }
+
+    inline void objParseChunk(const char *p, const char *end, ObjChunk &chunk)
+    {
+        std::vector<ObjCorner> polygon;
+        chunk.runs.push_back(ObjRun{0, "", "", false, false});
+        while (p < end)
+        {
+            const char *lineEnd = static_cast<const char *>(memchr(p, '\n', end - p));
+            if (!lineEnd)
+                lineEnd = end;
+            objParseLine(objSkipBlanks(p, lineEnd), lineEnd, chunk, polygon);
+            p = lineEnd + 1;
+        }
+    }
+
+    // the file name of a texture statement, after its options (-bm 0.5, -s 1 1 1, -clamp on, ...)
+    inline std::string objTexturePath(const char *p, const char *end)
+    {
+        p = objSkipBlanks(p, end);
+        while (p < end && *p == '-')
+        {
+            const char *optionEnd = p;
+            while (optionEnd < end && !objIsBlank(*optionEnd))
+                optionEnd++;
+            std::string option(p, optionEnd);
+            p = objSkipBlanks(optionEnd, end);
+            if (option == "-blendu" || option == "-blendv" || option == "-cc" || option == "-clamp" || option == "-imfchan" || option == "-type")
+            {
+                while (p < end && !objIsBlank(*p))
+                    p++;
+                p = objSkipBlanks(p, end);
+                continue;
+            }
+            // numeric arguments, one to three of them
+            for (;;)
+            {
+                float unused;
+                const char *next = objParseFloat(p, end, unused);
+                if (next == p || (next < end && !objIsBlank(*next)))
+                    break;
+                p = objSkipBlanks(next, end);
+            }
+        }
+        return objRestOfLine(p, end);
+    }
+
+    struct ObjMaterial
+    {
+        std::vector<Texture> textures;
+        MaterialConstants constants;
+    };
+
+    // reads the texture maps of every material of an MTL file, in the order processMesh collects them and with
+    // ASSIMP's mapping of the statements: map_Kd diffuse, map_Ks specular, map_Bump normal, map_Ka height.
+    // Ns, Kd, Ks, Ke and d (or its inverse Tr) become the material constants.
+    inline bool objLoadMaterials(const std::string &path, std::unordered_map<std::string, ObjMaterial> &materials)
+    {
+        std::ifstream in(path);
+        if (!in)
+            return false;
+        static const char *const STATEMENTS[] = {"map_Kd", "map_Ks", "map_Bump", "map_bump", "bump", "map_Ka"};
+        static const int SLOTS[] = {0, 1, 2, 2, 2, 3};
+        static const TextureType TYPES[] = {TextureType::Diffuse, TextureType::Specular, TextureType::Normal, TextureType::Height};
+
+        std::vector<std::vector<Texture>> slots(4);
+        std::string name;
+        MaterialConstants constants;
+        bool open = false;
+        auto finish = [&] {
+            if (!open)
+                return;
+            ObjMaterial &material = materials[name];
+            material.constants = constants;
+            std::vector<Texture> &textures = material.textures;
+            textures.clear();
+            for (std::vector<Texture> &slot : slots)
+            {
+                textures.insert(textures.end(), slot.begin(), slot.end());
+                slot.clear();
+            }
+        };
+
+        std::string line;
+        while (std::getline(in, line))
+        {
+            const char *end = line.data() + line.size();
+            const char *p = objSkipBlanks(line.data(), end);
+            const char *rest;
+            if (objKeyword(p, end, "newmtl", rest))
+            {
+                finish();
+                name = objRestOfLine(rest, end);
+                constants = MaterialConstants();
+                open = true;
+                continue;
+            }
+            if (objKeyword(p, end, "Kd", rest))
+                objParseVector(rest, end, &constants.diffuse[0], 3);
+            else if (objKeyword(p, end, "Ks", rest))
+                objParseVector(rest, end, &constants.specular[0], 3);
+            else if (objKeyword(p, end, "Ke", rest))
+                objParseVector(rest, end, &constants.emissive[0], 3);
+            else if (objKeyword(p, end, "Ns", rest))
+                objParseFloat(objSkipBlanks(rest, end), end, constants.shininess);
+            else if (objKeyword(p, end, "d", rest))
+                objParseFloat(objSkipBlanks(rest, end), end, constants.opacity);
+            else if (objKeyword(p, end, "Tr", rest))
+            {
+                float transparency = 1.0f - constants.opacity;
+                objParseFloat(objSkipBlanks(rest, end), end, transparency);
+                constants.opacity = 1.0f - transparency;
+            }
+            for (size_t i = 0; i < sizeof(SLOTS) / sizeof(SLOTS[0]); i++)
+            {
+                if (!objKeyword(p, end, STATEMENTS[i], rest))
+                    continue;
+                Texture texture;
+                texture.id = 0;
+                texture.type = TYPES[SLOTS[i]];
+                texture.path = objTexturePath(rest, end);
+                if (!texture.path.empty())
+                    slots[SLOTS[i]].push_back(texture);
+                break;
+            }
+        }
+        finish();
+        return true;
+    }
+
+    // welds the group's corners into indexed vertices, then adds the normals the file does not have and the tangent
+    // space like aiProcess_GenSmoothNormals and aiProcess_CalcTangentSpace, before flipping V like aiProcess_FlipUVs
+    inline void objBuildMesh(const ObjGroup &group, const std::vector<ObjChunk> &chunks, const std::vector<glm::vec3> &positions,
+                             const std::vector<glm::vec2> &texCoords, const std::vector<glm::vec3> &normals, MeshData &mesh)
+    {
+        std::unordered_map<ObjCorner, unsigned int, ObjCornerHash> welded;
+        std::vector<int64_t> vertexPositions;
+        std::vector<bool> missingNormal;
+        bool anyTexCoords = false;
+        bool anyMissingNormal = false;
+        for (const ObjGroup::Span &span : group.spans)
+        {
+            const std::vector<ObjCorner> &corners = chunks[span.chunk].corners;
+            for (size_t i = span.firstCorner; i < span.endCorner; i += 3)
+            {
+                if (corners[i].position < 0 || corners[i + 1].position < 0 || corners[i + 2].position < 0)
+                    continue;
+                for (size_t k = i; k < i + 3; k++)
+                {
+                    const ObjCorner &corner = corners[k];
+                    auto inserted = welded.insert(std::make_pair(corner, (unsigned int)mesh.vertices.size()));
+                    mesh.indices.push_back(inserted.first->second);
+                    if (!inserted.second)
+                        continue;
+                    Vertex vertex = {};
+                    vertex.Position = positions[corner.position];
+                    if (corner.texCoord >= 0)
+                    {
+                        vertex.TexCoords = texCoords[corner.texCoord];
+                        anyTexCoords = true;
+                    }
+                    if (corner.normal >= 0)
+                        vertex.Normal = normals[corner.normal];
+                    else
+                        anyMissingNormal = true;
+                    mesh.vertices.push_back(vertex);
+                    vertexPositions.push_back(corner.position);
+                    missingNormal.push_back(corner.normal < 0);
+                }
+            }
+        }
+        std::vector<Vertex> &vertices = mesh.vertices;
+        const std::vector<unsigned int> &indices = mesh.indices;
+
+        if (anyMissingNormal)
+        {
+            // unit face normals summed over every corner at the same position
+            std::unordered_map<int64_t, glm::vec3> sums;
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                const glm::vec3 &p0 = vertices[indices[i]].Position;
+                glm::vec3 faceNormal = glm::cross(vertices[indices[i + 1]].Position - p0, vertices[indices[i + 2]].Position - p0);
+                float length = glm::length(faceNormal);
+                if (length == 0.0f)
+                    continue;
+                for (size_t k = i; k < i + 3; k++)
+                    if (missingNormal[indices[k]])
+                        sums[vertexPositions[indices[k]]] += faceNormal / length;
+            }
+            for (size_t v = 0; v < vertices.size(); v++)
+            {
+                if (!missingNormal[v])
+                    continue;
+                glm::vec3 sum = sums[vertexPositions[v]];
+                float length = glm::length(sum);
+                if (length > 0.0f)
+                    vertices[v].Normal = sum / length;
+            }
+        }
+
+        if (!anyTexCoords)
+            return;
+        // ASSIMP computes the tangent space before it flips the texture coordinates, so do the same
+        std::vector<glm::vec3> tangents(vertices.size(), glm::vec3(0.0f));
+        std::vector<glm::vec3> bitangents(vertices.size(), glm::vec3(0.0f));
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const Vertex &v0 = vertices[indices[i]];
+            const Vertex &v1 = vertices[indices[i + 1]];
+            const Vertex &v2 = vertices[indices[i + 2]];
+            glm::vec3 edge1 = v1.Position - v0.Position;
+            glm::vec3 edge2 = v2.Position - v0.Position;
+            float sx = v1.TexCoords.x - v0.TexCoords.x, sy = v1.TexCoords.y - v0.TexCoords.y;
+            float tx = v2.TexCoords.x - v0.TexCoords.x, ty = v2.TexCoords.y - v0.TexCoords.y;
+            float direction = (tx * sy - ty * sx) < 0.0f ? -1.0f : 1.0f;
+            // all three corners at one texture coordinate: use the default directions
+            if (sx * ty == sy * tx)
+            {
+                sx = 0.0f;
+                sy = 1.0f;
+                tx = 1.0f;
+                ty = 0.0f;
+            }
+            glm::vec3 faceTangent = (edge2 * sy - edge1 * ty) * direction;
+            glm::vec3 faceBitangent = (edge2 * sx - edge1 * tx) * direction;
+            for (size_t k = i; k < i + 3; k++)
+            {
+                // projected into each corner's tangent plane
+                const glm::vec3 &normal = vertices[indices[k]].Normal;
+                glm::vec3 tangent = faceTangent - normal * glm::dot(faceTangent, normal);
+                glm::vec3 bitangent = faceBitangent - normal * glm::dot(faceBitangent, normal);
+                float tangentLength = glm::length(tangent), bitangentLength = glm::length(bitangent);
+                if (tangentLength > 0.0f)
+                    tangents[indices[k]] += tangent / tangentLength;
+                if (bitangentLength > 0.0f)
+                    bitangents[indices[k]] += bitangent / bitangentLength;
+            }
+        }
+        for (size_t v = 0; v < vertices.size(); v++)
+        {
+            Vertex &vertex = vertices[v];
+            float tangentLength = glm::length(tangents[v]), bitangentLength = glm::length(bitangents[v]);
+            if (tangentLength > 0.0f && bitangentLength > 0.0f)
+            {
+                vertex.Tangent = tangents[v] / tangentLength;
+                vertex.Bitangent = bitangents[v] / bitangentLength;
+            }
+            else
+            {
+                // any frame around the normal
+                glm::vec3 axis = std::fabs(vertex.Normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+                vertex.Tangent = glm::normalize(glm::cross(vertex.Normal, axis));
+                vertex.Bitangent = glm::cross(vertex.Normal, vertex.Tangent);
+            }
+            vertex.TexCoords.y = 1.0f - vertex.TexCoords.y;
+        }
+    }
+}
+
+// imports an OBJ file and its material libraries into one MeshData per object and material. nothing is added to
+// meshes if the file cannot be read. the parse is split over the workers of pool and the calling thread, which may be
+// one of them; without a pool it runs on the calling thread alone.
+inline bool LoadOBJ(const std::string &path, std::vector<MeshData> &meshes, ThreadPool *pool = nullptr)
+{
+    using namespace detail;
+    auto parallelFor = [pool](size_t count, const std::function<void(size_t)> &body) {
+        if (pool)
+            pool->ParallelFor(count, body);
+        else
+            for (size_t i = 0; i < count; i++)
+                body(i);
+    };
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        std::cout << "ERROR::OBJ:: cannot read " << path << std::endl;
+        return false;
+    }
+    size_t size = st.st_size;
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        std::cout << "ERROR::OBJ:: cannot map " << path << std::endl;
+        return false;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    const char *text = static_cast<const char *>(mapping);
+
+    // chunks end after a newline, so no line is split
+    size_t threadCount = pool ? pool->Size() + 1 : 1;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, size / OBJ_MIN_CHUNK_BYTES));
+    std::vector<const char *> bounds(chunkCount + 1, text + size);
+    bounds[0] = text;
+    for (size_t i = 1; i < chunkCount; i++)
+    {
+        const char *split = std::max(text + size * i / chunkCount, bounds[i - 1]);
+        const char *newline = static_cast<const char *>(memchr(split, '\n', text + size - split));
+        bounds[i] = newline ? newline + 1 : text + size;
+    }
+    std::vector<ObjChunk> chunks(chunkCount);
+    parallelFor(chunkCount, [&](size_t i) { objParseChunk(bounds[i], bounds[i + 1], chunks[i]); });
+    munmap(mapping, size);
+
+    // concatenate the vertex data, then make the face indices absolute
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> texCoords;
+    for (ObjChunk &chunk : chunks)
+    {
+        chunk.positionBase = positions.size();
+        chunk.texCoordBase = texCoords.size();
+        chunk.normalBase = normals.size();
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+    }
+    parallelFor(chunkCount, [&](size_t i) {
+        ObjChunk &chunk = chunks[i];
+        for (ObjCorner &corner : chunk.corners)
+        {
+            corner.position = objResolve(corner.position, chunk.positionBase, positions.size());
+            corner.texCoord = objResolve(corner.texCoord, chunk.texCoordBase, texCoords.size());
+            corner.normal = objResolve(corner.normal, chunk.normalBase, normals.size());
+        }
+    });
+
+    // follow the object and material state through the chunks and collect the triangles of each combination
+    std::vector<ObjGroup> groups;
+    std::unordered_map<std::string, size_t> groupIndices;
+    std::string object = "defaultobject", material;
+    std::vector<std::string> libraries;
+    for (size_t c = 0; c < chunkCount; c++)
+    {
+        const ObjChunk &chunk = chunks[c];
+        libraries.insert(libraries.end(), chunk.libraries.begin(), chunk.libraries.end());
+        for (size_t r = 0; r < chunk.runs.size(); r++)
+        {
+            const ObjRun &run = chunk.runs[r];
+            if (run.setsObject)
+                object = run.object;
+            if (run.setsMaterial)
+                material = run.material;
+            size_t endCorner = r + 1 < chunk.runs.size() ? chunk.runs[r + 1].firstCorner : chunk.corners.size();
+            if (endCorner == run.firstCorner)
+                continue;
+            auto inserted = groupIndices.insert(std::make_pair(object + '\n' + material, groups.size()));
+            if (inserted.second)
+            {
+                groups.push_back(ObjGroup());
+                groups.back().object = object;
+                groups.back().material = material;
+            }
+            groups[inserted.first->second].spans.push_back(ObjGroup::Span{c, run.firstCorner, endCorner});
+        }
+    }
+
+    std::string directory = path.substr(0, path.find_last_of('/'));
+    std::unordered_map<std::string, detail::ObjMaterial> materials;
+    bool librariesMissing = false;
+    for (size_t i = 0; i < libraries.size(); i++)
+    {
+        if (std::find(libraries.begin(), libraries.begin() + i, libraries[i]) != libraries.begin() + i)
+            continue;
+        if (!objLoadMaterials(directory + '/' + libraries[i], materials))
+        {
+            std::cout << "ERROR::OBJ:: cannot read material library " << directory + '/' + libraries[i] << std::endl;
+            librariesMissing = true;
+        }
+    }
+    // exporters often write the name of the scene they came from, ASSIMP then tries the OBJ's own name and so do we
+    if (librariesMissing)
+    {
+        std::string fallback = path.substr(0, path.find_last_of('.')) + ".mtl";
+        if (std::find(libraries.begin(), libraries.end(), fallback.substr(directory.size() + 1)) == libraries.end() &&
+            objLoadMaterials(fallback, materials))
+            std::cout << "OBJ:: using material library " << fallback << " instead" << std::endl;
+    }
+
+    std::vector<MeshData> built(groups.size());
+    parallelFor(groups.size(), [&](size_t i) {
+        MeshData &mesh = built[i];
+        mesh.name = groups[i].object;
+        objBuildMesh(groups[i], chunks, positions, texCoords, normals, mesh);
+        auto found = materials.find(groups[i].material);
+        if (found != materials.end())
+        {
+            mesh.textures = found->second.textures;
+            mesh.material = found->second.constants;
+        }
+    });
+    for (MeshData &mesh : built)
+        if (!mesh.indices.empty())
+            meshes.push_back(std::move(mesh));
+    return true;
+}
+#endif
@@ -0,0 +1,203 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/uniforms.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// hardware occlusion culling of the meshes that survive frustum culling. after the opaque pass, the bounding box of
+// every candidate mesh is drawn without color or depth writes inside a GL_ANY_SAMPLES_PASSED query. the results are
+// only read a frame later, once GL reports them available, so the CPU never waits for the GPU; a mesh that came into
+// view is drawn a frame late in exchange. a mesh is skipped only after HIDDEN_FRAMES of its queries in a row found
+// nothing visible and drawn again as soon as one query does, so meshes at the edge of visibility do not flicker.
+//
+// glBeginConditionalRender would avoid the frame of latency, but it conditions whole draw calls and a draw here is a
+// glMultiDrawElementsBaseVertex over every mesh of a material.
+class OcclusionCuller
+{
+public:
+    static const unsigned int HIDDEN_FRAMES = 3;
+
+    // queries issued and frustum visible meshes skipped as occluded, since the last ResetStats
+    struct Stats
+    {
+        unsigned long queries = 0;
+        unsigned long skipped = 0;
+    };
+
+    OcclusionCuller() = default;
+    OcclusionCuller(const OcclusionCuller &) = delete;
+    OcclusionCuller &operator=(const OcclusionCuller &) = delete;
+
+    ~OcclusionCuller()
+    {
+        for (Object &object : objects)
+            for (MeshQuery &mesh : object.meshes)
+                if (mesh.query)
+                    glDeleteQueries(1, &mesh.query);
+    }
+
+    uint32_t AddObject()
+    {
+        objects.push_back(Object());
+        return static_cast<uint32_t>(objects.size() - 1);
+    }
+
+    // reads the results of the earlier queries that are ready
+    void CollectResults()
+    {
+        for (Object &object : objects)
+        {
+            for (MeshQuery &mesh : object.meshes)
+            {
+                if (!mesh.pending)
+                    continue;
+                GLuint available = GL_FALSE;
+                glGetQueryObjectuiv(mesh.query, GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available)
+                    continue;
+                GLuint samplesPassed = GL_FALSE;
+                glGetQueryObjectuiv(mesh.query, GL_QUERY_RESULT, &samplesPassed);
+                mesh.pending = false;
+                setResult(mesh, samplesPassed != GL_FALSE);
+            }
+        }
+    }
+
+    // the frustum visibility of an object's meshes with the occluded ones cleared, valid until the next call for
+    // the object. meshes outside the frustum forget their history, so one coming back is drawn until tested again.
+    const uint8_t *Filter(uint32_t object, const std::vector<uint8_t> &frustumVisible)
+    {
+        Object &target = objects[object];
+        if (target.meshes.size() < frustumVisible.size())
+            target.meshes.resize(frustumVisible.size());
+        target.visibility.assign(frustumVisible.begin(), frustumVisible.end());
+        for (size_t i = 0; i < frustumVisible.size(); i++)
+        {
+            MeshQuery &mesh = target.meshes[i];
+            if (!frustumVisible[i])
+            {
+                mesh.hiddenFrames = 0;
+                mesh.occluded = false;
+            }
+            else if (mesh.occluded)
+            {
+                target.visibility[i] = 0;
+                stats.skipped++;
+            }
+        }
+        return target.visibility.data();
+    }
+
+    // tests the boxes (model space) of the object's frustum visible meshes against the depth buffer. boxShader is
+    // bound with its model matrix set (placeholder.vs/fs), vao draws the unit cube it stretches over boundsMin/Max.
+    // the boxes are grown by a margin of twice the near plane distance, so a flat mesh does not hide behind its own
+    // depth, and meshes whose grown box holds the camera are visible without a query: the near plane would clip it.
+    void IssueQueries(uint32_t object, const std::vector<AABB> &bounds, const std::vector<uint8_t> &frustumVisible,
+                      const glm::mat4 &model, const glm::vec3 &cameraPosition, float nearPlane, Shader &boxShader,
+                      GLuint vao)
+    {
+        Object &target = objects[object];
+        if (target.meshes.size() < bounds.size())
+            target.meshes.resize(bounds.size());
+        glm::vec3 camera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+        float scale = std::min(glm::length(glm::vec3(model[0])),
+                               std::min(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        glm::vec3 margin(scale > 0.0f ? 2.0f * nearPlane / scale : 0.0f);
+
+        GLState &state = GLState::Get();
+        state.BindVertexArray(vao);
+        for (size_t i = 0; i < bounds.size() && i < frustumVisible.size(); i++)
+        {
+            MeshQuery &mesh = target.meshes[i];
+            if (!frustumVisible[i] || mesh.pending)
+                continue;
+            glm::vec3 min = bounds[i].min - margin, max = bounds[i].max + margin;
+            if (glm::clamp(camera, min, max) == camera)
+            {
+                setResult(mesh, true);
+                continue;
+            }
+            if (!mesh.query)
+                glGenQueries(1, &mesh.query);
+            boxShader.set(UNIFORM("boundsMin"), min);
+            boxShader.set(UNIFORM("boundsMax"), max);
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, mesh.query);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            mesh.pending = true;
+            stats.queries++;
+        }
+    }
+
+    // the state IssueQueries draws with: depth tested but nothing written, both faces of the boxes
+    static void BeginQueries()
+    {
+        GLState &state = GLState::Get();
+        state.DepthFunc(GL_LEQUAL);
+        state.ColorMask(false, false, false, false);
+        state.DepthMask(GL_FALSE);
+        state.StencilMask(0x00);
+        state.Disable(GL_CULL_FACE);
+    }
+
+    static void EndQueries()
+    {
+        GLState &state = GLState::Get();
+        state.DepthFunc(GL_LESS);
+        state.ColorMask(true, true, true, true);
+        state.DepthMask(GL_TRUE);
+        state.StencilMask(0xFF);
+        state.Enable(GL_CULL_FACE);
+    }
+
+    const Stats &GetStats() const
+    {
+        return stats;
+    }
+
+    void ResetStats()
+    {
+        stats = Stats();
+    }
+
+private:
+    struct MeshQuery
+    {
+        GLuint query = 0;
+        bool pending = false;
+        bool occluded = false;
+        unsigned int hiddenFrames = 0;
+    };
+
+    struct Object
+    {
+        std::vector<MeshQuery> meshes;
+        std::vector<uint8_t> visibility;
+    };
+
+    std::vector<Object> objects;
+    Stats stats;
+
+    static void setResult(MeshQuery &mesh, bool visible)
+    {
+        if (visible)
+        {
+            mesh.hiddenFrames = 0;
+            mesh.occluded = false;
+        }
+        else if (++mesh.hiddenFrames >= HIDDEN_FRAMES)
+        {
+            mesh.occluded = true;
+        }
+    }
+};
+#endif
@@ -0,0 +1,316 @@
+#ifndef PORTALS_H
+#define PORTALS_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// cell and portal visibility for a model made of rooms. the cells are boxes in model space, connected by portals
+// (doorways, windows) that are boxes too, flat for a door. a text file authors them:
+//
+//     # comment
+//     cell <name> <min x y z> <max x y z>
+//     portal <cell> <cell> <min x y z> <max x y z>
+//
+// where the cell "outside" is everything not in a cell. every mesh belongs to each cell its bounds overlap, and to
+// the outside unless a single cell holds it whole: a wall between a room and space is seen from both. per frame the
+// camera's cell is visible with the whole screen, and a cell behind a portal is visible through the screen rectangle
+// of the portal clipped to the rectangle it was seen through, recursively. a mesh is drawn if its box overlaps the
+// rectangle of one of its visible cells.
+class PortalVisibility
+{
+public:
+    static const uint32_t OUTSIDE = 0;
+
+    // cells visible in the last Update and frustum visible meshes skipped since the last ResetStats
+    struct Stats
+    {
+        unsigned long cellsVisible = 0;
+        unsigned long skipped = 0;
+    };
+
+    PortalVisibility()
+    {
+        cells.push_back(Cell());
+        cells[OUTSIDE].name = "outside";
+    }
+
+    // replaces the cells and portals with those of the file. on failure there are none, every mesh is outside.
+    bool Load(const std::string &path)
+    {
+        clear();
+        std::ifstream in(path);
+        if (!in)
+        {
+            std::cout << "ERROR::PORTALS:: cannot read " << path << std::endl;
+            return false;
+        }
+        std::string line;
+        for (int lineNumber = 1; std::getline(in, line); lineNumber++)
+        {
+            std::istringstream words(line);
+            std::string keyword;
+            if (!(words >> keyword) || keyword[0] == '#')
+                continue;
+            bool valid = false;
+            if (keyword == "cell")
+            {
+                if (cells.size() == 64)
+                {
+                    std::cout << "ERROR::PORTALS:: " << path << " has more than 63 cells" << std::endl;
+                    clear();
+                    return false;
+                }
+                Cell cell;
+                valid = (words >> cell.name) && readBox(words, cell.bounds) && findCell(cell.name) < 0;
+                if (valid)
+                    cells.push_back(cell);
+            }
+            else if (keyword == "portal")
+            {
+                std::string first, second;
+                Portal portal;
+                valid = (words >> first >> second) && readBox(words, portal.bounds);
+                int a = findCell(first), b = findCell(second);
+                valid = valid && a >= 0 && b >= 0 && a != b;
+                if (valid)
+                {
+                    portal.cells[0] = a;
+                    portal.cells[1] = b;
+                    cells[a].portals.push_back(static_cast<uint32_t>(portals.size()));
+                    cells[b].portals.push_back(static_cast<uint32_t>(portals.size()));
+                    portals.push_back(portal);
+                }
+            }
+            if (!valid)
+            {
+                std::cout << "ERROR::PORTALS:: malformed line at " << path << ":" << lineNumber << std::endl;
+                clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // puts every mesh (bounds in model space, by mesh index) in the cells it overlaps, and outside too if no cell
+    // contains it
+    void AssignMeshes(const std::vector<AABB> &meshBounds)
+    {
+        this->meshBounds = meshBounds;
+        meshCells.assign(meshBounds.size(), 0);
+        for (size_t i = 0; i < meshBounds.size(); i++)
+        {
+            bool inside = false;
+            for (size_t cell = OUTSIDE + 1; cell < cells.size(); cell++)
+            {
+                if (overlaps(meshBounds[i], cells[cell].bounds))
+                    meshCells[i] |= uint64_t(1) << cell;
+                inside = inside || contains(cells[cell].bounds, meshBounds[i]);
+            }
+            if (!inside)
+                meshCells[i] |= uint64_t(1) << OUTSIDE;
+        }
+    }
+
+    // finds the visible cells and what part of the screen each is seen through. camera is in model space.
+    void Update(const glm::mat4 &viewProjection, const glm::mat4 &model, const glm::vec3 &camera)
+    {
+        transform = viewProjection * model;
+        cameraCell = OUTSIDE;
+        for (size_t cell = OUTSIDE + 1; cell < cells.size(); cell++)
+            if (glm::clamp(camera, cells[cell].bounds.min, cells[cell].bounds.max) == camera)
+                cameraCell = static_cast<uint32_t>(cell);
+
+        for (Cell &cell : cells)
+            cell.visible = false;
+        stats.cellsVisible = 0;
+        ScreenRect screen = {glm::vec2(-1.0f), glm::vec2(1.0f)};
+        visitCell(cameraCell, screen, uint64_t(1) << cameraCell);
+    }
+
+    // the frustum visibility of the meshes with those in no visible cell cleared, valid until the next call
+    const std::vector<uint8_t> &Filter(const std::vector<uint8_t> &frustumVisible)
+    {
+        visibility.assign(frustumVisible.begin(), frustumVisible.end());
+        for (size_t i = 0; i < visibility.size() && i < meshCells.size(); i++)
+        {
+            if (!visibility[i])
+                continue;
+            ScreenRect rect;
+            bool projected = project(meshBounds[i], rect);
+            bool visible = false;
+            for (size_t cell = 0; cell < cells.size() && !visible; cell++)
+                visible = (meshCells[i] >> cell & 1) && cells[cell].visible &&
+                          (!projected || !intersect(rect, cells[cell].visibleRect).Empty());
+            if (!visible)
+            {
+                visibility[i] = 0;
+                stats.skipped++;
+            }
+        }
+        return visibility;
+    }
+
+    const std::string &CameraCell() const
+    {
+        return cells[cameraCell].name;
+    }
+
+    size_t CellCount() const
+    {
+        return cells.size();
+    }
+
+    const Stats &GetStats() const
+    {
+        return stats;
+    }
+
+    void ResetStats()
+    {
+        stats.skipped = 0;
+    }
+
+private:
+    // normalized device coordinates
+    struct ScreenRect
+    {
+        glm::vec2 min;
+        glm::vec2 max;
+
+        bool Empty() const
+        {
+            return min.x >= max.x || min.y >= max.y;
+        }
+    };
+
+    struct Cell
+    {
+        std::string name;
+        AABB bounds;
+        std::vector<uint32_t> portals;
+        bool visible = false;
+        // union of the rectangles the cell was seen through
+        ScreenRect visibleRect;
+    };
+
+    struct Portal
+    {
+        AABB bounds;
+        uint32_t cells[2];
+    };
+
+    std::vector<Cell> cells;
+    std::vector<Portal> portals;
+    std::vector<AABB> meshBounds;
+    // bit per cell
+    std::vector<uint64_t> meshCells;
+    std::vector<uint8_t> visibility;
+    glm::mat4 transform = glm::mat4(1.0f);
+    uint32_t cameraCell = OUTSIDE;
+    Stats stats;
+
+    // back to the outside alone, the meshes of the last AssignMeshes with it
+    void clear()
+    {
+        cells.resize(OUTSIDE + 1);
+        cells[OUTSIDE].portals.clear();
+        portals.clear();
+        meshBounds.clear();
+        meshCells.clear();
+        cameraCell = OUTSIDE;
+    }
+
+    // path holds the cells on the way here, so a portal does not lead back into them
+    void visitCell(uint32_t index, const ScreenRect &rect, uint64_t path)
+    {
+        Cell &cell = cells[index];
+        if (!cell.visible)
+        {
+            cell.visible = true;
+            cell.visibleRect = rect;
+            stats.cellsVisible++;
+        }
+        else
+        {
+            cell.visibleRect.min = glm::min(cell.visibleRect.min, rect.min);
+            cell.visibleRect.max = glm::max(cell.visibleRect.max, rect.max);
+        }
+
+        for (uint32_t portalIndex : cell.portals)
+        {
+            const Portal &portal = portals[portalIndex];
+            uint32_t next = portal.cells[portal.cells[0] == index ? 1 : 0];
+            if (path >> next & 1)
+                continue;
+            ScreenRect portalRect;
+            // a portal crossing the near plane covers the screen
+            ScreenRect through = project(portal.bounds, portalRect) ? intersect(rect, portalRect) : rect;
+            if (!through.Empty())
+                visitCell(next, through, path | uint64_t(1) << next);
+        }
+    }
+
+    // the screen rectangle of a model space box, empty behind the camera. false if it crosses the near plane.
+    bool project(const AABB &bounds, ScreenRect &rect) const
+    {
+        rect.min = glm::vec2(INFINITY);
+        rect.max = glm::vec2(-INFINITY);
+        int behind = 0;
+        for (int corner = 0; corner < 8; corner++)
+        {
+            glm::vec3 position(corner & 1 ? bounds.max.x : bounds.min.x, corner & 2 ? bounds.max.y : bounds.min.y,
+                               corner & 4 ? bounds.max.z : bounds.min.z);
+            glm::vec4 p = transform * glm::vec4(position, 1.0f);
+            if (p.z < -p.w)
+            {
+                behind++;
+                continue;
+            }
+            glm::vec2 ndc = glm::vec2(p.x, p.y) / p.w;
+            rect.min = glm::min(rect.min, ndc);
+            rect.max = glm::max(rect.max, ndc);
+        }
+        return behind == 0 || behind == 8;
+    }
+
+    static ScreenRect intersect(const ScreenRect &a, const ScreenRect &b)
+    {
+        ScreenRect result = {glm::max(a.min, b.min), glm::min(a.max, b.max)};
+        return result;
+    }
+
+    static bool overlaps(const AABB &a, const AABB &b)
+    {
+        return a.min.x < b.max.x && b.min.x < a.max.x && a.min.y < b.max.y && b.min.y < a.max.y &&
+               a.min.z < b.max.z && b.min.z < a.max.z;
+    }
+
+    // b lies within a
+    static bool contains(const AABB &a, const AABB &b)
+    {
+        return glm::clamp(b.min, a.min, a.max) == b.min && glm::clamp(b.max, a.min, a.max) == b.max;
+    }
+
+    static bool readBox(std::istream &in, AABB &box)
+    {
+        return static_cast<bool>(in >> box.min.x >> box.min.y >> box.min.z >> box.max.x >> box.max.y >> box.max.z);
+    }
+
+    int findCell(const std::string &name) const
+    {
+        for (size_t i = 0; i < cells.size(); i++)
+            if (cells[i].name == name)
+                return static_cast<int>(i);
+        return -1;
+    }
+};
+#endif
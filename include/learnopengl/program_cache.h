@@ -0,0 +1,142 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_extensions.h>
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// linked programs are kept on disk as driver binaries (glGetProgramBinary), one file per shader file combination
+// and set of defines under a .cache directory next to the vertex shader. each file records the key it was made
+// for: a hash of the final stage sources, the defines and the driver's vendor, renderer and version strings, so
+// editing a shader or updating the driver simply misses and overwrites it.
+
+struct ProgramCacheHeader
+{
+    char magic[8];
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t length;
+};
+static_assert(sizeof(ProgramCacheHeader) == 24, "program cache header layout");
+
+const char PROGRAM_CACHE_MAGIC[8] = {'H', 'G', 'P', 'R', 'O', 'G', '0', '1'};
+
+// 64-bit FNV-1a, continued from hash
+inline uint64_t HashString(const std::string &text, uint64_t hash = 14695981039346656037ull)
+{
+    for (unsigned char c : text)
+        hash = (hash ^ c) * 1099511628211ull;
+    // the length separates "ab" + "c" from "a" + "bc"
+    return (hash ^ text.size()) * 1099511628211ull;
+}
+
+inline std::string ProgramCachePath(const std::string &vertexPath, const std::string &fragmentPath, const std::string &geometryPath, const std::string &defines)
+{
+    size_t slash = vertexPath.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : vertexPath.substr(0, slash);
+    std::string name = slash == std::string::npos ? vertexPath : vertexPath.substr(slash + 1);
+    uint64_t hash = HashString(defines, HashString(geometryPath, HashString(fragmentPath, HashString(vertexPath))));
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    return directory + "/.cache/" + name + "." + hex + ".program";
+}
+
+inline uint64_t ProgramCacheKey(const std::vector<std::string> &sources, const std::string &defines)
+{
+    uint64_t key = 14695981039346656037ull;
+    const GLenum strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (GLenum name : strings)
+    {
+        const char *value = reinterpret_cast<const char *>(glGetString(name));
+        key = HashString(value ? value : "", key);
+    }
+    key = HashString(defines, key);
+    for (const std::string &source : sources)
+        key = HashString(source, key);
+    return key;
+}
+
+// a linked program from the cache, or 0 if there is no binary for this key or the driver rejects it
+inline unsigned int LoadCachedProgram(const std::string &path, uint64_t key)
+{
+    if (!GLExt().programBinary)
+        return 0;
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return 0;
+    ProgramCacheHeader header;
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) || memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.key != key)
+        return 0;
+    std::vector<char> binary(header.length);
+    if (!in.read(binary.data(), binary.size()))
+        return 0;
+
+    unsigned int program = glCreateProgram();
+    GLExt().ProgramBinary(program, header.binaryFormat, binary.data(), binary.size());
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        // e.g. a driver update that kept the version string, or a format no longer accepted
+        while (glGetError() != GL_NO_ERROR)
+            ;
+        glDeleteProgram(program);
+        std::remove(path.c_str());
+        std::cout << "SHADER::CACHE:: driver rejected " << path << ", compiling from source" << std::endl;
+        return 0;
+    }
+    return program;
+}
+
+// marks a program to be linked so that its binary can be retrieved; call before glLinkProgram
+inline void PrepareProgramForCache(unsigned int program)
+{
+    if (GLExt().programBinary)
+        GLExt().ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+// writes the binary of a successfully linked program, through a temporary file so a crash never leaves half of one
+inline void StoreCachedProgram(const std::string &path, uint64_t key, unsigned int program)
+{
+    if (!GLExt().programBinary)
+        return;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    ProgramCacheHeader header;
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+    header.key = key;
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    GLExt().GetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0)
+        return;
+    header.binaryFormat = format;
+    header.length = written;
+
+    mkdir(path.substr(0, path.find_last_of('/')).c_str(), 0755);
+    std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(binary.data(), written);
+    out.close();
+    if (out.fail() || std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        std::cout << "SHADER::CACHE:: cannot write " << path << std::endl;
+    }
+}
+#endif
@@ -0,0 +1,289 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/material.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/uniforms.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// the scene submits its draws to a RenderQueue every frame instead of issuing them in a hand-written order. each
+// item carries a 64-bit key, most significant field first:
+//
+//   opaque       pass:2 | translucent:1 = 0 | program:12 | material:16 | depth:24 | 0:9
+//   translucent  pass:2 | translucent:1 = 1 | ~depth:24 | program:12 | material:16 | 0:9
+//
+// so sorting the keys groups the passes, draws the opaque items of a pass program by program and material by material
+// (front to back within a material, for early-z), and the translucent ones after them back to front.
+enum class RenderPass : uint32_t
+{
+    Outline,    // silhouettes drawn before the scene
+    Scene,
+};
+
+// the per-object uniforms of a draw; shaders without one of them ignore it
+struct RenderObject
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    float opacity = 1.0f;
+    glm::vec3 fogColor = glm::vec3(0.0f);
+    // per mesh, which meshes are in view (e.g. SceneBVH::Visibility); null if the model should cull them itself
+    const uint8_t *visibility = nullptr;
+    // whether the meshlets of the meshes in view are culled too, see RenderQueue::SetMeshletCulling
+    bool cullMeshlets = false;
+};
+
+// one glMultiDrawElementsBaseVertex of meshes sharing a material, see Model::Submit. the draws themselves are
+// added to the queue with AddDraw before the item is submitted.
+struct RenderItem
+{
+    Shader *shader = nullptr;
+    const Mesh *material = nullptr;     // first mesh of the draw: material and vertex format
+    const MaterialUniforms *materialUniforms = nullptr;
+    GLuint vao = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    uint32_t object = 0;
+    // set by Submit
+    size_t firstDraw = 0;
+    GLsizei drawCount = 0;
+};
+
+// sort id of a material, the same for equal materials of different models. materials past the 16 bits of the key
+// share the last id, which only costs them their grouping.
+inline uint32_t RenderMaterialId(const std::string &material)
+{
+    static std::unordered_map<std::string, uint32_t> ids;
+    auto found = ids.find(material);
+    if (found != ids.end())
+        return found->second;
+    uint32_t id = ids.size() < 0xFFFF ? static_cast<uint32_t>(ids.size()) : 0xFFFF;
+    ids.emplace(material, id);
+    return id;
+}
+
+struct RenderSortEntry
+{
+    uint64_t key;
+    uint32_t item;
+};
+
+// stable LSD radix sort of the keys, a byte per pass. bytes every key shares (the unused low bits, the pass of a
+// single pass frame, ...) are skipped. the result ends up in entries, scratch is resized as needed.
+inline void RadixSort(std::vector<RenderSortEntry> &entries, std::vector<RenderSortEntry> &scratch)
+{
+    if (entries.size() < 2)
+        return;
+    scratch.resize(entries.size());
+    for (unsigned int shift = 0; shift < 64; shift += 8)
+    {
+        size_t offsets[256] = {};
+        for (const RenderSortEntry &entry : entries)
+            offsets[(entry.key >> shift) & 0xFF]++;
+        if (offsets[(entries[0].key >> shift) & 0xFF] == entries.size())
+            continue;
+        size_t offset = 0;
+        for (size_t &bucket : offsets)
+        {
+            size_t count = bucket;
+            bucket = offset;
+            offset += count;
+        }
+        for (const RenderSortEntry &entry : entries)
+            scratch[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+        entries.swap(scratch);
+    }
+}
+
+class RenderQueue
+{
+public:
+    // draw calls (items), the meshes they drew and state changes of the Draw calls since Begin
+    struct Stats
+    {
+        unsigned long items = 0;
+        unsigned long draws = 0;
+        unsigned long programs = 0;
+        unsigned long materials = 0;
+    };
+
+    // starts a frame seen through view and projection: forgets the previous frame's objects and items
+    void Begin(const glm::mat4 &view, const glm::mat4 &projection)
+    {
+        this->view = view;
+        this->projection = projection;
+        viewProjection = projection * view;
+        objects.clear();
+        items.clear();
+        entries.clear();
+        drawCounts.clear();
+        drawOffsets.clear();
+        drawBaseVertices.clear();
+        pendingDraws = 0;
+        sorted = false;
+        stats = Stats();
+    }
+
+    uint32_t AddObject(const RenderObject &object)
+    {
+        objects.push_back(object);
+        return static_cast<uint32_t>(objects.size() - 1);
+    }
+
+    const RenderObject &Object(uint32_t object) const
+    {
+        return objects[object];
+    }
+
+    const glm::mat4 &ViewProjection() const
+    {
+        return viewProjection;
+    }
+
+    // what meshlet culling needs to know of the pipeline: the viewport height the projected size of a meshlet is
+    // measured in, and the faces GL culls (GL_BACK, GL_FRONT, or GL_NONE when it draws both). kept across frames.
+    void SetMeshletCulling(int viewportHeight, GLenum culledFace)
+    {
+        this->viewportHeight = viewportHeight;
+        this->culledFace = culledFace;
+    }
+
+    // the view of this frame in the model space of object
+    MeshletView MeshletViewFor(uint32_t object) const
+    {
+        return MeshletView::From(view, projection, objects[object].model, viewportHeight, culledFace);
+    }
+
+    // adds a mesh to the item submitted next
+    void AddDraw(GLsizei count, const void *offset, GLint baseVertex)
+    {
+        drawCounts.push_back(count);
+        drawOffsets.push_back(offset);
+        drawBaseVertices.push_back(baseVertex);
+    }
+
+    // queues an item with the draws added since the previous Submit, whose geometry is centered at center (world
+    // space). translucent items are blended. an item without draws (every mesh culled) is dropped.
+    void Submit(RenderPass pass, bool translucent, uint32_t material, const glm::vec3 &center, RenderItem item)
+    {
+        item.firstDraw = pendingDraws;
+        item.drawCount = static_cast<GLsizei>(drawCounts.size() - pendingDraws);
+        pendingDraws = drawCounts.size();
+        if (item.drawCount == 0)
+            return;
+
+        float depth = -(view * glm::vec4(center, 1.0f)).z;
+        uint64_t key = static_cast<uint64_t>(pass) << 62;
+        uint64_t program = item.shader->ID & 0xFFF;
+        uint64_t materialBits = material & 0xFFFF;
+        uint64_t depthBits = depthKey(depth);
+        if (translucent)
+            key |= 1ull << 61 | (~depthBits & 0xFFFFFF) << 37 | program << 25 | materialBits << 9;
+        else
+            key |= program << 49 | materialBits << 33 | depthBits << 9;
+        entries.push_back(RenderSortEntry{key, static_cast<uint32_t>(items.size())});
+        items.push_back(item);
+        sorted = false;
+    }
+
+    // calls f(item) for the opaque or the translucent items of a pass, in key order
+    template <typename F>
+    void ForEachItem(RenderPass pass, bool translucent, F f)
+    {
+        if (!sorted)
+        {
+            RadixSort(entries, scratch);
+            sorted = true;
+        }
+        // the top three bits of the key: the pass, then the translucent bit
+        uint64_t prefix = static_cast<uint64_t>(pass) << 1 | (translucent ? 1 : 0);
+        for (const RenderSortEntry &entry : entries)
+            if (entry.key >> 61 == prefix)
+                f(items[entry.item]);
+    }
+
+    // draws the opaque or the translucent items of a pass in key order. blending is enabled for the translucent ones.
+    void Draw(RenderPass pass, bool translucent)
+    {
+        GLState &state = GLState::Get();
+        if (translucent)
+            state.Enable(GL_BLEND);
+        const Shader *boundShader = nullptr;
+        const Mesh *boundMaterial = nullptr;
+        ForEachItem(pass, translucent, [&](const RenderItem &item) {
+            const RenderObject &object = objects[item.object];
+            Shader &shader = *item.shader;
+            if (&shader != boundShader)
+            {
+                shader.use();
+                boundShader = &shader;
+                boundMaterial = nullptr;
+                stats.programs++;
+            }
+            shader.set(UNIFORM("model"), object.model);
+            shader.set(UNIFORM("opacity"), object.opacity);
+            shader.set(UNIFORM("fogColor"), object.fogColor);
+            if (item.material != boundMaterial)
+            {
+                item.material->BindMaterial(shader, *item.materialUniforms);
+                item.material->SetVertexFormatUniforms(shader);
+                boundMaterial = item.material;
+                stats.materials++;
+            }
+            state.BindVertexArray(item.vao);
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, &drawCounts[item.firstDraw], item.indexType, &drawOffsets[item.firstDraw],
+                                          item.drawCount, &drawBaseVertices[item.firstDraw]);
+            stats.items++;
+            stats.draws += static_cast<unsigned long>(item.drawCount);
+        });
+        if (translucent)
+            state.Disable(GL_BLEND);
+    }
+
+    size_t Size() const
+    {
+        return items.size();
+    }
+
+    const Stats &GetStats() const
+    {
+        return stats;
+    }
+
+private:
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    int viewportHeight = 0;
+    GLenum culledFace = GL_NONE;
+    std::vector<RenderObject> objects;
+    std::vector<RenderItem> items;
+    std::vector<GLsizei> drawCounts;
+    std::vector<const void *> drawOffsets;
+    std::vector<GLint> drawBaseVertices;
+    size_t pendingDraws = 0;
+    std::vector<RenderSortEntry> entries;
+    std::vector<RenderSortEntry> scratch;
+    bool sorted = false;
+    Stats stats;
+
+    // the top 24 bits below the sign of the distance's float bits, which order like the distances for any distance
+    // >= 0. objects behind the camera count as 0.
+    static uint64_t depthKey(float depth)
+    {
+        if (!(depth > 0.0f))
+            return 0;
+        uint32_t bits;
+        memcpy(&bits, &depth, sizeof(bits));
+        return (bits >> 7) & 0xFFFFFF;
+    }
+};
+#endif
@@ -0,0 +1,328 @@
+#ifndef SCENE_ARCHIVE_H
+#define SCENE_ARCHIVE_H
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/texture_compression.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <iostream>
+
+// Binary scene archive written by the hangar_bake tool and memory mapped at runtime.
+//
+// file layout: ArchiveHeader | blobs | ArchiveModel[] | ArchiveMesh[] | ArchiveTextureRef[] | ArchiveTexture[] | ArchiveLevel[] | strings
+//
+// blobs are vertex arrays, index arrays and texture mip levels, each starting on a 16 byte boundary and stored
+// exactly the way glBufferData/glTexImage2D consume them, so the runtime uploads straight from the mapping.
+// all offsets are absolute file offsets, string references are offsets into the string table.
+const uint32_t ARCHIVE_MAGIC   = 0x52413548; // "H5AR"
+const uint32_t ARCHIVE_VERSION = 3;   // 2: block-compressed textures, 3: material constants
+const uint64_t ARCHIVE_ALIGNMENT = 16;
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexStride;      // sizeof(Vertex) at bake time, the archive is rejected if the layout changed
+    uint32_t indexSize;
+    uint32_t modelCount;
+    uint32_t meshCount;
+    uint32_t textureRefCount;
+    uint32_t textureCount;
+    uint32_t levelCount;
+    uint32_t stringsSize;
+    uint64_t modelsOffset;
+    uint64_t meshesOffset;
+    uint64_t textureRefsOffset;
+    uint64_t texturesOffset;
+    uint64_t levelsOffset;
+    uint64_t stringsOffset;
+    uint64_t fileSize;
+};
+
+struct ArchiveModel {
+    uint32_t path;              // model path exactly as passed to the Model constructor
+    uint32_t firstMesh;
+    uint32_t meshCount;
+    uint32_t reserved;
+    uint64_t sourceSize;        // size and modification time of the source file, used to detect stale archives
+    int64_t  sourceTime;
+};
+
+// MaterialConstants as stored, without relying on glm's layout
+struct ArchiveMaterial {
+    float diffuse[3];
+    float specular[3];
+    float emissive[3];
+    float shininess;
+    float opacity;
+    uint32_t reserved;
+};
+
+struct ArchiveMesh {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t firstTextureRef;
+    uint32_t textureRefCount;
+    ArchiveMaterial material;
+};
+
+struct ArchiveTextureRef {
+    uint32_t texture;           // index into the texture table
+    uint32_t type;              // TextureType
+};
+
+struct ArchiveTexture {
+    uint32_t path;              // resolved file path, shared textures are stored once
+    uint32_t width;
+    uint32_t height;
+    uint32_t internalFormat;    // GL_COMPRESSED_* when format is 0
+    uint32_t format;            // pixel format of uncompressed levels, 0 for block-compressed ones
+    uint32_t firstLevel;
+    uint32_t levelCount;
+    uint32_t reserved;
+};
+
+struct ArchiveLevel {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+static_assert(sizeof(ArchiveHeader) == 96, "archive header layout changed");
+static_assert(sizeof(ArchiveModel) == 32, "archive model layout changed");
+static_assert(sizeof(ArchiveMaterial) == 48, "archive material layout changed");
+static_assert(sizeof(ArchiveMesh) == 80, "archive mesh layout changed");
+
+inline ArchiveMaterial ToArchiveMaterial(const MaterialConstants &constants)
+{
+    ArchiveMaterial material = {};
+    for (int i = 0; i < 3; i++)
+    {
+        material.diffuse[i] = constants.diffuse[i];
+        material.specular[i] = constants.specular[i];
+        material.emissive[i] = constants.emissive[i];
+    }
+    material.shininess = constants.shininess;
+    material.opacity = constants.opacity;
+    return material;
+}
+
+inline MaterialConstants ToMaterialConstants(const ArchiveMaterial &material)
+{
+    MaterialConstants constants;
+    constants.diffuse = glm::vec3(material.diffuse[0], material.diffuse[1], material.diffuse[2]);
+    constants.specular = glm::vec3(material.specular[0], material.specular[1], material.specular[2]);
+    constants.emissive = glm::vec3(material.emissive[0], material.emissive[1], material.emissive[2]);
+    constants.shininess = material.shininess;
+    constants.opacity = material.opacity;
+    return constants;
+}
+static_assert(sizeof(ArchiveTexture) == 32, "archive texture layout changed");
+static_assert(sizeof(ArchiveLevel) == 24, "archive level layout changed");
+
+// read-only view of a scene archive. the whole file is mapped once and the tables are used in place.
+class SceneArchive
+{
+public:
+    SceneArchive() {}
+    SceneArchive(const SceneArchive &) = delete;
+    SceneArchive &operator=(const SceneArchive &) = delete;
+    ~SceneArchive()
+    {
+        Close();
+    }
+
+    // maps the archive and validates its header and tables; returns false (and stays closed) on any mismatch.
+    bool Open(const string &path)
+    {
+        Close();
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArchiveHeader))
+        {
+            close(fd);
+            return false;
+        }
+        void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+            return false;
+
+        data = static_cast<const unsigned char *>(mapping);
+        size = st.st_size;
+        if (!validate())
+        {
+            cout << "ERROR::ARCHIVE:: " << path << " is corrupt or was baked by an incompatible version, ignoring it" << endl;
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        if (data)
+            munmap(const_cast<unsigned char *>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+
+    bool IsOpen() const
+    {
+        return data != nullptr;
+    }
+
+    // returns the model baked from the given path, or nullptr if it is missing or the source changed since baking.
+    const ArchiveModel *FindModel(const string &path) const
+    {
+        if (!data)
+            return nullptr;
+        for (uint32_t i = 0; i < header().modelCount; i++)
+        {
+            const ArchiveModel &model = table<ArchiveModel>(header().modelsOffset)[i];
+            if (path != String(model.path))
+                continue;
+            struct stat st;
+            if (stat(path.c_str(), &st) == 0 && ((uint64_t)st.st_size != model.sourceSize || (int64_t)st.st_mtime != model.sourceTime))
+            {
+                cout << "ARCHIVE:: " << path << " changed since it was baked, loading the source instead" << endl;
+                return nullptr;
+            }
+            return &model;
+        }
+        return nullptr;
+    }
+
+    const ArchiveMesh &GetMesh(uint32_t i) const { return table<ArchiveMesh>(header().meshesOffset)[i]; }
+    const ArchiveTextureRef &GetTextureRef(uint32_t i) const { return table<ArchiveTextureRef>(header().textureRefsOffset)[i]; }
+    const ArchiveTexture &GetTexture(uint32_t i) const { return table<ArchiveTexture>(header().texturesOffset)[i]; }
+    const ArchiveLevel &GetLevel(uint32_t i) const { return table<ArchiveLevel>(header().levelsOffset)[i]; }
+    uint32_t TextureCount() const { return header().textureCount; }
+
+    const char *String(uint32_t offset) const
+    {
+        return reinterpret_cast<const char *>(data + header().stringsOffset + offset);
+    }
+
+    const void *Bytes(uint64_t offset) const
+    {
+        return data + offset;
+    }
+
+private:
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+
+    const ArchiveHeader &header() const
+    {
+        return *reinterpret_cast<const ArchiveHeader *>(data);
+    }
+
+    // bytes of a level in the texture's format: 4x4 blocks of 8 (BC1, BC4) or 16 (BC5) bytes when block-compressed,
+    // unpadded rows of 8 bit channels otherwise. 0 for a format the baker does not write.
+    static uint64_t levelBytes(const ArchiveTexture &texture, const ArchiveLevel &level)
+    {
+        uint64_t pixels = (uint64_t)level.width * level.height;
+        uint64_t blocks = (((uint64_t)level.width + 3) / 4) * (((uint64_t)level.height + 3) / 4);
+        if (texture.format == 0)
+        {
+            if (IsS3TCFormat(texture.internalFormat) || texture.internalFormat == GL_COMPRESSED_RED_RGTC1)
+                return blocks * 8;
+            return texture.internalFormat == GL_COMPRESSED_RG_RGTC2 ? blocks * 16 : 0;
+        }
+        if (texture.internalFormat != texture.format)
+            return 0;
+        switch (texture.format)
+        {
+        case GL_RED:
+            return pixels;
+        case GL_RG:
+            return pixels * 2;
+        case GL_RGB:
+            return pixels * 3;
+        case GL_RGBA:
+            return pixels * 4;
+        default:
+            return 0;
+        }
+    }
+
+    template <typename T>
+    const T *table(uint64_t offset) const
+    {
+        return reinterpret_cast<const T *>(data + offset);
+    }
+
+    bool inside(uint64_t offset, uint64_t bytes) const
+    {
+        return offset <= size && bytes <= size - offset;
+    }
+
+    bool validate() const
+    {
+        const ArchiveHeader &h = header();
+        if (h.magic != ARCHIVE_MAGIC || h.version != ARCHIVE_VERSION || h.vertexStride != sizeof(Vertex) ||
+            h.indexSize != sizeof(unsigned int) || h.fileSize != size)
+            return false;
+        if (!inside(h.modelsOffset, (uint64_t)h.modelCount * sizeof(ArchiveModel)) ||
+            !inside(h.meshesOffset, (uint64_t)h.meshCount * sizeof(ArchiveMesh)) ||
+            !inside(h.textureRefsOffset, (uint64_t)h.textureRefCount * sizeof(ArchiveTextureRef)) ||
+            !inside(h.texturesOffset, (uint64_t)h.textureCount * sizeof(ArchiveTexture)) ||
+            !inside(h.levelsOffset, (uint64_t)h.levelCount * sizeof(ArchiveLevel)) ||
+            !inside(h.stringsOffset, h.stringsSize) || h.stringsSize == 0 || data[h.stringsOffset + h.stringsSize - 1] != '\0')
+            return false;
+
+        for (uint32_t i = 0; i < h.modelCount; i++)
+        {
+            const ArchiveModel &m = table<ArchiveModel>(h.modelsOffset)[i];
+            if (m.path >= h.stringsSize || m.firstMesh > h.meshCount || m.meshCount > h.meshCount - m.firstMesh)
+                return false;
+        }
+        for (uint32_t i = 0; i < h.meshCount; i++)
+        {
+            const ArchiveMesh &m = GetMesh(i);
+            if (!inside(m.vertexOffset, (uint64_t)m.vertexCount * sizeof(Vertex)) ||
+                !inside(m.indexOffset, (uint64_t)m.indexCount * sizeof(unsigned int)) ||
+                m.firstTextureRef > h.textureRefCount || m.textureRefCount > h.textureRefCount - m.firstTextureRef)
+                return false;
+        }
+        for (uint32_t i = 0; i < h.textureRefCount; i++)
+        {
+            const ArchiveTextureRef &r = GetTextureRef(i);
+            if (r.texture >= h.textureCount || r.type >= TEXTURE_TYPE_COUNT)
+                return false;
+        }
+        for (uint32_t i = 0; i < h.textureCount; i++)
+        {
+            const ArchiveTexture &t = GetTexture(i);
+            if (t.path >= h.stringsSize || t.firstLevel > h.levelCount || t.levelCount > h.levelCount - t.firstLevel)
+                return false;
+            // the upload reads as many bytes as the level's size and format call for
+            for (uint32_t level = t.firstLevel; level < t.firstLevel + t.levelCount; level++)
+            {
+                const ArchiveLevel &l = GetLevel(level);
+                if (l.width == 0 || l.height == 0 || l.size != levelBytes(t, l))
+                    return false;
+            }
+        }
+        for (uint32_t i = 0; i < h.levelCount; i++)
+        {
+            const ArchiveLevel &l = GetLevel(i);
+            if (!inside(l.offset, l.size))
+                return false;
+        }
+        return true;
+    }
+};
+#endif
@@ -4,24 +4,52 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <learnopengl/gl_state.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/uniform_buffers.h>
+#include <learnopengl/uniforms.h>
+
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 #include <common.h>
 class Shader
 {
 public:
-    unsigned int ID;
+    unsigned int ID = 0;
+    // empty, to be built with Compile() and Finish() (see ShaderCompiler)
+    Shader() {}
     // constructor generates the shader on the fly
+    // defines (e.g. "#define COMPACT_VERTICES\n") are inserted after the #version line of every stage
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const std::string &defines = "")
+    {
+        Compile(vertexPath, fragmentPath, geometryPath, defines);
+        Finish();
+    }
+    // outputs of the last stage that transform feedback captures, interleaved in this order into one buffer.
+    // they are part of the link, so set them before Compile().
+    // ------------------------------------------------------------------------
+    void SetFeedbackVaryings(const std::vector<std::string> &varyings)
+    {
+        feedbackVaryings = varyings;
+    }
+    // hands the stages to the driver and links them without asking for any status, so the driver can still be
+    // working on them when this returns. a program found in the binary cache is complete right away.
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    void Compile(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const std::string &defines = "")
     {
         std::string vertexPathString(vertexPath);
         std::string fragmentPathString(fragmentPath);
+        std::string geometryPathString(geometryPath ? geometryPath : "");
 
         vertexPath = vertexPathString.c_str();
         fragmentPath= fragmentPathString.c_str();
+        cachePath = ProgramCachePath(vertexPath, fragmentPath, geometryPath ? geometryPath : "", defines);
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
@@ -51,7 +79,6 @@ public:
             // if geometry shader path is present, also load a geometry shader
             if(geometryPath != nullptr)
             {
-                std::string geometryPathString(geometryPath);
                 geometryPath = geometryPathString.c_str();
                 gShaderFile.open(geometryPath);
                 std::stringstream gShaderStream;
@@ -64,114 +91,425 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
+        // 2. inline #include files, then put the permutation defines in front of everything
+        for (std::vector<std::string> &files : sourceFiles)
+            files.clear();
+        vertexCode = resolveIncludes(vertexCode, vertexPathString, sourceFiles[0]);
+        fragmentCode = resolveIncludes(fragmentCode, fragmentPathString, sourceFiles[1]);
+        if (geometryPath != nullptr)
+            geometryCode = resolveIncludes(geometryCode, geometryPathString, sourceFiles[2]);
+        vertexCode = insertDefines(vertexCode, defines);
+        fragmentCode = insertDefines(fragmentCode, defines);
+        geometryCode = insertDefines(geometryCode, defines);
+        // a binary linked by an earlier run for exactly these sources, defines and driver skips compiling
+        std::string linkOptions = defines;
+        for (const std::string &varying : feedbackVaryings)
+            linkOptions += "\n#varying " + varying;
+        cacheKey = ProgramCacheKey({vertexCode, fragmentCode, geometryCode}, linkOptions);
+        ID = LoadCachedProgram(cachePath, cacheKey);
+        uniforms.clear();
+        if (ID != 0)
+        {
+            reflectUniforms();
+            bindUniformBlocks();
+            return;
+        }
+        pending = true;
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
+        // 3. compile shaders, their status is checked in Finish()
+        unsigned int &vertex = stages[0], &fragment = stages[1], &geometry = stages[2];
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertex, 1, &vShaderCode, NULL);
         glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
         // fragment Shader
         fragment = glCreateShader(GL_FRAGMENT_SHADER);
         glShaderSource(fragment, 1, &fShaderCode, NULL);
         glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
         // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
+        geometry = 0;
         if(geometryPath != nullptr)
         {
             const char * gShaderCode = geometryCode.c_str();
             geometry = glCreateShader(GL_GEOMETRY_SHADER);
             glShaderSource(geometry, 1, &gShaderCode, NULL);
             glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
         }
         // shader Program
         ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
+        if(geometry != 0)
             glAttachShader(ID, geometry);
+        if (!feedbackVaryings.empty())
+        {
+            std::vector<const char *> names;
+            for (const std::string &varying : feedbackVaryings)
+                names.push_back(varying.c_str());
+            glTransformFeedbackVaryings(ID, static_cast<GLsizei>(names.size()), names.data(), GL_INTERLEAVED_ATTRIBS);
+        }
+        PrepareProgramForCache(ID);
+        glLinkProgram(ID);
+    }
+    // the same for a compute program (GL 4.3, see GLExtensions::indirectTier): one stage, no feedback varyings
+    // ------------------------------------------------------------------------
+    void CompileCompute(const char* computePath, const std::string &defines = "")
+    {
+        std::string computePathString(computePath);
+        cachePath = ProgramCachePath(computePathString, "", "", defines);
+        std::string computeCode;
+        std::ifstream cShaderFile;
+        cShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            cShaderFile.open(computePath);
+            std::stringstream cShaderStream;
+            cShaderStream << cShaderFile.rdbuf();
+            cShaderFile.close();
+            computeCode = cShaderStream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        }
+        for (std::vector<std::string> &files : sourceFiles)
+            files.clear();
+        computeCode = insertDefines(resolveIncludes(computeCode, computePathString, sourceFiles[3]), defines);
+        cacheKey = ProgramCacheKey({computeCode}, defines);
+        ID = LoadCachedProgram(cachePath, cacheKey);
+        uniforms.clear();
+        if (ID != 0)
+        {
+            reflectUniforms();
+            bindUniformBlocks();
+            return;
+        }
+        pending = true;
+        const char* cShaderCode = computeCode.c_str();
+        unsigned int &compute = stages[3];
+        compute = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(compute, 1, &cShaderCode, NULL);
+        glCompileShader(compute);
+        ID = glCreateProgram();
+        glAttachShader(ID, compute);
+        PrepareProgramForCache(ID);
         glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+    }
+    // true if Finish() will not have to wait for the driver. that is only known with KHR_parallel_shader_compile,
+    // without it the answer is always yes and Finish() may block.
+    // ------------------------------------------------------------------------
+    bool IsReady() const
+    {
+        if (!pending || !GLExt().parallelShaderCompile)
+            return true;
+        GLint completed = GL_FALSE;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
+    // reports compile and link errors of the last Compile() and stores the linked program in the binary cache
+    // ------------------------------------------------------------------------
+    void Finish()
+    {
+        if (!pending)
+            return;
+        pending = false;
+        const char *types[] = {"VERTEX", "FRAGMENT", "GEOMETRY", "COMPUTE"};
+        for (int i = 0; i < 4; i++)
+        {
+            if (stages[i] == 0 || checkCompileErrors(stages[i], types[i]))
+                continue;
+            // messages name lines as source(line), the source strings being the file and its includes
+            for (size_t source = 0; source < sourceFiles[i].size(); source++)
+                std::cout << "    source " << source << ": " << sourceFiles[i][source] << std::endl;
+        }
+        if (checkCompileErrors(ID, "PROGRAM"))
+        {
+            StoreCachedProgram(cachePath, cacheKey, ID);
+            reflectUniforms();
+            bindUniformBlocks();
+        }
         // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        for (unsigned int &stage : stages)
+        {
+            if (stage != 0)
+                glDeleteShader(stage);
+            stage = 0;
+        }
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        GLState::Get().UseProgram(ID);
     }
-    // utility uniform functions
+    // the active uniform of that name, as a handle that sets it without any lookup. the handle is invalid if the
+    // program has no such uniform, or if its GLSL type does not take a T.
+    // ------------------------------------------------------------------------
+    template <typename T>
+    UniformHandle<T> uniform(UniformName name) const
+    {
+        UniformHandle<T> handle;
+        auto found = std::lower_bound(uniforms.begin(), uniforms.end(), name.hash,
+                                      [](const UniformSlot &slot, uint64_t hash) { return slot.hash < hash; });
+        if (found == uniforms.end() || found->hash != name.hash)
+            return handle;
+        if (!UniformTraits<T>::Matches(found->type))
+        {
+            if (!found->mismatchReported)
+                std::cout << "ERROR::SHADER::UNIFORM " << found->name << " set with the wrong type" << std::endl;
+            found->mismatchReported = true;
+            return handle;
+        }
+        handle.slot = static_cast<int>(found - uniforms.begin());
+        return handle;
+    }
+    // uploads the value to the bound program, unless the uniform already holds it
+    // ------------------------------------------------------------------------
+    template <typename T>
+    void set(UniformHandle<T> handle, const T &value) const
+    {
+        static_assert(sizeof(T) <= sizeof(UniformSlot::value), "uniform larger than a mat4");
+        if (!handle.Valid())
+            return;
+        UniformSlot &slot = uniforms[handle.slot];
+        if (slot.known && memcmp(slot.value, &value, sizeof(T)) == 0)
+        {
+            UniformStats::Global().skipped++;
+            return;
+        }
+        memcpy(slot.value, &value, sizeof(T));
+        slot.known = true;
+        UniformTraits<T>::Upload(slot.location, value);
+        UniformStats::Global().issued++;
+    }
+    template <typename T>
+    void set(UniformName name, const T &value) const
+    {
+        set(uniform<T>(name), value);
+    }
+    // utility uniform functions, hashing the name at run time
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        set(runtimeName(name), (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        set(runtimeName(name), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        set(runtimeName(name), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        set(runtimeName(name), value);
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        set(runtimeName(name), glm::vec2(x, y));
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        set(runtimeName(name), value);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        set(runtimeName(name), glm::vec3(x, y, z));
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        set(runtimeName(name), value);
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        set(runtimeName(name), glm::vec4(x, y, z, w));
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(runtimeName(name), mat);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(runtimeName(name), mat);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(runtimeName(name), mat);
     }
 
 private:
-    // utility function for checking shader compilation/linking errors.
+    // between Compile() and Finish() of a program that was not in the cache
+    bool pending = false;
+    unsigned int stages[4] = {0, 0, 0, 0};
+    std::string cachePath;
+    uint64_t cacheKey = 0;
+    std::vector<std::string> feedbackVaryings;
+    // files making up each stage, in #line source string order
+    std::vector<std::string> sourceFiles[4];
+
+    // an active uniform and the value it was last set to through this class
+    struct UniformSlot
+    {
+        uint64_t hash;
+        GLint location;
+        GLenum type;
+        bool known;
+        bool mismatchReported;
+        float value[16];
+        std::string name;
+    };
+    // sorted by hash. the shadowed values are a cache of program state, so the setters stay const.
+    mutable std::vector<UniformSlot> uniforms;
+
+    static UniformName runtimeName(const std::string &name)
+    {
+        return UniformName{UniformHash(name.c_str())};
+    }
+
+    // reads the active uniforms of the linked program. an array is addressable as "name" and as "name[i]" for
+    // every element; uniforms in blocks have no location and are left out.
+    void reflectUniforms()
+    {
+        uniforms.clear();
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> buffer(maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, i, buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            if (glGetUniformLocation(ID, name.c_str()) < 0)
+                continue;
+            bool array = size > 1 || (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0);
+            if (!array)
+            {
+                addUniform(name, type);
+                continue;
+            }
+            std::string base = name.substr(0, name.find_last_of('['));
+            addUniform(base, type, base + "[0]");
+            for (GLint element = 0; element < size; element++)
+                addUniform(base + "[" + std::to_string(element) + "]", type);
+        }
+        std::sort(uniforms.begin(), uniforms.end(), [](const UniformSlot &a, const UniformSlot &b) { return a.hash < b.hash; });
+        for (size_t i = 1; i < uniforms.size(); i++)
+            if (uniforms[i].hash == uniforms[i - 1].hash)
+                std::cout << "ERROR::SHADER::UNIFORM hash collision of " << uniforms[i - 1].name << " and " << uniforms[i].name << std::endl;
+    }
+
+    // connects each uniform block to the binding point of the shared block of its name. the binding is not part of
+    // a program binary, so this runs after loading one from the cache too.
+    void bindUniformBlocks()
+    {
+        GLint count = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            char name[64];
+            glGetActiveUniformBlockName(ID, i, sizeof(name), nullptr, name);
+            const UniformBlock *block = FindUniformBlock(name);
+            GLint size = 0;
+            glGetActiveUniformBlockiv(ID, i, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+            if (!block || static_cast<size_t>(size) != block->size)
+            {
+                std::cout << "ERROR::SHADER::UNIFORM_BLOCK " << name << " does not match any shared block" << std::endl;
+                continue;
+            }
+            glUniformBlockBinding(ID, i, block->binding);
+        }
+    }
+
+    void addUniform(const std::string &name, GLenum type, const std::string &locationName = "")
+    {
+        UniformSlot slot;
+        slot.hash = UniformHash(name.c_str());
+        slot.location = glGetUniformLocation(ID, (locationName.empty() ? name : locationName).c_str());
+        slot.type = type;
+        slot.known = false;
+        slot.mismatchReported = false;
+        slot.name = name;
+        uniforms.push_back(slot);
+    }
+
+    // the #version directive has to stay the first line
+    static std::string insertDefines(const std::string &code, const std::string &defines)
+    {
+        if (defines.empty() || code.empty())
+            return code;
+        size_t lineEnd = code.compare(0, 8, "#version") == 0 ? code.find('\n') : std::string::npos;
+        if (lineEnd == std::string::npos)
+            return defines + "#line 1 0\n" + code;
+        return code.substr(0, lineEnd + 1) + defines + "#line 2 0\n" + code.substr(lineEnd + 1);
+    }
+
+    // replaces each #include "file" line with the contents of the file, found relative to the including file. a file
+    // is included once per stage, repeated includes of it are dropped. #line directives keep compile errors pointing
+    // at the right place: source string n is files[n].
+    static std::string resolveIncludes(const std::string &code, const std::string &path, std::vector<std::string> &files)
+    {
+        size_t source = files.size();
+        files.push_back(path);
+        size_t slash = path.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+        std::istringstream in(code);
+        std::string result, line;
+        for (int lineNumber = 1; std::getline(in, line); lineNumber++)
+        {
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+            {
+                result += line;
+                result += '\n';
+                continue;
+            }
+            size_t open = line.find('"', start + 8);
+            size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+            if (close == std::string::npos)
+            {
+                std::cout << "ERROR::SHADER::INCLUDE malformed directive at " << path << ":" << lineNumber << std::endl;
+                result += '\n';
+                continue;
+            }
+            std::string includePath = directory + line.substr(open + 1, close - open - 1);
+            if (std::find(files.begin(), files.end(), includePath) != files.end())
+            {
+                result += '\n';
+                continue;
+            }
+            std::ifstream file(includePath);
+            if (!file)
+            {
+                std::cout << "ERROR::SHADER::INCLUDE cannot read " << includePath << " included at " << path << ":" << lineNumber << std::endl;
+                result += '\n';
+                continue;
+            }
+            std::stringstream contents;
+            contents << file.rdbuf();
+            result += "#line 1 " + std::to_string(files.size()) + "\n";
+            result += resolveIncludes(contents.str(), includePath, files);
+            result += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(source) + "\n";
+        }
+        return result;
+    }
+
+    // utility function for checking shader compilation/linking errors, true if there were none.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -193,6 +531,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
 #endif
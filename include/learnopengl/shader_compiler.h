@@ -0,0 +1,128 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/shader.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// builds all programs of the scene together instead of one after the other. every program is handed to the driver
+// before any status is asked for, so a driver with KHR_parallel_shader_compile (or one that compiles on its own
+// threads anyway) works on all of them at once, and Poll() finishes the ones that are done without waiting for the
+// rest. WarmUp() then draws once with every registered program and state combination, off screen, so the driver builds
+// the state dependent variants of its shaders before the first real frame rather than in the middle of it.
+class ShaderCompiler
+{
+public:
+    ShaderCompiler()
+    {
+        // as many compiler threads as the driver wants to use
+        if (GLExt().parallelShaderCompile)
+            GLExt().MaxShaderCompilerThreads(0xFFFFFFFF);
+    }
+
+    ShaderCompiler(const ShaderCompiler &) = delete;
+    ShaderCompiler &operator=(const ShaderCompiler &) = delete;
+
+    // the shader has to outlive the compiler (or at least the last Poll/WarmUp)
+    void Submit(Shader &shader, const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr, const std::string &defines = "")
+    {
+        shader.Compile(vertexPath, fragmentPath, geometryPath, defines);
+        pending.push_back(&shader);
+    }
+
+    void SubmitCompute(Shader &shader, const char *computePath, const std::string &defines = "")
+    {
+        shader.CompileCompute(computePath, defines);
+        pending.push_back(&shader);
+    }
+
+    // finishes the programs the driver reports complete; true once all are
+    bool Poll()
+    {
+        for (size_t i = 0; i < pending.size();)
+        {
+            if (!pending[i]->IsReady())
+            {
+                i++;
+                continue;
+            }
+            pending[i]->Finish();
+            pending[i] = pending.back();
+            pending.pop_back();
+        }
+        return pending.empty();
+    }
+
+    // waits for the driver to finish everything still pending
+    void FinishAll()
+    {
+        for (Shader *shader : pending)
+            shader->Finish();
+        pending.clear();
+    }
+
+    // a combination to warm up: the program drawn from the VAO, with setState/restoreState switching any pipeline
+    // state (blending, depth function, ...) it is used with that differs from the defaults
+    void AddWarmup(Shader &shader, unsigned int vao, std::function<void()> setState = nullptr, std::function<void()> restoreState = nullptr)
+    {
+        warmups.push_back(Warmup{&shader, vao, setState, restoreState});
+    }
+
+    // draws one triangle per combination into a 1x1 framebuffer of its own, with the color and depth/stencil formats
+    // of the window's, so the draws are real but nothing on screen changes. finishes any program still pending first.
+    // leaves the default framebuffer bound with the viewport it had.
+    void WarmUp()
+    {
+        FinishAll();
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLuint framebuffer, renderbuffers[2];
+        glGenFramebuffers(1, &framebuffer);
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1, 1);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, 1, 1);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        glViewport(0, 0, 1, 1);
+
+        GLState &state = GLState::Get();
+        for (const Warmup &warmup : warmups)
+        {
+            if (warmup.setState)
+                warmup.setState();
+            state.UseProgram(warmup.shader->ID);
+            state.BindVertexArray(warmup.vao);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            if (warmup.restoreState)
+                warmup.restoreState();
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(2, renderbuffers);
+        warmups.clear();
+    }
+
+private:
+    struct Warmup
+    {
+        Shader *shader;
+        unsigned int vao;
+        std::function<void()> setState;
+        std::function<void()> restoreState;
+    };
+
+    std::vector<Shader *> pending;
+    std::vector<Warmup> warmups;
+};
+#endif
@@ -0,0 +1,105 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include <learnopengl/shader.h>
+#include <learnopengl/shader_compiler.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// feature switches of the lit shaders (lit.vs/lit.fs), each one compiled in as a #define of the same name
+enum ShaderFeature : unsigned int
+{
+    SHADER_ALPHA_TEST = 1 << 0,     // discard transparent texels of the diffuse map
+    SHADER_FOG = 1 << 1,            // fade to the fog color with depth
+    SHADER_NORMAL_MAP = 1 << 2,     // perturb the normal with the material's normal map
+    SHADER_INSTANCED = 1 << 3,      // the model matrix of each instance from vertex attributes, see InstanceCuller
+};
+
+const char *const SHADER_FEATURE_NAMES[] = {"ALPHA_TEST", "FOG", "NORMAL_MAP", "INSTANCED"};
+const unsigned int SHADER_FEATURE_COUNT = sizeof(SHADER_FEATURE_NAMES) / sizeof(SHADER_FEATURE_NAMES[0]);
+
+// the #defines of a permutation
+inline std::string ShaderFeatureDefines(unsigned int features, unsigned int numLights)
+{
+    std::string defines;
+    for (unsigned int i = 0; i < SHADER_FEATURE_COUNT; i++)
+        if (features & (1u << i))
+            defines += std::string("#define ") + SHADER_FEATURE_NAMES[i] + "\n";
+    defines += "#define NUM_LIGHTS " + std::to_string(numLights) + "\n";
+    return defines;
+}
+
+// one vertex/fragment shader pair compiled once per feature set and light count, instead of a single shader that
+// branches on every feature at run time. only the permutations the scene asks for with Require() are compiled, so
+// each material draws with exactly the code it needs and the compiler strips the rest.
+class ShaderPermutations
+{
+public:
+    // defines go in front of the feature defines of every permutation (e.g. VERTEX_FORMAT_DEFINES)
+    ShaderPermutations(const std::string &vertexPath, const std::string &fragmentPath, const std::string &defines = "")
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), defines(defines)
+    {
+    }
+
+    ShaderPermutations(const ShaderPermutations &) = delete;
+    ShaderPermutations &operator=(const ShaderPermutations &) = delete;
+
+    // adds a permutation the scene draws with; it is compiled by the next Submit()
+    void Require(unsigned int features, unsigned int numLights = 1)
+    {
+        std::unique_ptr<Shader> &shader = permutations[key(features, numLights)];
+        if (shader)
+            return;
+        shader.reset(new Shader());
+        unsubmitted.push_back(key(features, numLights));
+    }
+
+    // hands every permutation required since the last call to the compiler
+    void Submit(ShaderCompiler &compiler)
+    {
+        for (uint32_t permutation : unsubmitted)
+        {
+            std::string permutationDefines = defines + ShaderFeatureDefines(permutation & 0xFFFF, permutation >> 16);
+            compiler.Submit(*permutations[permutation], vertexPath.c_str(), fragmentPath.c_str(), nullptr, permutationDefines);
+        }
+        unsubmitted.clear();
+    }
+
+    // the permutation with exactly these features, null if it was never required
+    Shader *Find(unsigned int features, unsigned int numLights = 1)
+    {
+        auto found = permutations.find(key(features, numLights));
+        return found == permutations.end() ? nullptr : found->second.get();
+    }
+
+    // calls f(shader, features) for every permutation, e.g. to set the uniforms they share
+    template <typename F>
+    void ForEach(F f)
+    {
+        for (auto &permutation : permutations)
+            f(*permutation.second, permutation.first & 0xFFFF);
+    }
+
+    size_t Size() const
+    {
+        return permutations.size();
+    }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string defines;
+    // features in the low 16 bits, light count above
+    std::map<uint32_t, std::unique_ptr<Shader>> permutations;
+    std::vector<uint32_t> unsubmitted;
+
+    static uint32_t key(unsigned int features, unsigned int numLights)
+    {
+        return (features & 0xFFFF) | (numLights << 16);
+    }
+};
+#endif
@@ -0,0 +1,315 @@
+#ifndef SOFTWARE_OCCLUSION_H
+#define SOFTWARE_OCCLUSION_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HANGAR_RASTER_SSE
+#endif
+
+// model space triangles of a mesh that hides what is behind it, kept by Model::KeepOccluders
+struct OccluderGeometry
+{
+    uint32_t mesh;      // index in Model::meshes
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+};
+
+// occlusion culling on the CPU, the alternative to OcclusionCuller's GPU queries: a few large occluders are
+// rasterized into a small depth buffer every frame, and the boxes of the meshes in view are tested against it before
+// anything is submitted. no GL is involved, so there is no readback and no frame of latency.
+//
+// the buffer holds 1/w (larger is closer), which unlike window z is linear in screen space and keeps its precision
+// over the 0.1 to 100000 depth range of the scene. rows are rasterized 4 pixels at a time with SSE2, the bands of
+// TILE rows split between worker threads, and each TILE x TILE tile keeps the farthest depth in it so a box can be
+// found hidden by a tile without reading its pixels.
+class SoftwareOcclusion
+{
+public:
+    static const int WIDTH = 256;
+    static const int HEIGHT = 144;
+    static const int TILE = 8;
+
+    // occluder triangles rasterized, and meshes tested and found hidden, since the last Begin
+    struct Stats
+    {
+        unsigned long triangles = 0;
+        unsigned long tested = 0;
+        unsigned long skipped = 0;
+    };
+
+    // threadCount 0 uses up to 4 workers, leaving one hardware thread to the render thread
+    explicit SoftwareOcclusion(unsigned int threadCount = 0)
+        : workers(threadCount ? threadCount : std::max(1u, std::min(4u, std::thread::hardware_concurrency() - 1)))
+    {
+        depth.resize(WIDTH * HEIGHT);
+        tileFarthest.resize(TILES_X * TILES_Y);
+    }
+
+    SoftwareOcclusion(const SoftwareOcclusion &) = delete;
+    SoftwareOcclusion &operator=(const SoftwareOcclusion &) = delete;
+
+    uint32_t AddObject()
+    {
+        objects.push_back(std::vector<uint8_t>());
+        return static_cast<uint32_t>(objects.size() - 1);
+    }
+
+    // starts a frame: clears the occluders and the depth
+    void Begin(const glm::mat4 &viewProjection)
+    {
+        this->viewProjection = viewProjection;
+        triangles.clear();
+        stats = Stats();
+    }
+
+    // transforms the occluder to the screen, clipping it at the near plane; it is drawn by the next Rasterize
+    void AddOccluder(const OccluderGeometry &occluder, const glm::mat4 &model)
+    {
+        glm::mat4 transform = viewProjection * model;
+        clip.resize(occluder.positions.size());
+        for (size_t i = 0; i < occluder.positions.size(); i++)
+            clip[i] = transform * glm::vec4(occluder.positions[i], 1.0f);
+        for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3)
+            addTriangle(clip[occluder.indices[i]], clip[occluder.indices[i + 1]], clip[occluder.indices[i + 2]]);
+    }
+
+    // rasterizes the occluders on the workers and waits for them
+    void Rasterize()
+    {
+        stats.triangles = triangles.size();
+        unsigned int bands = std::min<unsigned int>(workers.Size() * 2, TILES_Y);
+        for (unsigned int band = 0; band < bands; band++)
+        {
+            int firstTileRow = TILES_Y * band / bands, lastTileRow = TILES_Y * (band + 1) / bands;
+            workers.Submit([this, firstTileRow, lastTileRow] { rasterizeBand(firstTileRow, lastTileRow); });
+        }
+        workers.Wait();
+    }
+
+    // false if the box (model space) is behind the occluders everywhere it covers
+    bool IsVisible(const AABB &bounds, const glm::mat4 &model) const
+    {
+        glm::mat4 transform = viewProjection * model;
+        float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY, nearest = 0.0f;
+        for (int corner = 0; corner < 8; corner++)
+        {
+            glm::vec3 position(corner & 1 ? bounds.max.x : bounds.min.x, corner & 2 ? bounds.max.y : bounds.min.y,
+                               corner & 4 ? bounds.max.z : bounds.min.z);
+            glm::vec4 p = transform * glm::vec4(position, 1.0f);
+            // crosses the near plane, its projection is unbounded
+            if (p.z < -p.w)
+                return true;
+            float inverseW = 1.0f / p.w;
+            float x = (p.x * inverseW * 0.5f + 0.5f) * WIDTH, y = (p.y * inverseW * 0.5f + 0.5f) * HEIGHT;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            nearest = std::max(nearest, inverseW);
+        }
+        int x0 = std::max(0, static_cast<int>(std::floor(minX))), x1 = std::min(WIDTH - 1, static_cast<int>(std::floor(maxX)));
+        int y0 = std::max(0, static_cast<int>(std::floor(minY))), y1 = std::min(HEIGHT - 1, static_cast<int>(std::floor(maxY)));
+        if (x0 > x1 || y0 > y1)
+            return true;
+
+        for (int tileY = y0 / TILE; tileY <= y1 / TILE; tileY++)
+        {
+            for (int tileX = x0 / TILE; tileX <= x1 / TILE; tileX++)
+            {
+                if (tileFarthest[tileY * TILES_X + tileX] > nearest)
+                    continue;
+                int rowEnd = std::min(y1, tileY * TILE + TILE - 1), columnEnd = std::min(x1, tileX * TILE + TILE - 1);
+                for (int y = std::max(y0, tileY * TILE); y <= rowEnd; y++)
+                    for (int x = std::max(x0, tileX * TILE); x <= columnEnd; x++)
+                        if (depth[y * WIDTH + x] <= nearest)
+                            return true;
+            }
+        }
+        return false;
+    }
+
+    // the frustum visibility of an object's meshes with the hidden ones cleared, valid until the next call for the
+    // object. bounds and model place the meshes like in the frame the occluders were added in.
+    const uint8_t *Filter(uint32_t object, const std::vector<uint8_t> &frustumVisible, const std::vector<AABB> &bounds,
+                          const glm::mat4 &model)
+    {
+        std::vector<uint8_t> &visibility = objects[object];
+        visibility.assign(frustumVisible.begin(), frustumVisible.end());
+        for (size_t i = 0; i < visibility.size() && i < bounds.size(); i++)
+        {
+            if (!visibility[i])
+                continue;
+            stats.tested++;
+            if (!IsVisible(bounds[i], model))
+            {
+                visibility[i] = 0;
+                stats.skipped++;
+            }
+        }
+        return visibility.data();
+    }
+
+    const Stats &GetStats() const
+    {
+        return stats;
+    }
+
+private:
+    static const int TILES_X = WIDTH / TILE;
+    static const int TILES_Y = HEIGHT / TILE;
+    static_assert(WIDTH % TILE == 0 && HEIGHT % TILE == 0 && TILE % 4 == 0, "whole tiles of whole SSE groups");
+
+    // screen space: x and y in pixels, z holds 1/w
+    struct Triangle
+    {
+        glm::vec3 v[3];
+    };
+
+    ThreadPool workers;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    std::vector<Triangle> triangles;
+    std::vector<glm::vec4> clip;
+    std::vector<float> depth;
+    std::vector<float> tileFarthest;
+    std::vector<std::vector<uint8_t>> objects;
+    Stats stats;
+
+    glm::vec3 toScreen(const glm::vec4 &p) const
+    {
+        float inverseW = 1.0f / p.w;
+        return glm::vec3((p.x * inverseW * 0.5f + 0.5f) * WIDTH, (p.y * inverseW * 0.5f + 0.5f) * HEIGHT, inverseW);
+    }
+
+    void addTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c)
+    {
+        // entirely outside one of the side planes
+        if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+            (a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w))
+            return;
+        // clipped against the near plane z = -w, which leaves a triangle or a quad
+        const glm::vec4 in[3] = {a, b, c};
+        glm::vec4 out[4];
+        int count = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            const glm::vec4 &p = in[i], &q = in[(i + 1) % 3];
+            float dp = p.z + p.w, dq = q.z + q.w;
+            if (dp >= 0.0f)
+                out[count++] = p;
+            if ((dp >= 0.0f) != (dq >= 0.0f))
+                out[count++] = p + (q - p) * (dp / (dp - dq));
+        }
+        for (int i = 1; i + 1 < count; i++)
+        {
+            Triangle triangle;
+            triangle.v[0] = toScreen(out[0]);
+            triangle.v[1] = toScreen(out[i]);
+            triangle.v[2] = toScreen(out[i + 1]);
+            triangles.push_back(triangle);
+        }
+    }
+
+    void rasterizeBand(int firstTileRow, int lastTileRow)
+    {
+        int bandTop = firstTileRow * TILE, bandBottom = lastTileRow * TILE;
+        std::fill(depth.begin() + bandTop * WIDTH, depth.begin() + bandBottom * WIDTH, 0.0f);
+        for (const Triangle &triangle : triangles)
+            rasterizeTriangle(triangle, bandTop, bandBottom);
+
+        for (int tileY = firstTileRow; tileY < lastTileRow; tileY++)
+        {
+            for (int tileX = 0; tileX < TILES_X; tileX++)
+            {
+                float farthest = INFINITY;
+                for (int y = tileY * TILE; y < tileY * TILE + TILE; y++)
+                    for (int x = tileX * TILE; x < tileX * TILE + TILE; x++)
+                        farthest = std::min(farthest, depth[y * WIDTH + x]);
+                tileFarthest[tileY * TILES_X + tileX] = farthest;
+            }
+        }
+    }
+
+    // the rows [bandTop, bandBottom) of the triangle, sampled at pixel centers
+    void rasterizeTriangle(const Triangle &triangle, int bandTop, int bandBottom)
+    {
+        glm::vec3 v0 = triangle.v[0], v1 = triangle.v[1], v2 = triangle.v[2];
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if (std::fabs(area) < 1e-8f)
+            return;
+        // occluders are drawn from both sides, wound counterclockwise here
+        if (area < 0.0f)
+        {
+            std::swap(v1, v2);
+            area = -area;
+        }
+        int minX = std::max(0, static_cast<int>(std::floor(std::min(v0.x, std::min(v1.x, v2.x)))));
+        int maxX = std::min(WIDTH - 1, static_cast<int>(std::ceil(std::max(v0.x, std::max(v1.x, v2.x)))));
+        int minY = std::max(bandTop, static_cast<int>(std::floor(std::min(v0.y, std::min(v1.y, v2.y)))));
+        int maxY = std::min(bandBottom - 1, static_cast<int>(std::ceil(std::max(v0.y, std::max(v1.y, v2.y)))));
+        if (minX > maxX || minY > maxY)
+            return;
+
+        // edge functions e = a * x + b * y + c, all >= 0 inside. edge i is opposite vertex i, so e_i / area is the
+        // barycentric weight of vertex i and 1/w interpolates as z = zx * x + zy * y + zc
+        const glm::vec3 *from[3] = {&v1, &v2, &v0}, *to[3] = {&v2, &v0, &v1};
+        float ea[3], eb[3], ec[3];
+        for (int i = 0; i < 3; i++)
+        {
+            ea[i] = from[i]->y - to[i]->y;
+            eb[i] = to[i]->x - from[i]->x;
+            ec[i] = -(ea[i] * from[i]->x + eb[i] * from[i]->y);
+        }
+        float inverseArea = 1.0f / area;
+        float zx = (ea[0] * v0.z + ea[1] * v1.z + ea[2] * v2.z) * inverseArea;
+        float zy = (eb[0] * v0.z + eb[1] * v1.z + eb[2] * v2.z) * inverseArea;
+        float zc = (ec[0] * v0.z + ec[1] * v1.z + ec[2] * v2.z) * inverseArea;
+        // pushed out by 1/256 of a pixel, so rounding does not open cracks between triangles sharing an edge
+        for (int i = 0; i < 3; i++)
+            ec[i] += (std::fabs(ea[i]) + std::fabs(eb[i])) * (1.0f / 256.0f);
+
+        int firstColumn = minX & ~3;
+        for (int y = minY; y <= maxY; y++)
+        {
+            float py = y + 0.5f;
+            float *row = &depth[y * WIDTH];
+#ifdef HANGAR_RASTER_SSE
+            __m128 rowEdge0 = _mm_set1_ps(eb[0] * py + ec[0]), rowEdge1 = _mm_set1_ps(eb[1] * py + ec[1]);
+            __m128 rowEdge2 = _mm_set1_ps(eb[2] * py + ec[2]), rowDepth = _mm_set1_ps(zy * py + zc);
+            __m128 a0 = _mm_set1_ps(ea[0]), a1 = _mm_set1_ps(ea[1]), a2 = _mm_set1_ps(ea[2]), dzdx = _mm_set1_ps(zx);
+            __m128 zero = _mm_setzero_ps();
+            for (int x = firstColumn; x <= maxX; x += 4)
+            {
+                __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+                __m128 inside = _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), rowEdge0), zero),
+                                           _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), rowEdge1), zero));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), rowEdge2), zero));
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+                __m128 current = _mm_loadu_ps(row + x);
+                __m128 closer = _mm_max_ps(current, _mm_add_ps(_mm_mul_ps(dzdx, px), rowDepth));
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, current)));
+            }
+#else
+            for (int x = firstColumn; x <= maxX; x++)
+            {
+                float px = x + 0.5f;
+                if (ea[0] * px + eb[0] * py + ec[0] >= 0.0f && ea[1] * px + eb[1] * py + ec[1] >= 0.0f &&
+                    ea[2] * px + eb[2] * py + ec[2] >= 0.0f)
+                    row[x] = std::max(row[x], zx * px + zy * py + zc);
+            }
+#endif
+        }
+    }
+};
+#endif
@@ -0,0 +1,475 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/image.h>
+#include <learnopengl/ktx.h>
+#include <learnopengl/material.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// S3TC is an extension, not core (RGTC, used for BC4/BC5, is core since 3.0)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+
+// block compression of a material texture:
+// BC1 (S3TC DXT1) for color, 4 bpp with 1-bit alpha; BC4 (RGTC1) for single channel maps such as roughness;
+// BC5 (RGTC2) for normal maps, x and y only (z = sqrt(1 - x*x - y*y) in the shader).
+enum class TextureEncoding : uint32_t
+{
+    Raw,
+    BC1,
+    BC4,
+    BC5
+};
+
+// the encoding of a texture follows its material slot (Texture::type)
+inline TextureEncoding TextureEncodingFor(TextureType type)
+{
+    if (type == TextureType::Normal)
+        return TextureEncoding::BC5;
+    if (type == TextureType::Specular) // roughness maps, sampled as .x
+        return TextureEncoding::BC4;
+    return TextureEncoding::BC1;
+}
+
+namespace detail
+{
+    // the 4x4 block at (bx, by) as RGBA, pixels past the image edge repeat the last row/column
+    inline void fetchBlock(const Image &image, int bx, int by, unsigned char block[16][4])
+    {
+        for (int y = 0; y < 4; y++)
+        {
+            for (int x = 0; x < 4; x++)
+            {
+                int px = std::min(bx * 4 + x, image.width - 1);
+                int py = std::min(by * 4 + y, image.height - 1);
+                const unsigned char *p = &image.pixels[((size_t)py * image.width + px) * image.channels];
+                unsigned char *out = block[y * 4 + x];
+                out[0] = p[0];
+                out[1] = image.channels >= 3 ? p[1] : p[0];
+                out[2] = image.channels >= 3 ? p[2] : p[0];
+                out[3] = image.channels == 4 ? p[3] : image.channels == 2 ? p[1] : 255;
+            }
+        }
+    }
+
+    inline uint16_t packRGB565(const float color[3])
+    {
+        int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+        int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+        int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    inline void unpackRGB565(uint16_t packed, float color[3])
+    {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (float)((r << 3) | (r >> 2));
+        color[1] = (float)((g << 2) | (g >> 4));
+        color[2] = (float)((b << 3) | (b >> 2));
+    }
+
+    // four colors when c0 > c1, otherwise three and transparent black
+    inline void bc1Palette(uint16_t c0, uint16_t c1, float palette[4][3])
+    {
+        unpackRGB565(c0, palette[0]);
+        unpackRGB565(c1, palette[1]);
+        for (int k = 0; k < 3; k++)
+        {
+            if (c0 > c1)
+            {
+                palette[2][k] = (2.0f * palette[0][k] + palette[1][k]) / 3.0f;
+                palette[3][k] = (palette[0][k] + 2.0f * palette[1][k]) / 3.0f;
+            }
+            else
+            {
+                palette[2][k] = (palette[0][k] + palette[1][k]) / 2.0f;
+                palette[3][k] = 0.0f;
+            }
+        }
+    }
+
+    // nearest palette entry per pixel, transparent pixels get index 3
+    inline void bc1Indices(const float pixels[16][3], const bool transparent[16], uint16_t c0, uint16_t c1, unsigned char indices[16])
+    {
+        float palette[4][3];
+        bc1Palette(c0, c1, palette);
+        int colors = c0 > c1 ? 4 : 3;
+        for (int i = 0; i < 16; i++)
+        {
+            if (transparent[i])
+            {
+                indices[i] = 3;
+                continue;
+            }
+            float bestError = 1e30f;
+            for (int k = 0; k < colors; k++)
+            {
+                float dr = pixels[i][0] - palette[k][0], dg = pixels[i][1] - palette[k][1], db = pixels[i][2] - palette[k][2];
+                float error = dr * dr + dg * dg + db * db;
+                if (error < bestError)
+                {
+                    bestError = error;
+                    indices[i] = k;
+                }
+            }
+        }
+    }
+
+    // least squares endpoints for fixed indices; false if the system is singular (all pixels on one index)
+    inline bool bc1RefineEndpoints(const float pixels[16][3], const bool transparent[16], const unsigned char indices[16], bool fourColors,
+                                   float e0[3], float e1[3])
+    {
+        static const float weights4[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        static const float weights3[3] = {1.0f, 0.0f, 0.5f};
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[3] = {0, 0, 0}, bx[3] = {0, 0, 0};
+        for (int i = 0; i < 16; i++)
+        {
+            if (transparent[i])
+                continue;
+            float a = fourColors ? weights4[indices[i]] : weights3[indices[i]];
+            float b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int k = 0; k < 3; k++)
+            {
+                ax[k] += a * pixels[i][k];
+                bx[k] += b * pixels[i][k];
+            }
+        }
+        float det = aa * bb - ab * ab;
+        if (std::fabs(det) < 1e-6f)
+            return false;
+        for (int k = 0; k < 3; k++)
+        {
+            e0[k] = (ax[k] * bb - bx[k] * ab) / det;
+            e1[k] = (bx[k] * aa - ax[k] * ab) / det;
+        }
+        return true;
+    }
+
+    // endpoints from the principal axis of the block's colors, refined twice by least squares
+    inline void encodeBC1Block(const unsigned char block[16][4], bool punchThroughAlpha, unsigned char out[8])
+    {
+        float pixels[16][3];
+        bool transparent[16];
+        float mean[3] = {0, 0, 0};
+        int opaque = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            transparent[i] = punchThroughAlpha && block[i][3] < 128;
+            for (int k = 0; k < 3; k++)
+                pixels[i][k] = block[i][k];
+            if (!transparent[i])
+            {
+                for (int k = 0; k < 3; k++)
+                    mean[k] += pixels[i][k];
+                opaque++;
+            }
+        }
+
+        uint16_t c0 = 0, c1 = 0;
+        if (opaque > 0)
+        {
+            for (int k = 0; k < 3; k++)
+                mean[k] /= opaque;
+            float cov[6] = {0, 0, 0, 0, 0, 0};
+            for (int i = 0; i < 16; i++)
+            {
+                if (transparent[i])
+                    continue;
+                float r = pixels[i][0] - mean[0], g = pixels[i][1] - mean[1], b = pixels[i][2] - mean[2];
+                cov[0] += r * r;
+                cov[1] += r * g;
+                cov[2] += r * b;
+                cov[3] += g * g;
+                cov[4] += g * b;
+                cov[5] += b * b;
+            }
+            // power iteration for the dominant eigenvector
+            float axis[3] = {1.0f, 1.0f, 1.0f};
+            for (int iteration = 0; iteration < 8; iteration++)
+            {
+                float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+                float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+                float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+                float length = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+                if (length < 1e-6f)
+                    break;
+                axis[0] = x / length;
+                axis[1] = y / length;
+                axis[2] = z / length;
+            }
+            float minT = 1e30f, maxT = -1e30f;
+            for (int i = 0; i < 16; i++)
+            {
+                if (transparent[i])
+                    continue;
+                float t = (pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1] + (pixels[i][2] - mean[2]) * axis[2];
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+            float axisLength2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+            float e0[3], e1[3];
+            for (int k = 0; k < 3; k++)
+            {
+                e0[k] = mean[k] + axis[k] * maxT / std::max(axisLength2, 1e-6f);
+                e1[k] = mean[k] + axis[k] * minT / std::max(axisLength2, 1e-6f);
+            }
+            c0 = packRGB565(e0);
+            c1 = packRGB565(e1);
+
+            bool fourColors = !punchThroughAlpha || opaque == 16;
+            for (int iteration = 0; iteration < 2; iteration++)
+            {
+                uint16_t a = fourColors ? std::max(c0, c1) : std::min(c0, c1);
+                uint16_t b = fourColors ? std::min(c0, c1) : std::max(c0, c1);
+                unsigned char indices[16];
+                bc1Indices(pixels, transparent, a, b, indices);
+                if (!bc1RefineEndpoints(pixels, transparent, indices, a > b, e0, e1))
+                    break;
+                c0 = packRGB565(e0);
+                c1 = packRGB565(e1);
+            }
+            bool anyTransparent = opaque < 16;
+            // four colors need c0 > c1, three colors (and so transparency) c0 <= c1
+            if (anyTransparent ? c0 > c1 : c0 < c1)
+                std::swap(c0, c1);
+        }
+
+        unsigned char indices[16];
+        bc1Indices(pixels, transparent, c0, c1, indices);
+        uint32_t bits = 0;
+        for (int i = 0; i < 16; i++)
+            bits |= (uint32_t)indices[i] << (i * 2);
+        out[0] = c0 & 0xff;
+        out[1] = c0 >> 8;
+        out[2] = c1 & 0xff;
+        out[3] = c1 >> 8;
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = (bits >> (i * 8)) & 0xff;
+    }
+
+    // eight-value mode between the block's min and max
+    inline void encodeBC4Block(const unsigned char values[16], unsigned char out[8])
+    {
+        unsigned char lo = 255, hi = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            lo = std::min(lo, values[i]);
+            hi = std::max(hi, values[i]);
+        }
+        out[0] = hi;
+        out[1] = lo;
+        uint64_t bits = 0;
+        if (hi > lo)
+        {
+            float palette[8];
+            palette[0] = hi;
+            palette[1] = lo;
+            for (int k = 2; k < 8; k++)
+                palette[k] = ((8 - k) * hi + (k - 1) * lo) / 7.0f;
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0;
+                for (int k = 1; k < 8; k++)
+                    if (std::fabs(values[i] - palette[k]) < std::fabs(values[i] - palette[best]))
+                        best = k;
+                bits |= (uint64_t)best << (i * 3);
+            }
+        }
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = (bits >> (i * 8)) & 0xff;
+    }
+
+    inline void decodeBC1Block(const unsigned char in[8], unsigned char out[16][4])
+    {
+        uint16_t c0 = in[0] | (in[1] << 8), c1 = in[2] | (in[3] << 8);
+        float palette[4][3];
+        bc1Palette(c0, c1, palette);
+        uint32_t bits = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+        for (int i = 0; i < 16; i++)
+        {
+            int index = (bits >> (i * 2)) & 3;
+            for (int k = 0; k < 3; k++)
+                out[i][k] = (unsigned char)std::lround(palette[index][k]);
+            out[i][3] = (c0 <= c1 && index == 3) ? 0 : 255;
+        }
+    }
+}
+
+// encodes one mip level. BC1 with punchThroughAlpha marks pixels with alpha < 128 transparent.
+inline CompressedLevel CompressImage(const Image &image, TextureEncoding encoding, bool punchThroughAlpha)
+{
+    CompressedLevel level;
+    level.width = image.width;
+    level.height = image.height;
+    int blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+    size_t blockSize = encoding == TextureEncoding::BC5 ? 16 : 8;
+    level.data.resize((size_t)blocksX * blocksY * blockSize);
+
+    unsigned char block[16][4], channel[16];
+    unsigned char *out = level.data.data();
+    for (int by = 0; by < blocksY; by++)
+    {
+        for (int bx = 0; bx < blocksX; bx++, out += blockSize)
+        {
+            detail::fetchBlock(image, bx, by, block);
+            if (encoding == TextureEncoding::BC1)
+            {
+                detail::encodeBC1Block(block, punchThroughAlpha, out);
+                continue;
+            }
+            // BC4 takes red, BC5 red and then green
+            for (size_t c = 0; c < blockSize / 8; c++)
+            {
+                for (int i = 0; i < 16; i++)
+                    channel[i] = block[i][c];
+                detail::encodeBC4Block(channel, out + c * 8);
+            }
+        }
+    }
+    return level;
+}
+
+// encodes the image and its complete mip chain
+inline void CompressTexture(const Image &base, TextureEncoding encoding, CompressedTexture &texture)
+{
+    bool punchThroughAlpha = false;
+    if (encoding == TextureEncoding::BC1 && (base.channels == 2 || base.channels == 4))
+    {
+        for (size_t i = base.channels - 1; i < base.pixels.size() && !punchThroughAlpha; i += base.channels)
+            punchThroughAlpha = base.pixels[i] < 128;
+    }
+
+    switch (encoding)
+    {
+    case TextureEncoding::BC4:
+        texture.internalFormat = GL_COMPRESSED_RED_RGTC1;
+        texture.baseFormat = GL_RED;
+        break;
+    case TextureEncoding::BC5:
+        texture.internalFormat = GL_COMPRESSED_RG_RGTC2;
+        texture.baseFormat = GL_RG;
+        break;
+    default:
+        texture.internalFormat = punchThroughAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        texture.baseFormat = punchThroughAlpha ? GL_RGBA : GL_RGB;
+        break;
+    }
+    texture.levels.clear();
+    for (const Image &mip : BuildMipChain(base))
+        texture.levels.push_back(CompressImage(mip, encoding, punchThroughAlpha));
+}
+
+inline Image DecompressBC1(const unsigned char *data, int width, int height)
+{
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.channels = 4;
+    image.pixels.resize((size_t)width * height * 4);
+    unsigned char block[16][4];
+    for (int by = 0; by < (height + 3) / 4; by++)
+    {
+        for (int bx = 0; bx < (width + 3) / 4; bx++, data += 8)
+        {
+            detail::decodeBC1Block(data, block);
+            for (int i = 0; i < 16; i++)
+            {
+                int x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                if (x < width && y < height)
+                    memcpy(&image.pixels[((size_t)y * width + x) * 4], block[i], 4);
+            }
+        }
+    }
+    return image;
+}
+
+// compressed textures are cached next to the image as <image>.<encoding>.ktx (.up.ktx when flipped for GL's
+// bottom-up rows) and rebuilt whenever the image is newer than its cache
+inline std::string CompressedCachePath(const std::string &path, TextureEncoding encoding, bool flipVertically)
+{
+    static const char *const names[] = {"raw", "bc1", "bc4", "bc5"};
+    return path + "." + names[(int)encoding] + (flipVertically ? ".up" : "") + ".ktx";
+}
+
+// loads the compressed texture for the image at path from its cache, or decodes, compresses and caches it.
+// safe to call from worker threads.
+inline bool LoadCompressedTexture(const std::string &path, TextureEncoding encoding, bool flipVertically, CompressedTexture &texture)
+{
+    struct stat source, cached;
+    if (stat(path.c_str(), &source) != 0)
+        return false;
+    std::string cache = CompressedCachePath(path, encoding, flipVertically);
+    if (stat(cache.c_str(), &cached) == 0 && cached.st_mtime >= source.st_mtime && ReadKTX(cache, texture))
+        return true;
+
+    Image image;
+    if (!LoadImageFile(path, image, flipVertically))
+        return false;
+    CompressTexture(image, encoding, texture);
+
+    // written under a temporary name first, so nobody ever reads half a cache file
+    std::string temporary = cache + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    if (WriteKTX(temporary, texture))
+        std::rename(temporary.c_str(), cache.c_str());
+    else
+        std::remove(temporary.c_str());
+    return true;
+}
+
+// GL_EXT_texture_compression_s3tc; call with a current context
+inline bool HasS3TCSupport()
+{
+    static int supported = -1;
+    if (supported < 0)
+        supported = HasGLExtension("GL_EXT_texture_compression_s3tc") ? 1 : 0;
+    return supported == 1;
+}
+
+inline bool IsS3TCFormat(GLenum internalFormat)
+{
+    return internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+}
+
+// uploads one level of block-compressed data. without S3TC support BC1 is decoded here and uploaded as RGBA8.
+inline void UploadCompressedLevel(GLenum target, GLint level, GLenum internalFormat, int width, int height, const void *data, size_t size)
+{
+    if (IsS3TCFormat(internalFormat) && !HasS3TCSupport())
+    {
+        Image image = DecompressBC1(static_cast<const unsigned char *>(data), width, height);
+        glTexImage2D(target, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+        return;
+    }
+    glCompressedTexImage2D(target, level, internalFormat, width, height, 0, size, data);
+}
+
+// uploads every level into the currently bound texture and limits sampling to them
+inline void UploadCompressedTexture(GLenum target, const CompressedTexture &texture)
+{
+    for (size_t i = 0; i < texture.levels.size(); i++)
+    {
+        const CompressedLevel &level = texture.levels[i];
+        UploadCompressedLevel(target, i, texture.internalFormat, level.width, level.height, level.data.data(), level.data.size());
+    }
+    GLenum binding = target == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP;
+    if (!texture.levels.empty())
+        glTexParameteri(binding, GL_TEXTURE_MAX_LEVEL, texture.levels.size() - 1);
+}
+#endif
@@ -0,0 +1,186 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/image.h>
+#include <learnopengl/texture_compression.h>
+#include <learnopengl/thread_pool.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+// uploads a decoded image into the currently bound texture; the GL format follows the channel count.
+inline void UploadImage(GLenum target, const Image &image)
+{
+    GLenum format = GL_RGBA;
+    if (image.channels == 1)
+        format = GL_RED;
+    else if (image.channels == 2)
+        format = GL_RG;
+    else if (image.channels == 3)
+        format = GL_RGB;
+
+    // rows are tightly packed, RGB images with odd widths are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(target, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// texture loading service: images are decoded on a pool of worker threads while the finished pixel buffers
+// are queued and uploaded on the thread that owns the GL context, from Update() or Finish().
+// texture objects are created by the caller up front, so meshes can reference them before their images arrive.
+class TextureLoader
+{
+public:
+    // threadCount 0 uses one decoder per hardware thread
+    explicit TextureLoader(unsigned int threadCount = 0) : pool(threadCount) {}
+
+    // queues the image at path for the given texture and target (GL_TEXTURE_2D or a cube map face).
+    // sampler parameters are left to the caller, generateMipmap runs glGenerateMipmap after the upload.
+    // with a block compression encoding the worker loads (or builds) the cached KTX instead and its
+    // precomputed mip chain is uploaded, generateMipmap is ignored then.
+    void Enqueue(unsigned int texture, GLenum target, const std::string &path, bool flipVertically, bool generateMipmap,
+                 TextureEncoding encoding = TextureEncoding::Raw)
+    {
+        std::shared_ptr<Job> job = std::make_shared<Job>();
+        job->texture = texture;
+        job->target = target;
+        job->path = path;
+        job->flipVertically = flipVertically;
+        job->generateMipmap = generateMipmap;
+        job->encoding = encoding;
+        pendingTextures.insert(texture);
+
+        pool.Submit([this, job] {
+            auto start = std::chrono::steady_clock::now();
+            if (job->encoding == TextureEncoding::Raw)
+                job->decoded = LoadImageFile(job->path, job->image, job->flipVertically);
+            else
+                job->decoded = LoadCompressedTexture(job->path, job->encoding, job->flipVertically, job->compressed);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                decodeSeconds += elapsed.count();
+                finished.push_back(job);
+            }
+            jobFinished.notify_one();
+        });
+    }
+
+    // uploads finished images until budgetSeconds is used up (at least one per call). returns the number uploaded.
+    unsigned int Update(double budgetSeconds = 1e9)
+    {
+        auto start = std::chrono::steady_clock::now();
+        unsigned int uploaded = 0;
+        for (;;)
+        {
+            std::shared_ptr<Job> job;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (finished.empty())
+                    break;
+                job = finished.front();
+                finished.pop_front();
+            }
+            upload(*job);
+            uploaded++;
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= budgetSeconds)
+                break;
+        }
+        return uploaded;
+    }
+
+    // blocks until every queued image is decoded and uploaded
+    void Finish()
+    {
+        while (!pendingTextures.empty())
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobFinished.wait(lock, [this] { return !finished.empty(); });
+            }
+            Update();
+        }
+    }
+
+    // images queued but not uploaded yet
+    unsigned int Pending() const
+    {
+        return pendingTextures.size();
+    }
+
+    // true while the texture still waits for (one of) its images
+    bool IsPending(unsigned int texture) const
+    {
+        return pendingTextures.count(texture) != 0;
+    }
+
+    // summed decode time of all workers, compare with wall time to see how well decoding scales
+    double DecodeSeconds()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return decodeSeconds;
+    }
+
+    unsigned int ThreadCount() const
+    {
+        return pool.Size();
+    }
+
+private:
+    struct Job
+    {
+        unsigned int texture;
+        GLenum target;
+        std::string path;
+        bool flipVertically;
+        bool generateMipmap;
+        TextureEncoding encoding;
+        bool decoded = false;
+        Image image;
+        CompressedTexture compressed;
+    };
+
+    std::mutex mutex;
+    std::condition_variable jobFinished;
+    std::deque<std::shared_ptr<Job>> finished;
+    double decodeSeconds = 0.0;
+    std::unordered_multiset<unsigned int> pendingTextures;   // only touched on the GL thread
+    // declared last so the workers are joined before anything they push into is destroyed
+    ThreadPool pool;
+
+    void upload(Job &job)
+    {
+        pendingTextures.erase(pendingTextures.find(job.texture));
+        if (!job.decoded)
+        {
+            std::cout << "Texture failed to load at path: " << job.path << std::endl;
+            return;
+        }
+        GLenum binding = job.target == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP;
+        GLState &state = GLState::Get();
+        state.ActiveTexture(0);
+        state.BindTexture(0, binding, job.texture);
+        if (job.encoding != TextureEncoding::Raw)
+        {
+            UploadCompressedTexture(job.target, job.compressed);
+        }
+        else
+        {
+            UploadImage(job.target, job.image);
+            if (job.generateMipmap)
+                glGenerateMipmap(binding);
+        }
+        state.BindTexture(0, binding, 0);
+    }
+};
+#endif
@@ -0,0 +1,199 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/texture_compression.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 64-bit hash of a file's contents, read in 1 MB chunks. false if the file cannot be read.
+inline bool HashFileContents(const std::string &path, uint64_t &hash)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    // FNV-1a over 8 byte words with a final avalanche, fast enough to be I/O bound
+    hash = 14695981039346656037ull;
+    std::vector<char> buffer(1 << 20);
+    while (in)
+    {
+        in.read(buffer.data(), buffer.size());
+        size_t count = in.gcount();
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, &buffer[i], 8);
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        for (; i < count; i++)
+            hash = (hash ^ (unsigned char)buffer[i]) * 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return !in.bad();
+}
+
+// process-wide, reference counted registry of GL textures. a texture is looked up by its file path and, on a
+// miss, by the contents of the file, so the same image is uploaded once no matter how many models or differently
+// named copies refer to it. every Acquire has to be paired with a Release; the texture is deleted with the last.
+// only used from the GL thread.
+class TextureRegistry
+{
+public:
+    static TextureRegistry &Global()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
+
+    // returns the texture for the image file at path in the given encoding, calling create() to make it only if
+    // neither the path nor a file with identical contents is registered yet
+    unsigned int AcquireFile(const std::string &path, TextureEncoding encoding, const std::function<unsigned int()> &create)
+    {
+        std::string key = makeKey(path, encoding);
+        auto found = byKey.find(key);
+        if (found != byKey.end())
+        {
+            pathHits++;
+            return addReference(found->second);
+        }
+
+        // contents are only hashed when another registered file has the same size, most files never are
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0)
+        {
+            uint64_t sizeKey = (uint64_t)st.st_size * 4 + (uint64_t)encoding;
+            uint64_t hash = 0;
+            bool hashed = false;
+            for (unsigned int candidate : bySize[sizeKey])
+            {
+                Entry &entry = entries[candidate];
+                if (!entry.hashed)
+                    entry.hashed = HashFileContents(entry.file, entry.contentHash);
+                if (!hashed)
+                    hashed = HashFileContents(path, hash);
+                if (entry.hashed && hashed && entry.contentHash == hash)
+                {
+                    contentHits++;
+                    std::cout << "TEXTURE::REGISTRY:: " << path << " is identical to " << entry.file << std::endl;
+                    byKey[key] = candidate;
+                    entry.keys.push_back(key);
+                    return addReference(candidate);
+                }
+            }
+            unsigned int texture = insert(key, create());
+            Entry &entry = entries[texture];
+            entry.file = path;
+            entry.sizeKey = sizeKey;
+            entry.contentHash = hash;
+            entry.hashed = hashed;
+            bySize[sizeKey].push_back(texture);
+            return texture;
+        }
+        return insert(key, create());
+    }
+
+    // textures without a file to compare (e.g. from a scene archive, which is deduplicated when baked) are only
+    // looked up by name
+    unsigned int Acquire(const std::string &name, TextureEncoding encoding, const std::function<unsigned int()> &create)
+    {
+        std::string key = makeKey(name, encoding);
+        auto found = byKey.find(key);
+        if (found != byKey.end())
+        {
+            pathHits++;
+            return addReference(found->second);
+        }
+        return insert(key, create());
+    }
+
+    void Release(unsigned int texture)
+    {
+        auto found = entries.find(texture);
+        if (found == entries.end() || --found->second.references > 0)
+            return;
+        Entry &entry = found->second;
+        for (const std::string &key : entry.keys)
+            byKey.erase(key);
+        if (!entry.file.empty())
+        {
+            std::vector<unsigned int> &group = bySize[entry.sizeKey];
+            group.erase(std::find(group.begin(), group.end(), texture));
+            if (group.empty())
+                bySize.erase(entry.sizeKey);
+        }
+        GLState::Get().DeleteTexture(texture);
+        entries.erase(found);
+    }
+
+    // textures currently alive
+    size_t Size() const
+    {
+        return entries.size();
+    }
+
+    // number of uploads, and of lookups that reused a texture by path or by identical file contents
+    void Report(std::ostream &out) const
+    {
+        out << "TEXTURE::REGISTRY:: " << uploads << " uploads, " << pathHits + contentHits << " duplicate uploads avoided ("
+            << pathHits << " by path, " << contentHits << " by content), " << entries.size() << " alive" << std::endl;
+    }
+
+private:
+    struct Entry
+    {
+        unsigned int references = 0;
+        std::vector<std::string> keys;
+        // file textures only
+        std::string file;
+        uint64_t sizeKey = 0;
+        uint64_t contentHash = 0;
+        bool hashed = false;
+    };
+
+    std::unordered_map<unsigned int, Entry> entries;
+    std::unordered_map<std::string, unsigned int> byKey;
+    std::unordered_map<uint64_t, std::vector<unsigned int>> bySize;
+    unsigned int uploads = 0;
+    unsigned int pathHits = 0;
+    unsigned int contentHits = 0;
+
+    TextureRegistry() = default;
+    TextureRegistry(const TextureRegistry &) = delete;
+    TextureRegistry &operator=(const TextureRegistry &) = delete;
+
+    static std::string makeKey(const std::string &path, TextureEncoding encoding)
+    {
+        return path + '#' + std::to_string((int)encoding);
+    }
+
+    unsigned int addReference(unsigned int texture)
+    {
+        entries[texture].references++;
+        return texture;
+    }
+
+    unsigned int insert(const std::string &key, unsigned int texture)
+    {
+        uploads++;
+        Entry &entry = entries[texture];
+        entry.keys.push_back(key);
+        byKey[key] = texture;
+        return addReference(texture);
+    }
+};
+#endif
@@ -0,0 +1,138 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads consuming a FIFO of tasks. tasks must not touch GL, there is no context on the workers.
+class ThreadPool
+{
+public:
+    // threadCount 0 uses one worker per hardware thread
+    explicit ThreadPool(unsigned int threadCount = 0)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this] { run(); });
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // finishes the queued tasks, then joins the workers
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskReady.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    void Submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        taskReady.notify_one();
+    }
+
+    // blocks until every submitted task has finished
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return tasks.empty() && busy == 0; });
+    }
+
+    // runs body(0) .. body(count - 1) on the workers and the calling thread, and returns when all are done. unlike
+    // Wait it only waits for its own work, and it is safe to call from a task of this pool: helpers that find every
+    // index taken by the time a worker gets to them return without touching body.
+    void ParallelFor(size_t count, const std::function<void(size_t)> &body)
+    {
+        struct Loop
+        {
+            std::atomic<size_t> next{0};
+            size_t count;
+            const std::function<void(size_t)> *body;
+            std::mutex mutex;
+            std::condition_variable finished;
+            unsigned int helping = 0;
+        };
+        std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+        loop->count = count;
+        loop->body = &body;
+        // a helper registers before taking an index, so the caller sees every helper still in body
+        auto work = [](Loop &loop) {
+            for (size_t i; (i = loop.next++) < loop.count;)
+                (*loop.body)(i);
+        };
+        size_t helpers = std::min<size_t>(workers.size(), count > 0 ? count - 1 : 0);
+        for (size_t i = 0; i < helpers; i++)
+        {
+            Submit([loop, work] {
+                {
+                    std::lock_guard<std::mutex> lock(loop->mutex);
+                    loop->helping++;
+                }
+                work(*loop);
+                {
+                    std::lock_guard<std::mutex> lock(loop->mutex);
+                    loop->helping--;
+                }
+                loop->finished.notify_all();
+            });
+        }
+        work(*loop);
+        std::unique_lock<std::mutex> lock(loop->mutex);
+        loop->finished.wait(lock, [&] { return loop->helping == 0; });
+    }
+
+    unsigned int Size() const
+    {
+        return workers.size();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskReady;
+    std::condition_variable idle;
+    unsigned int busy = 0;
+    bool stopping = false;
+
+    void run()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+                busy++;
+            }
+            task();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy--;
+            }
+            idle.notify_all();
+        }
+    }
+};
+#endif
@@ -0,0 +1,105 @@
+#ifndef UNIFORM_BUFFERS_H
+#define UNIFORM_BUFFERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_state.h>
+
+#include <cstddef>
+#include <cstring>
+
+// data every program of a frame shares lives in std140 uniform blocks, each with one buffer bound to a fixed binding
+// point. Shader connects the blocks of a program to their binding point by name when it links, so a frame uploads
+// each block once no matter how many programs read it. the structs below mirror resources/shaders/common/*.glsl
+// member for member.
+
+const unsigned int MAX_POINT_LIGHTS = 8;
+
+// block FrameData, common/frame_data.glsl
+struct FrameUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec3 viewPosition;
+    float time;
+};
+static_assert(sizeof(FrameUniforms) == 208, "FrameData std140 layout");
+
+// struct PointLight, common/point_light.glsl: each vec3 is padded to 16 bytes by the float after it
+struct PointLightUniforms
+{
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    float padding;
+};
+static_assert(sizeof(PointLightUniforms) == 64, "PointLight std140 layout");
+
+// block LightData, common/lights.glsl. a program lights with the first NUM_LIGHTS of them.
+struct LightUniforms
+{
+    PointLightUniforms pointLights[MAX_POINT_LIGHTS];
+};
+
+struct UniformBlock
+{
+    const char *name;
+    unsigned int binding;
+    size_t size;
+};
+
+const UniformBlock UNIFORM_BLOCKS[] = {
+    {"FrameData", 0, sizeof(FrameUniforms)},
+    {"LightData", 1, sizeof(LightUniforms)},
+};
+
+// the block of that name, null if there is no shared block of that name
+inline const UniformBlock *FindUniformBlock(const char *name)
+{
+    for (const UniformBlock &block : UNIFORM_BLOCKS)
+        if (strcmp(block.name, name) == 0)
+            return &block;
+    return nullptr;
+}
+
+// the buffer behind one block, bound to the block's binding point for as long as it lives
+template <typename T>
+class UniformBuffer
+{
+public:
+    explicit UniformBuffer(const char *blockName)
+    {
+        const UniformBlock *block = FindUniformBlock(blockName);
+        glGenBuffers(1, &buffer);
+        GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+        if (block)
+            glBindBufferBase(GL_UNIFORM_BUFFER, block->binding, buffer);
+    }
+
+    ~UniformBuffer()
+    {
+        GLState::Get().DeleteBuffer(buffer);
+    }
+
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+    // replaces the whole block in one write. the old storage is orphaned, so a draw still reading last frame's
+    // data never makes this wait.
+    void Update(const T &data)
+    {
+        GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), &data, GL_DYNAMIC_DRAW);
+    }
+
+private:
+    unsigned int buffer = 0;
+};
+#endif
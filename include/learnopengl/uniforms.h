@@ -0,0 +1,179 @@
+#ifndef UNIFORMS_H
+#define UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <type_traits>
+
+// uniforms are looked up by a 64-bit FNV-1a hash of their name instead of the name itself. UNIFORM("name") hashes
+// at compile time, so a call like shader.set(UNIFORM("model"), model) carries nothing but an integer at run time.
+
+constexpr uint64_t UniformHash(const char *name, uint64_t hash = 14695981039346656037ull)
+{
+    while (*name)
+        hash = (hash ^ static_cast<unsigned char>(*name++)) * 1099511628211ull;
+    return hash;
+}
+
+struct UniformName
+{
+    uint64_t hash;
+};
+
+// the integral_constant forces the hash to be computed by the compiler, even in an unoptimized build
+#define UNIFORM(name) (UniformName{std::integral_constant<uint64_t, UniformHash(name)>::value})
+
+// a uniform of one program, resolved once with Shader::uniform<T>(); invalid (and ignored by Shader::set) if the
+// program has no active uniform of that name and type
+template <typename T>
+struct UniformHandle
+{
+    int slot = -1;
+
+    bool Valid() const
+    {
+        return slot >= 0;
+    }
+};
+
+// the GLSL types a C++ type can be uploaded to, and how
+template <typename T>
+struct UniformTraits;
+
+template <>
+struct UniformTraits<int>
+{
+    static bool Matches(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_1D:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_MULTISAMPLE:
+        case GL_SAMPLER_BUFFER:
+        case GL_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+            return true;
+        default:
+            return false;
+        }
+    }
+    static void Upload(GLint location, const int &value)
+    {
+        glUniform1i(location, value);
+    }
+};
+
+template <>
+struct UniformTraits<float>
+{
+    static bool Matches(GLenum type)
+    {
+        return type == GL_FLOAT;
+    }
+    static void Upload(GLint location, const float &value)
+    {
+        glUniform1f(location, value);
+    }
+};
+
+template <>
+struct UniformTraits<glm::vec2>
+{
+    static bool Matches(GLenum type)
+    {
+        return type == GL_FLOAT_VEC2;
+    }
+    static void Upload(GLint location, const glm::vec2 &value)
+    {
+        glUniform2fv(location, 1, &value[0]);
+    }
+};
+
+template <>
+struct UniformTraits<glm::vec3>
+{
+    static bool Matches(GLenum type)
+    {
+        return type == GL_FLOAT_VEC3;
+    }
+    static void Upload(GLint location, const glm::vec3 &value)
+    {
+        glUniform3fv(location, 1, &value[0]);
+    }
+};
+
+template <>
+struct UniformTraits<glm::vec4>
+{
+    static bool Matches(GLenum type)
+    {
+        return type == GL_FLOAT_VEC4;
+    }
+    static void Upload(GLint location, const glm::vec4 &value)
+    {
+        glUniform4fv(location, 1, &value[0]);
+    }
+};
+
+template <>
+struct UniformTraits<glm::mat2>
+{
+    static bool Matches(GLenum type)
+    {
+        return type == GL_FLOAT_MAT2;
+    }
+    static void Upload(GLint location, const glm::mat2 &value)
+    {
+        glUniformMatrix2fv(location, 1, GL_FALSE, &value[0][0]);
+    }
+};
+
+template <>
+struct UniformTraits<glm::mat3>
+{
+    static bool Matches(GLenum type)
+    {
+        return type == GL_FLOAT_MAT3;
+    }
+    static void Upload(GLint location, const glm::mat3 &value)
+    {
+        glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]);
+    }
+};
+
+template <>
+struct UniformTraits<glm::mat4>
+{
+    static bool Matches(GLenum type)
+    {
+        return type == GL_FLOAT_MAT4;
+    }
+    static void Upload(GLint location, const glm::mat4 &value)
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+    }
+};
+
+// uniform uploads of all programs since the last reset: issued went to the driver, skipped already had the value
+struct UniformStats
+{
+    unsigned long issued = 0;
+    unsigned long skipped = 0;
+
+    static UniformStats &Global()
+    {
+        static UniformStats stats;
+        return stats;
+    }
+};
+#endif
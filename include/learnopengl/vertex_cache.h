@@ -0,0 +1,135 @@
+#ifndef VERTEX_CACHE_H
+#define VERTEX_CACHE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// triangle order for the post-transform vertex cache (Forsyth, "Linear-Speed Vertex Cache Optimisation"), for whole
+// meshes at import (mesh_optimizer.h) and for the triangles of each meshlet (meshlets.h).
+
+namespace detail
+{
+    const int VERTEX_CACHE_SIZE = 32;
+
+    inline float forsythVertexScore(int cachePosition, unsigned int liveTriangles)
+    {
+        if (liveTriangles == 0)
+            return -1.0f;
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            // the last triangle's vertices get a fixed score so the next triangle doesn't just reuse its edge
+            if (cachePosition < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - (float)(cachePosition - 3) / (VERTEX_CACHE_SIZE - 3), 1.5f);
+        }
+        // boost vertices with few triangles left, finishing them frees the cache
+        return score + 2.0f * std::pow((float)liveTriangles, -0.5f);
+    }
+}
+
+// reorders triangles for the post-transform vertex cache (Forsyth's greedy scoring over an LRU cache of 32).
+inline void OptimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return;
+
+    // triangles adjacent to each vertex; the first live[v] entries of a vertex's range are not emitted yet
+    std::vector<unsigned int> live(vertexCount, 0);
+    for (unsigned int index : indices)
+        live[index]++;
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + live[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    {
+        std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++)
+            for (int k = 0; k < 3; k++)
+                adjacency[cursor[indices[t * 3 + k]]++] = t;
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = detail::forsythVertexScore(-1, live[v]);
+    std::vector<float> triangleScore(triangleCount);
+    int best = 0;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (triangleScore[t] > triangleScore[best])
+            best = t;
+    }
+
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    std::vector<unsigned int> cache, nextCache;
+    size_t scan = 0;
+
+    while (best >= 0)
+    {
+        const unsigned int *triangle = &indices[best * 3];
+        emitted[best] = 1;
+        result.insert(result.end(), triangle, triangle + 3);
+
+        // retire the triangle from its vertices' live lists
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = triangle[k];
+            unsigned int *begin = &adjacency[offsets[v]];
+            unsigned int *end = begin + live[v];
+            unsigned int *found = std::find(begin, end, (unsigned int)best);
+            std::swap(*found, *(end - 1));
+            live[v]--;
+        }
+
+        // the emitted vertices move to the front, everything else shifts back and may fall out
+        nextCache.assign(triangle, triangle + 3);
+        for (unsigned int v : cache)
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache.push_back(v);
+        for (size_t i = 0; i < nextCache.size(); i++)
+        {
+            unsigned int v = nextCache[i];
+            cachePosition[v] = i < (size_t)detail::VERTEX_CACHE_SIZE ? (int)i : -1;
+            vertexScore[v] = detail::forsythVertexScore(cachePosition[v], live[v]);
+        }
+
+        // rescore the live triangles around every touched vertex and continue with the best of them
+        best = -1;
+        float bestScore = -1.0f;
+        for (unsigned int v : nextCache)
+        {
+            for (unsigned int i = 0; i < live[v]; i++)
+            {
+                unsigned int t = adjacency[offsets[v] + i];
+                triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+        if (nextCache.size() > (size_t)detail::VERTEX_CACHE_SIZE)
+            nextCache.resize(detail::VERTEX_CACHE_SIZE);
+        cache.swap(nextCache);
+
+        // nothing adjacent left: restart with the next triangle in input order
+        if (best < 0)
+        {
+            while (scan < triangleCount && emitted[scan])
+                scan++;
+            if (scan < triangleCount)
+                best = scan;
+        }
+    }
+    indices.swap(result);
+}
+#endif
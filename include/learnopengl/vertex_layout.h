@@ -0,0 +1,118 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// compile-time vertex layouts: a vertex struct describes its attributes once as a list of (member, location)
+// pairs and the GL attribute pointers follow from the member types, so nothing is spelled out by hand.
+//
+//   typedef VertexLayout<VertexAttribute<MyVertex, glm::vec3, &MyVertex::Position, 0>,
+//                        VertexAttribute<MyVertex, glm::vec2, &MyVertex::TexCoords, 2>> MyLayout;
+//   MyLayout::Enable(); // with the VAO and the vertex buffer bound
+
+// IEEE 754 binary16, uploaded as GL_HALF_FLOAT
+struct half {
+    uint16_t bits;
+};
+
+// float to half with round to nearest even, overflow goes to infinity and tiny values to (signed) zero
+inline half FloatToHalf(float value)
+{
+    uint32_t f;
+    memcpy(&f, &value, sizeof(f));
+    uint32_t sign = (f >> 16) & 0x8000u;
+    uint32_t magnitude = f & 0x7fffffffu;
+    half h;
+    if (magnitude >= 0x7f800000u) // inf or nan
+        h.bits = sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0u);
+    else if (magnitude >= 0x477ff000u) // rounds past the largest half
+        h.bits = sign | 0x7c00u;
+    else if (magnitude < 0x38800000u) // subnormal half, or zero
+    {
+        float scaled = std::fabs(value) * 16777216.0f; // 2^24, one unit per smallest subnormal
+        h.bits = sign | (uint16_t)std::nearbyint(scaled);
+    }
+    else
+    {
+        uint32_t rounded = magnitude + 0xfffu + ((magnitude >> 13) & 1u);
+        h.bits = sign | ((rounded - 0x38000000u) >> 13);
+    }
+    return h;
+}
+
+// octahedral encoding of a unit vector into two snorm16 components (Cigolle et al., "A Survey of Efficient
+// Representations for Independent Unit Vectors"). a zero vector encodes as +z.
+inline void OctEncode(glm::vec3 n, int16_t out[2])
+{
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    float x = l1 > 0.0f ? n.x / l1 : 0.0f;
+    float y = l1 > 0.0f ? n.y / l1 : 0.0f;
+    if (n.z < 0.0f)
+    {
+        // fold the lower hemisphere over the diagonals
+        float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    out[0] = (int16_t)std::lround(glm::clamp(x, -1.0f, 1.0f) * 32767.0f);
+    out[1] = (int16_t)std::lround(glm::clamp(y, -1.0f, 1.0f) * 32767.0f);
+}
+
+// GL component type of a C++ scalar
+template <typename T> struct AttributeComponent;
+template <> struct AttributeComponent<float>    { static const GLenum type = GL_FLOAT; };
+template <> struct AttributeComponent<half>     { static const GLenum type = GL_HALF_FLOAT; };
+template <> struct AttributeComponent<int8_t>   { static const GLenum type = GL_BYTE; };
+template <> struct AttributeComponent<uint8_t>  { static const GLenum type = GL_UNSIGNED_BYTE; };
+template <> struct AttributeComponent<int16_t>  { static const GLenum type = GL_SHORT; };
+template <> struct AttributeComponent<uint16_t> { static const GLenum type = GL_UNSIGNED_SHORT; };
+
+// component count and type of a member: glm vectors or plain arrays of scalars
+template <typename T> struct AttributeFormat;
+template <> struct AttributeFormat<glm::vec2> { static const GLint size = 2; static const GLenum type = GL_FLOAT; };
+template <> struct AttributeFormat<glm::vec3> { static const GLint size = 3; static const GLenum type = GL_FLOAT; };
+template <> struct AttributeFormat<glm::vec4> { static const GLint size = 4; static const GLenum type = GL_FLOAT; };
+template <typename T, size_t N> struct AttributeFormat<T[N]>
+{
+    static const GLint size = N;
+    static const GLenum type = AttributeComponent<T>::type;
+};
+
+// one attribute of vertex type V stored in member Member, read at the given shader location.
+// integer members are read as floats, normalized to [0, 1] / [-1, 1] if Normalized is set.
+template <typename V, typename T, T V::*Member, GLuint Location, bool Normalized = false>
+struct VertexAttribute
+{
+    static void Enable()
+    {
+        // the member's byte offset, taken from a value-initialized vertex instead of offsetof
+        static const V probe = V();
+        size_t offset = reinterpret_cast<const char *>(&(probe.*Member)) - reinterpret_cast<const char *>(&probe);
+        glEnableVertexAttribArray(Location);
+        glVertexAttribPointer(Location, AttributeFormat<T>::size, AttributeFormat<T>::type, Normalized ? GL_TRUE : GL_FALSE,
+                              sizeof(V), (void*)offset);
+    }
+};
+
+template <typename... Attributes>
+struct VertexLayout
+{
+    static const size_t attributeCount = sizeof...(Attributes);
+
+    // sets up every attribute pointer of the bound VAO for the bound GL_ARRAY_BUFFER
+    static void Enable()
+    {
+        int expand[] = {0, (Attributes::Enable(), 0)...};
+        (void)expand;
+    }
+};
+
+// vertex types specialize this with a Layout typedef
+template <typename V> struct VertexFormat;
+#endif
@@ -0,0 +1,13 @@
+float near = 0.0010f;
+float far = 10000.0f;
+
+float linearizeDepth(float depth) {
+    return (2.0 * far * near) / (far + near - (depth * 2.0 - 1.0) * (far - near));
+}
+
+// 0 close to the camera, rising to 1 around offset
+float logDepth(float depth, float steepness, float offset) {
+
+    float zVal = linearizeDepth(depth);
+    return (1 / (1 + exp(-steepness * (zVal - offset))));
+}
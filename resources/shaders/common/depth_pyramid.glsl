@@ -0,0 +1,42 @@
+// occlusion test against the depth pyramid of an earlier frame, uniforms set by DepthPyramid::Bind
+// (include/learnopengl/depth_pyramid.h)
+uniform sampler2D depthPyramid;
+uniform int pyramidLevels;              // 0 while there is no pyramid: nothing is hidden
+uniform vec2 pyramidScreenSize;
+uniform mat4 pyramidViewProjection;
+
+// true if the box (world space) lies entirely behind what the pyramid's frame drew. a box reaching in front of that
+// frame's near plane is never hidden.
+bool boxHidden(vec3 boxMin, vec3 boxMax)
+{
+    if (pyramidLevels == 0)
+        return false;
+    vec2 screenMin = vec2(1.0), screenMax = vec2(-1.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = mix(boxMin, boxMax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        vec4 clip = pyramidViewProjection * vec4(corner, 1.0);
+        if (clip.z < -clip.w)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        screenMin = min(screenMin, ndc.xy);
+        screenMax = max(screenMax, ndc.xy);
+        nearest = min(nearest, ndc.z);
+    }
+    // the pixels of the rectangle that were on the screen
+    ivec2 pixelMin = ivec2(clamp((screenMin * 0.5 + 0.5) * pyramidScreenSize, vec2(0.0), pyramidScreenSize - 1.0));
+    ivec2 pixelMax = ivec2(clamp((screenMax * 0.5 + 0.5) * pyramidScreenSize, vec2(0.0), pyramidScreenSize - 1.0));
+    // a texel of level i is 2^(i + 1) pixels wide, so at the level where that is at least the extent of the
+    // rectangle it touches two texels per axis at most
+    int extent = max(max(pixelMax.x - pixelMin.x, pixelMax.y - pixelMin.y), 1);
+    int level = clamp(int(ceil(log2(float(extent)))) - 1, 0, pyramidLevels - 1);
+    ivec2 size = textureSize(depthPyramid, level);
+    ivec2 texelMin = min(pixelMin >> (level + 1), size - 1);
+    ivec2 texelMax = min(pixelMax >> (level + 1), size - 1);
+    float farthest = max(max(texelFetch(depthPyramid, texelMin, level).r,
+                             texelFetch(depthPyramid, ivec2(texelMax.x, texelMin.y), level).r),
+                         max(texelFetch(depthPyramid, ivec2(texelMin.x, texelMax.y), level).r,
+                             texelFetch(depthPyramid, texelMax, level).r));
+    return nearest * 0.5 + 0.5 > farthest;
+}
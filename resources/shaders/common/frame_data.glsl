@@ -0,0 +1,9 @@
+// shared by every program, one buffer per frame (FrameUniforms in include/learnopengl/uniform_buffers.h)
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPosition;
+    float time;
+};
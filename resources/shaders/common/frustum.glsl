@@ -0,0 +1,13 @@
+// frustum test of a bounding sphere against the planes of viewProjection, as in include/learnopengl/frustum.h.
+// include after common/frame_data.glsl.
+bool sphereInFrustum(vec3 center, float radius)
+{
+    mat4 rows = transpose(viewProjection);
+    for (int i = 0; i < 6; i++)
+    {
+        vec4 plane = rows[3] + ((i & 1) == 0 ? rows[i >> 1] : -rows[i >> 1]);
+        if (dot(plane.xyz, center) + plane.w < -radius * length(plane.xyz))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+// the scene of the multi-draw-indirect tier, as IndirectRenderer uploads it (include/learnopengl/indirect_renderer.h)
+
+// a mesh of an object: its model space bounding sphere, the index range to draw, and where its command goes
+struct DrawRecord
+{
+    vec4 sphere;        // center, radius
+    uint count;
+    uint firstIndex;
+    int baseVertex;
+    uint object;
+    uint material;
+    uint group;         // the glMultiDrawElementsIndirect the mesh is part of
+    uint groupFirst;    // the group's first command
+    uint padding;
+};
+
+struct ObjectData
+{
+    mat4 model;
+    vec4 fogColorOpacity;
+};
+
+// MTL constants: Kd and Ns, Ks and d, Ke
+struct MaterialData
+{
+    vec4 diffuseShininess;
+    vec4 specularOpacity;
+    vec4 emissive;
+};
+
+layout (std430, binding = 0) readonly buffer DrawRecords
+{
+    DrawRecord draws[];
+};
+
+layout (std430, binding = 1) readonly buffer Objects
+{
+    ObjectData objects[];
+};
+
+layout (std430, binding = 2) readonly buffer Materials
+{
+    MaterialData materials[];
+};
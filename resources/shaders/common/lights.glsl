@@ -0,0 +1,9 @@
+// the scene's point lights, one buffer per frame (LightUniforms in include/learnopengl/uniform_buffers.h)
+#include "point_light.glsl"
+
+#define MAX_POINT_LIGHTS 8
+
+layout (std140) uniform LightData
+{
+    PointLight pointLights[MAX_POINT_LIGHTS];
+};
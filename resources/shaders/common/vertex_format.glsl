@@ -0,0 +1,36 @@
+// vertex inputs of the model meshes in either GPU vertex format (include/learnopengl/mesh.h)
+#ifdef COMPACT_VERTICES
+// CompactVertex: 16-bit positions relative to the mesh bounds,
+// octahedral normal and tangent, half-float texture coordinates
+layout (location = 0) in vec4 aQuantizedPos;
+layout (location = 1) in vec4 aOctNormalTangent;
+layout (location = 2) in vec2 aTexCoords;
+
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * mix(vec2(-1.0), vec2(1.0), step(0.0, n.xy));
+    return normalize(n);
+}
+
+vec3 vertexPosition() { return aQuantizedPos.xyz * positionScale + positionOffset; }
+vec3 vertexNormal() { return octDecode(aOctNormalTangent.xy); }
+vec3 vertexTangent() { return octDecode(aOctNormalTangent.zw); }
+// only the side of the normal/tangent plane the bitangent is on is stored
+vec3 vertexBitangent() { return cross(vertexNormal(), vertexTangent()) * (aQuantizedPos.w * 2.0 - 1.0); }
+#else
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec3 aTangent;
+layout (location = 4) in vec3 aBitangent;
+
+vec3 vertexPosition() { return aPos; }
+vec3 vertexNormal() { return aNormal; }
+vec3 vertexTangent() { return aTangent; }
+vec3 vertexBitangent() { return aBitangent; }
+#endif
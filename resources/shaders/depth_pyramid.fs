@@ -0,0 +1,20 @@
+#version 330 core
+// one level of the depth pyramid (include/learnopengl/depth_pyramid.h): the farthest depth of the texels of the level
+// below that this texel covers. the level below is the only one of the texture the base and max level leave visible.
+out float farthest;
+
+uniform sampler2D source;
+
+void main()
+{
+    ivec2 sourceSize = textureSize(source, 0);
+    ivec2 size = max(sourceSize / 2, ivec2(1));
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    ivec2 first = texel * 2;
+    // the last texel of an odd sized row or column takes the one left over
+    ivec2 last = min(first + 1 + ivec2(equal(texel, size - 1)) * (sourceSize & 1), sourceSize - 1);
+    farthest = 0.0;
+    for (int y = first.y; y <= last.y; y++)
+        for (int x = first.x; x <= last.x; x++)
+            farthest = max(farthest, texelFetch(source, ivec2(x, y), 0).r);
+}
@@ -0,0 +1,6 @@
+#version 330 core
+// never runs, instance culling draws with GL_RASTERIZER_DISCARD. Shader links every program with a fragment stage.
+
+void main()
+{
+}
@@ -0,0 +1,19 @@
+#version 330 core
+// emits the instances instance_cull.vs found visible, so transform feedback packs their transforms one after the
+// other and counts them
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in mat4 vertexModel[];
+in float vertexVisible[];
+
+out mat4 visibleModel;
+
+void main()
+{
+    if (vertexVisible[0] == 0.0)
+        return;
+    visibleModel = vertexModel[0];
+    EmitVertex();
+    EndPrimitive();
+}
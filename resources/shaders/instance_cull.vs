@@ -0,0 +1,22 @@
+#version 330 core
+// GPU instance culling (include/learnopengl/instance_culling.h): a point per instance, its bounding sphere tested
+// against the frustum of this frame and the depth pyramid of the last one. instance_cull.gs passes the transforms
+// of the visible instances on to transform feedback.
+#include "common/frame_data.glsl"
+#include "common/frustum.glsl"
+#include "common/depth_pyramid.glsl"
+
+layout (location = 0) in mat4 instanceModel;
+layout (location = 4) in vec4 instanceSphere;     // world space center, radius
+
+out mat4 vertexModel;
+out float vertexVisible;
+
+void main()
+{
+    vec3 center = instanceSphere.xyz;
+    float radius = instanceSphere.w;
+    bool visible = sphereInFrustum(center, radius) && !boxHidden(center - radius, center + radius);
+    vertexModel = instanceModel;
+    vertexVisible = visible ? 1.0 : 0.0;
+}
@@ -0,0 +1,103 @@
+#version 330 core
+// lit model surfaces, specialized per material by the permutation defines
+// (include/learnopengl/shader_permutations.h):
+// ALPHA_TEST discards transparent texels, FOG fades to fogColor with depth,
+// NORMAL_MAP perturbs the normal with texture_normal1, NUM_LIGHTS point lights;
+// INDIRECT takes the constants per draw from lit_indirect.vs instead of the uniforms
+#ifndef NUM_LIGHTS
+#define NUM_LIGHTS 1
+#endif
+out vec4 FragColor;
+
+struct Material {
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+#ifdef NORMAL_MAP
+    sampler2D texture_normal1;
+#endif
+
+    // MTL constants: Kd (white for materials with a diffuse map), Ks, Ke, Ns and d
+    vec3 diffuse;
+    vec3 specular;
+    vec3 emissive;
+    float shininess;
+    float opacity;
+};
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+#ifdef NORMAL_MAP
+in vec3 Tangent;
+in vec3 Bitangent;
+#endif
+
+#include "common/frame_data.glsl"
+#include "common/lights.glsl"
+
+#if NUM_LIGHTS > MAX_POINT_LIGHTS
+#error NUM_LIGHTS exceeds MAX_POINT_LIGHTS
+#endif
+
+uniform Material material;
+
+uniform float opacity = 1.0;
+
+#ifdef FOG
+#include "common/depth_fog.glsl"
+
+uniform vec3 fogColor = vec3(0.0085, 0.0085, 0.0090);
+#endif
+
+#ifdef INDIRECT
+flat in vec3 drawDiffuse;
+flat in vec3 drawSpecular;
+flat in vec3 drawEmissive;
+flat in float drawShininess;
+flat in float drawOpacity;
+flat in vec3 drawFogColor;
+
+#define MATERIAL_DIFFUSE drawDiffuse
+#define MATERIAL_SPECULAR drawSpecular
+#define MATERIAL_EMISSIVE drawEmissive
+#define MATERIAL_SHININESS drawShininess
+#define DRAW_OPACITY drawOpacity
+#define FOG_COLOR drawFogColor
+#else
+#define MATERIAL_DIFFUSE material.diffuse
+#define MATERIAL_SPECULAR material.specular
+#define MATERIAL_EMISSIVE material.emissive
+#define MATERIAL_SHININESS material.shininess
+#define DRAW_OPACITY (opacity * material.opacity)
+#define FOG_COLOR fogColor
+#endif
+
+void main()
+{
+    vec4 diffuseColor = texture(material.texture_diffuse1, TexCoords) * vec4(MATERIAL_DIFFUSE, 1.0);
+#ifdef ALPHA_TEST
+    if (diffuseColor.a < 0.01)
+        discard;
+#endif
+#ifdef NORMAL_MAP
+    // z is rebuilt, BC5 normal maps only store x and y
+    vec2 mapped = texture(material.texture_normal1, TexCoords).xy * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(mapped, sqrt(max(1.0 - dot(mapped, mapped), 0.0)));
+    vec3 normal = normalize(mat3(normalize(Tangent), normalize(Bitangent), normalize(Normal)) * tangentNormal);
+#else
+    vec3 normal = normalize(Normal);
+#endif
+    vec3 viewDir = normalize(viewPosition - FragPos);
+    vec3 specularColor = texture(material.texture_specular1, TexCoords).x * MATERIAL_SPECULAR;
+
+    vec3 result = MATERIAL_EMISSIVE;
+    for (int i = 0; i < NUM_LIGHTS; i++)
+        result += CalcPointLight(pointLights[i], normal, FragPos, viewDir, diffuseColor.rgb, specularColor, MATERIAL_SHININESS);
+    float alpha = DRAW_OPACITY;
+
+#ifdef FOG
+    float depth = logDepth(gl_FragCoord.z, 0.1f, 25.5f);
+    FragColor = vec4(result, alpha) * (1.0 - depth) + depth * vec4(FOG_COLOR, 1.0);
+#else
+    FragColor = vec4(result, alpha);
+#endif
+}
@@ -0,0 +1,30 @@
+#version 330 core
+#include "common/vertex_format.glsl"
+#include "common/frame_data.glsl"
+
+out vec2 TexCoords;
+out vec3 Normal;
+out vec3 FragPos;
+#ifdef NORMAL_MAP
+out vec3 Tangent;
+out vec3 Bitangent;
+#endif
+
+#ifdef INSTANCED
+// the transform of each instance, from the buffer instance culling wrote (include/learnopengl/instance_culling.h)
+layout (location = 5) in mat4 model;
+#else
+uniform mat4 model;
+#endif
+
+void main()
+{
+    FragPos = vec3(model * vec4(vertexPosition(), 1.0));
+    Normal = vertexNormal();
+#ifdef NORMAL_MAP
+    Tangent = vertexTangent();
+    Bitangent = vertexBitangent();
+#endif
+    TexCoords = aTexCoords;
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,48 @@
+#version 430 core
+// lit.vs for the multi-draw-indirect tier (include/learnopengl/indirect_renderer.h), compiled with INDIRECT. the
+// transform and material constants of each draw come from the storage buffers of the scene, found through the
+// draw's record: indirect_cull.comp makes it the base instance of the command, and an attribute advanced once per
+// instance over the numbers 0, 1, 2, ... reads it back (gl_DrawID counts the commands, not the records, and is
+// GL 4.6 anyway).
+#include "common/vertex_format.glsl"
+#include "common/frame_data.glsl"
+#include "common/indirect_draws.glsl"
+
+layout (location = 9) in uint drawRecord;
+
+out vec2 TexCoords;
+out vec3 Normal;
+out vec3 FragPos;
+#ifdef NORMAL_MAP
+out vec3 Tangent;
+out vec3 Bitangent;
+#endif
+
+// the uniforms of lit.fs for this draw
+flat out vec3 drawDiffuse;
+flat out vec3 drawSpecular;
+flat out vec3 drawEmissive;
+flat out float drawShininess;
+flat out float drawOpacity;     // the material's times the object's
+flat out vec3 drawFogColor;
+
+void main()
+{
+    DrawRecord draw = draws[drawRecord];
+    ObjectData object = objects[draw.object];
+    MaterialData material = materials[draw.material];
+    FragPos = vec3(object.model * vec4(vertexPosition(), 1.0));
+    Normal = vertexNormal();
+#ifdef NORMAL_MAP
+    Tangent = vertexTangent();
+    Bitangent = vertexBitangent();
+#endif
+    TexCoords = aTexCoords;
+    drawDiffuse = material.diffuseShininess.rgb;
+    drawShininess = material.diffuseShininess.a;
+    drawSpecular = material.specularOpacity.rgb;
+    drawOpacity = material.specularOpacity.a * object.fogColorOpacity.a;
+    drawEmissive = material.emissive.rgb;
+    drawFogColor = object.fogColorOpacity.rgb;
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+}
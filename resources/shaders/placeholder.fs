@@ -0,0 +1,11 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 Normal;
+
+void main()
+{
+    // flat shading from a fixed direction, just enough to read the shape of the proxy
+    float shade = 0.35 + 0.65 * max(dot(normalize(Normal), normalize(vec3(0.4, 1.0, 0.3))), 0.0);
+    FragColor = vec4(vec3(0.22, 0.26, 0.32) * shade, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+out vec3 Normal;
+
+#include "common/frame_data.glsl"
+
+uniform mat4 model;
+
+// bounds of the mesh that is still loading, the unit cube is stretched over them
+uniform vec3 boundsMin;
+uniform vec3 boundsMax;
+
+void main()
+{
+    Normal = mat3(model) * aNormal;
+    gl_Position = viewProjection * model * vec4(mix(boundsMin, boundsMax, aPos), 1.0);
+}
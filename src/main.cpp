@@ -1,14 +1,30 @@
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
+#include <learnopengl/bvh.h>
 #include <learnopengl/camera.h>
+#include <learnopengl/depth_pyramid.h>
 #include <learnopengl/filesystem.h>
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/indirect_renderer.h>
+#include <learnopengl/instance_culling.h>
 #include <learnopengl/model.h>
+#include <learnopengl/model_loader.h>
+#include <learnopengl/occlusion.h>
+#include <learnopengl/portals.h>
+#include <learnopengl/render_queue.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/shader_compiler.h>
+#include <learnopengl/shader_permutations.h>
+#include <learnopengl/software_occlusion.h>
+#include <learnopengl/uniform_buffers.h>
+#include <learnopengl/texture_registry.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <random>
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -50,6 +66,10 @@ struct PointLight {
 	float quadratic;
 };
 
+// how meshes hidden behind others are found: GPU queries read back a frame
+// late, or the station's walls rasterized on the CPU before submission
+enum OcclusionMode { OCCLUSION_OFF, OCCLUSION_QUERIES, OCCLUSION_SOFTWARE };
+
 struct ProgramState {
 	glm::vec3 clearColor = glm::vec3(0);
 	bool ImGuiEnabled = false;
@@ -58,6 +78,11 @@ struct ProgramState {
 	glm::vec3 backpackPosition = glm::vec3(0.0f);
 	float backpackScale = 1000.0f;
 	PointLight pointLight;
+	int OcclusionMode = OCCLUSION_QUERIES;
+	bool PortalCulling = true;
+	bool MeshletCulling = true;
+	bool InstanceOcclusion = true;
+	bool IndirectDraws = false;
 	ProgramState() : camera(glm::vec3(0.0f, 0.0f, 3.0f)) {}
 
 	void SaveToFile(std::string filename);
@@ -93,7 +118,76 @@ void ProgramState::LoadFromFile(std::string filename)
 
 ProgramState *programState;
 
-void DrawImGui(ProgramState *programState);
+void DrawImGui(ProgramState *programState, const RenderQueue &renderQueue,
+	       const OcclusionCuller &occlusionCuller,
+	       const SoftwareOcclusion &softwareOcclusion,
+	       const PortalVisibility &stationCells,
+	       const InstanceCuller &convoyCuller,
+	       const IndirectRenderer &indirectScene);
+
+// hierarchy over the meshes of every model, and how many of them the
+// point light reaches
+SceneBVH sceneBVH;
+size_t meshesNearLight = 0;
+// the freighters parked around the station
+const unsigned int CONVOY_SIZE = 1024;
+const float CONVOY_SCALE = 2.0f;
+// the CPU time the frame's opaque submission took
+double submitMilliseconds = 0.0;
+
+// distance at which the light's diffuse term falls below 1/256
+static float pointLightRange(const PointLight &light)
+{
+	float brightest = std::max(light.diffuse.r,
+				   std::max(light.diffuse.g, light.diffuse.b));
+	// brightest / (constant + linear * d + quadratic * d^2) = 1/256
+	float c = light.constant - 256.0f * brightest;
+	if (light.quadratic > 0.0f) {
+		return (-light.linear +
+			std::sqrt(light.linear * light.linear -
+				  4.0f * light.quadratic * c)) /
+		       (2.0f * light.quadratic);
+	}
+	return light.linear > 0.0f ? -c / light.linear : 1e30f;
+}
+
+// the convoy around the station: the same random spots every run, at the
+// bounds of the freighter's meshes (model space) streamed in so far
+static std::vector<InstanceData>
+convoyInstances(const std::vector<AABB> &bounds)
+{
+	std::vector<InstanceData> instances;
+	if (bounds.empty()) {
+		return instances;
+	}
+	AABB model = bounds[0];
+	for (const AABB &mesh : bounds) {
+		model = MergeBounds(model, mesh);
+	}
+	glm::vec3 center = (model.min + model.max) * 0.5f;
+	float radius = glm::length(model.max - center) * CONVOY_SCALE;
+
+	std::mt19937 random(5601);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	for (unsigned int i = 0; i < CONVOY_SIZE; i++) {
+		float angle = glm::radians(unit(random) * 360.0f);
+		float distance = glm::mix(400.0f, 3000.0f, unit(random));
+		glm::vec3 position(cos(angle) * distance,
+				   glm::mix(-300.0f, 300.0f, unit(random)),
+				   sin(angle) * distance);
+		glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+		transform = glm::rotate(transform,
+					glm::radians(unit(random) * 360.0f),
+					glm::vec3(0.0f, 1.0f, 0.0f));
+		transform = glm::scale(transform, glm::vec3(CONVOY_SCALE));
+		InstanceData instance;
+		instance.model = transform;
+		instance.sphere = glm::vec4(
+		    glm::vec3(transform * glm::vec4(center, 1.0f)), radius);
+		instances.push_back(instance);
+	}
+	return instances;
+}
 
 GLfloat planeVertices[] = {
     -1000.0f, 0, -1000.0f, 0.0f, 0.0f, -1000.0f, 0, 1000.0f,  0.0f, 1.0f,
@@ -125,99 +219,126 @@ unsigned int skyboxIndices[] = {
     // F
     3, 7, 6, 6, 2, 3};
 
-auto main() -> int
+// the scene and its render loop, until the window is closed. every GL object
+// it creates is released when it returns, while the context still exists
+static void renderScene(GLFWwindow *window)
 {
-	// glfw: initialize and configure
-	// ------------------------------
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-#ifdef __APPLE__
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-	// glfw window creation
-	// --------------------
-	GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT,
-					      "LearnOpenGL", nullptr, nullptr);
-	if (window == nullptr) {
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-		return -1;
-	}
-	glfwMakeContextCurrent(window);
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-	glfwSetCursorPosCallback(window, mouse_callback);
-	glfwSetScrollCallback(window, scroll_callback);
-	glfwSetKeyCallback(window, key_callback);
-	// tell GLFW to capture our mouse
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-	if (!gladLoadGLLoader(
-		reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
-		std::cout << "Failed to initialize GLAD" << std::endl;
-		return -1;
-	}
-
-	stbi_set_flip_vertically_on_load(true);
-
-	programState = new ProgramState;
-	programState->LoadFromFile("resources/program_state.txt");
-	if (programState->ImGuiEnabled) {
-		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-	}
-	// Init Imgui
-	IMGUI_CHECKVERSION();
-	ImGui::CreateContext();
-	ImGuiIO &io = ImGui::GetIO();
-	(void)io;
-
-	ImGui_ImplGlfw_InitForOpenGL(window, true);
-	ImGui_ImplOpenGL3_Init("#version 330 core");
-
 	// configure global opengl state
 
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_FRONT);
+	GLState &glState = GLState::Get();
+	glState.Enable(GL_CULL_FACE);
+	glState.CullFace(MODEL_CULLED_FACE);
 	glFrontFace(GL_CCW);
 	// -----------------------------
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_STENCIL_TEST);
-	glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+	glState.Enable(GL_DEPTH_TEST);
+	glState.Enable(GL_STENCIL_TEST);
+	glState.StencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
 
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glState.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	// build and compile shaders
 	// -------------------------
-	Shader planeShader("resources/shaders/grass.vs",
-			   "resources/shaders/grass.fs");
-	Shader stationShader("resources/shaders/station.vs",
-			     "resources/shaders/station.fs");
-	Shader outlineShader("resources/shaders/outlining.vs",
-			     "resources/shaders/outlining.fs");
-	Shader skyboxShader("resources/shaders/skybox.vs",
-			    "resources/shaders/skybox.fs");
-	Shader treeShader("resources/shaders/trees.vs",
-			  "resources/shaders/trees.fs");
+	// all programs are submitted at once and finished from the render
+	// loop as the driver completes them, while the models stream in.
+	// shaders that draw model meshes decode the GPU vertex format
+	ShaderCompiler shaderCompiler;
+	// blocks every program reads, see common/frame_data.glsl and
+	// common/lights.glsl
+	UniformBuffer<FrameUniforms> frameUniforms("FrameData");
+	UniformBuffer<LightUniforms> lightUniforms("LightData");
+	// the scene's draws, sorted by pass, program, material and depth
+	RenderQueue renderQueue;
+	Shader outlineShader, skyboxShader, placeholderShader;
+	// one lit program per feature set the models draw with; materials
+	// with a normal map get the NORMAL_MAP variant of their set
+	ShaderPermutations litShaders("resources/shaders/lit.vs",
+				      "resources/shaders/lit.fs",
+				      VERTEX_FORMAT_DEFINES);
+	litShaders.Require(SHADER_FOG);
+	litShaders.Require(SHADER_FOG | SHADER_NORMAL_MAP);
+	litShaders.Require(SHADER_ALPHA_TEST | SHADER_FOG);
+	litShaders.Require(SHADER_ALPHA_TEST | SHADER_FOG | SHADER_NORMAL_MAP);
+	litShaders.Require(SHADER_FOG | SHADER_INSTANCED);
+	litShaders.Require(SHADER_FOG | SHADER_INSTANCED | SHADER_NORMAL_MAP);
+	litShaders.Submit(shaderCompiler);
+	// the freighters parked around the station, culled on the GPU against
+	// the frustum and the previous frame's depth
+	DepthPyramid depthPyramid;
+	InstanceCuller convoyCuller;
+	depthPyramid.Submit(shaderCompiler);
+	convoyCuller.Submit(shaderCompiler);
+	// the opaque models (scene objects 0 to 2) with a multi-draw per group
+	// on GL 4.3 drivers, and their surfaces, which GL 3.3 cannot compile
+	IndirectRenderer indirectScene;
+	ShaderPermutations litIndirectShaders(
+	    "resources/shaders/lit_indirect.vs", "resources/shaders/lit.fs",
+	    std::string(VERTEX_FORMAT_DEFINES) + "#define INDIRECT\n");
+	if (IndirectRenderer::Supported()) {
+		litIndirectShaders.Require(SHADER_FOG);
+		litIndirectShaders.Require(SHADER_FOG | SHADER_NORMAL_MAP);
+		litIndirectShaders.Submit(shaderCompiler);
+		indirectScene.Submit(shaderCompiler);
+	}
+	shaderCompiler.Submit(outlineShader, "resources/shaders/outlining.vs",
+			      "resources/shaders/outlining.fs", nullptr,
+			      VERTEX_FORMAT_DEFINES);
+	shaderCompiler.Submit(skyboxShader, "resources/shaders/skybox.vs",
+			      "resources/shaders/skybox.fs");
+	shaderCompiler.Submit(placeholderShader,
+			      "resources/shaders/placeholder.vs",
+			      "resources/shaders/placeholder.fs");
 	// load models
 	// -----------
-	// Model
-	// ourModel("resources/objects/space_station/Space\ Station\ Scene.obj");
-	Model ourModel("resources/objects/grass/grass.obj");
-	Model stationModel(
-	    "resources/objects/space_station/Space\ Station\ Scene.obj");
-	Model freighterModel("resources/objects/freighter/freighter.obj");
-	Model treeModel("resources/objects/trees/trees9.obj");
-
-	freighterModel.SetShaderTextureNamePrefix("material.");
-	ourModel.SetShaderTextureNamePrefix("material.");
-	stationModel.SetShaderTextureNamePrefix("material.");
-	treeModel.SetShaderTextureNamePrefix("material.");
-
-	skyboxShader.use();
-	skyboxShader.setInt("skybox", 0);
+	// models stream in while the render loop is already running: they are
+	// imported on worker threads (or mapped from the hangar_bake archive),
+	// their images decoded in the background and both uploaded a few at a
+	// time per frame. until then their bounds are drawn as placeholders
+	TextureLoader textureLoader;
+	SceneArchive sceneArchive;
+	const SceneArchive *archive = nullptr;
+	if (sceneArchive.Open("resources/hangar5601.pak")) {
+		archive = &sceneArchive;
+	}
+	ModelLoader modelLoader(textureLoader, archive);
+	ModelHandle ourModel =
+	    modelLoader.Load("resources/objects/grass/grass.obj");
+	ModelHandle stationModel = modelLoader.Load(
+	    "resources/objects/space_station/Space Station Scene.obj");
+	ModelHandle freighterModel =
+	    modelLoader.Load("resources/objects/freighter/freighter.obj");
+	ModelHandle treeModel =
+	    modelLoader.Load("resources/objects/trees/trees9.obj");
+
+	// every model in one hierarchy for culling and proximity queries,
+	// the scene object of a model is its index here. the handles above
+	// own the models, so resetting them frees them
+	Model *const sceneModels[] = {ourModel.get(), stationModel.get(),
+				      freighterModel.get(), treeModel.get()};
+	std::vector<AABB> sceneBounds[4];
+	// skip meshes hidden behind others, with the object ids of sceneBVH
+	OcclusionCuller occlusionCuller;
+	SoftwareOcclusion softwareOcclusion;
+	// the rooms of the station and the doorways between them
+	PortalVisibility stationCells;
+	for (size_t i = 0; i < 4; i++) {
+		sceneBVH.AddObject();
+		occlusionCuller.AddObject();
+		softwareOcclusion.AddObject();
+	}
+	for (size_t i = 0; i < 3; i++) {
+		indirectScene.AddObject();
+	}
+	// the hull and the room walls of the station hide most of the scene
+	stationModel->KeepOccluders(6144);
+	// without its cells the station is drawn as one room
+	if (!stationCells.Load("resources/objects/space_station/cells.txt")) {
+		programState->PortalCulling = false;
+	}
+
+	freighterModel->SetShaderTextureNamePrefix("material.");
+	ourModel->SetShaderTextureNamePrefix("material.");
+	stationModel->SetShaderTextureNamePrefix("material.");
+	treeModel->SetShaderTextureNamePrefix("material.");
 
 	PointLight &pointLight = programState->pointLight;
 	pointLight.position = glm::vec3(0.0f, 0.0, 0.0);
@@ -244,19 +365,19 @@ auto main() -> int
 	glGenVertexArrays(1, &skyboxVAO);
 	glGenBuffers(1, &skyboxVBO);
 	glGenBuffers(1, &skyboxEBO);
-	glBindVertexArray(skyboxVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+	glState.BindVertexArray(skyboxVAO);
+	glState.BindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices,
 		     GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, skyboxEBO);
+	glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, skyboxEBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(skyboxIndices),
 		     &skyboxIndices, GL_STATIC_DRAW);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
 			      (void *)nullptr);
 	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glState.BindBuffer(GL_ARRAY_BUFFER, 0);
+	glState.BindVertexArray(0);
+	glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	std::string facesCubemap[6] = {
 	    "resources/textures/right.png", "resources/textures/left.png",
@@ -266,7 +387,8 @@ auto main() -> int
 
 	unsigned int cubemapTexture;
 	glGenTextures(1, &cubemapTexture);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+	glState.ActiveTexture(0);
+	glState.BindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTexture);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S,
@@ -275,47 +397,56 @@ auto main() -> int
 			GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R,
 			GL_CLAMP_TO_EDGE);
-	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+	glState.Enable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
 	for (unsigned int i = 0; i < 6; i++) {
-		int width, height, nrChannels;
-		unsigned char *data = stbi_load(facesCubemap[i].c_str(), &width,
-						&height, &nrChannels, 0);
-		if (data) {
-			stbi_set_flip_vertically_on_load(false);
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0,
-				     GL_RGBA, width, height, 0, GL_RGBA,
-				     GL_UNSIGNED_BYTE, data);
-			stbi_image_free(data);
-		} else {
-			std::cout
-			    << "Failed to load texture: " << facesCubemap[i]
-			    << std::endl;
-			stbi_image_free(data);
-		}
+		textureLoader.Enqueue(cubemapTexture,
+				      GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+				      facesCubemap[i], false, false);
 	}
 
 	// texture loading
-	int widthImg, heightImg, numColCh;
-	unsigned char *bytes = stbi_load("resources/textures/grass.jpg",
-					 &widthImg, &heightImg, &numColCh, 0);
-
 	GLuint texture;
 	glGenTextures(1, &texture);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	glState.ActiveTexture(0);
+	glState.BindTexture(0, GL_TEXTURE_2D, texture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, widthImg, heightImg, 0, GL_RGB,
-		     GL_UNSIGNED_BYTE, bytes);
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	stbi_image_free(bytes);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	glState.BindTexture(0, GL_TEXTURE_2D, 0);
+	textureLoader.Enqueue(texture, GL_TEXTURE_2D,
+			      "resources/textures/grass.jpg", false, true);
+
+	// every program with the vertex layout and pipeline state the frame
+	// draws it with
+	unsigned int meshVAO = GeometryArena<GpuVertex>::Get().VAO();
+	litShaders.ForEach([&](Shader &shader, unsigned int features) {
+		if (features & SHADER_ALPHA_TEST)
+			shaderCompiler.AddWarmup(
+			    shader, meshVAO,
+			    [] { GLState::Get().Enable(GL_BLEND); },
+			    [] { GLState::Get().Disable(GL_BLEND); });
+		else
+			shaderCompiler.AddWarmup(shader, meshVAO);
+	});
+	shaderCompiler.AddWarmup(outlineShader, meshVAO);
+	shaderCompiler.AddWarmup(
+	    skyboxShader, skyboxVAO,
+	    [] { GLState::Get().DepthFunc(GL_LEQUAL); },
+	    [] { GLState::Get().DepthFunc(GL_LESS); });
+	shaderCompiler.AddWarmup(
+	    placeholderShader, modelLoader.PlaceholderVAO(),
+	    [] { GLState::Get().Disable(GL_CULL_FACE); },
+	    [] { GLState::Get().Enable(GL_CULL_FACE); });
+
+	bool firstFrame = true;
+	bool sceneResident = false;
+	// per model of the indirect tier, the meshes it leaves to the queue
+	std::vector<uint8_t> blendedMeshes[3];
+	std::vector<uint8_t> blendedVisibility[3];
+	bool shadersReady = false;
 
 	while (!glfwWindowShouldClose(window)) {
 		// per-frame time logic
@@ -324,6 +455,11 @@ auto main() -> int
 		deltaTime = progTime - lastFrame;
 		// lastFrame = progTime;
 		fpsCounter++;
+		// uniform uploads are counted per frame for the ImGui panel
+		UniformStats::Global() = UniformStats();
+		glState.ResetStats();
+		CullingStats::Global() = CullingStats();
+		MeshletStats::Global() = MeshletStats();
 
 		if (deltaTime >= 1.0 / 30.0) {
 			std::string fpsString = std::to_string(
@@ -336,10 +472,72 @@ auto main() -> int
 			lastFrame = progTime;
 			fpsCounter = 0;
 		}
+		// streaming: spend a few milliseconds per frame on uploads
+		if (!sceneResident) {
+			modelLoader.Update(0.004);
+			if (modelLoader.Idle()) {
+				sceneResident = true;
+				sceneArchive.Close();
+				std::cout
+				    << "Scene resident after " << glfwGetTime()
+				    << "s, texture decoding took "
+				    << textureLoader.DecodeSeconds() << "s on "
+				    << textureLoader.ThreadCount() << " threads"
+				    << std::endl;
+				TextureRegistry::Global().Report(std::cout);
+				// the meshes are where they stay, upload them.
+				// the blended ones stay with the queue.
+				if (IndirectRenderer::Supported()) {
+					for (uint32_t i = 0; i < 3; i++) {
+						sceneModels[i]->SubmitIndirect(
+						    indirectScene, i,
+						    litIndirectShaders,
+						    SHADER_FOG);
+						blendedMeshes[i].clear();
+						for (const Mesh &mesh :
+						     sceneModels[i]->meshes) {
+							blendedMeshes[i].push_back(
+							    mesh.material.opacity <
+							    1.0f);
+						}
+					}
+					indirectScene.Upload();
+				}
+				for (const ModelHandle &handle :
+				     {ourModel, stationModel, freighterModel,
+				      treeModel}) {
+					std::cout << handle->meshes.size()
+						  << " meshes in "
+						  << handle->DrawCalls()
+						  << " draw calls" << std::endl;
+				}
+			}
+		}
+
 		// input
 		// -----
 		processInput(window);
 
+		// until every program is linked only the clear color is shown
+		if (!shadersReady) {
+			shadersReady = shaderCompiler.Poll();
+			if (!shadersReady) {
+				glClearColor(programState->clearColor.r,
+					     programState->clearColor.g,
+					     programState->clearColor.b, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT);
+				glfwSwapBuffers(window);
+				glfwPollEvents();
+				continue;
+			}
+			skyboxShader.use();
+			skyboxShader.set(UNIFORM("skybox"), 0);
+			shaderCompiler.WarmUp();
+			std::cout << "Shaders ready after "
+				  << glfwGetTime() * 1000.0 << "ms"
+				  << std::endl;
+		}
+
 		// render
 		// ------
 		glClearColor(programState->clearColor.r,
@@ -348,40 +546,9 @@ auto main() -> int
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
 			GL_STENCIL_BUFFER_BIT);
 
-		// grassDrawing
-		planeShader.use();
 		pointLight.position = glm::vec3(300.0 * cos(progTime),
 						-abs(cos(progTime)) * 200.0f,
 						500.0 * sin(progTime));
-		planeShader.setVec3("pointLight.position", pointLight.position);
-		planeShader.setVec3("pointLight.ambient", pointLight.ambient);
-		planeShader.setVec3("pointLight.diffuse", pointLight.diffuse);
-		planeShader.setVec3("pointLight.specular", pointLight.specular);
-		planeShader.setFloat("pointLight.constant",
-				     pointLight.constant);
-		planeShader.setFloat("pointLight.linear", pointLight.linear);
-		planeShader.setFloat("pointLight.quadratic",
-				     pointLight.quadratic);
-		planeShader.setVec3("viewPosition",
-				    programState->camera.Position);
-		planeShader.setFloat("material.shininess", 32.0f);
-
-		// stationDrawing
-		stationShader.use();
-		stationShader.setVec3("pointLight.position",
-				      pointLight.position);
-		stationShader.setVec3("pointLight.ambient", pointLight.ambient);
-		stationShader.setVec3("pointLight.diffuse", pointLight.diffuse);
-		stationShader.setVec3("pointLight.specular",
-				      pointLight.specular);
-		stationShader.setFloat("pointLight.constant",
-				       pointLight.constant);
-		stationShader.setFloat("pointLight.linear", pointLight.linear);
-		stationShader.setFloat("pointLight.quadratic",
-				       pointLight.quadratic);
-		stationShader.setVec3("viewPosition",
-				      programState->camera.Position);
-		stationShader.setFloat("material.shininess", 12.0f);
 		// view/projection transformations
 		glm::mat4 projection =
 		    glm::perspective(glm::radians(programState->camera.Zoom),
@@ -390,12 +557,85 @@ auto main() -> int
 				     0.1f, 100000.0f);
 		glm::mat4 view = programState->camera.GetViewMatrix();
 
-		planeShader.use();
-		planeShader.setMat4("projection", projection);
-		planeShader.setMat4("view", view);
-		stationShader.use();
-		stationShader.setMat4("projection", projection);
-		stationShader.setMat4("view", view);
+		// frame and light data, one buffer write each for all programs
+		FrameUniforms frame;
+		frame.view = view;
+		frame.projection = projection;
+		frame.viewProjection = projection * view;
+		frame.viewPosition = programState->camera.Position;
+		frame.time = progTime;
+		frameUniforms.Update(frame);
+		LightUniforms lights = {};
+		lights.pointLights[0].position = pointLight.position;
+		lights.pointLights[0].ambient = pointLight.ambient;
+		lights.pointLights[0].diffuse = pointLight.diffuse;
+		lights.pointLights[0].specular = pointLight.specular;
+		lights.pointLights[0].constant = pointLight.constant;
+		lights.pointLights[0].linear = pointLight.linear;
+		lights.pointLights[0].quadratic = pointLight.quadratic;
+		lightUniforms.Update(lights);
+
+		// the opaque models take the indirect tier once it has them
+		bool indirectDraws = sceneResident &&
+				     IndirectRenderer::Supported() &&
+				     programState->IndirectDraws;
+		double submitStart = glfwGetTime();
+		// meshlets facing away are culled like the front faces, and
+		// those under a pixel of the framebuffer as it is now
+		int framebufferWidth, framebufferHeight;
+		glfwGetFramebufferSize(window, &framebufferWidth,
+				       &framebufferHeight);
+		renderQueue.SetMeshletCulling(framebufferHeight,
+					      MODEL_CULLED_FACE);
+
+		// per model uniforms, set by the render queue for each draw.
+		// the material constants come from the models.
+		renderQueue.Begin(view, projection);
+		auto addObject = [&](const glm::mat4 &modelMatrix,
+				     float opacity, const glm::vec3 &fogColor,
+				     uint32_t sceneObject) {
+			RenderObject object;
+			object.model = modelMatrix;
+			object.opacity = opacity;
+			object.fogColor = fogColor;
+			object.cullMeshlets = programState->MeshletCulling;
+			// the station's meshes in rooms out of sight go first
+			const std::vector<uint8_t> &inView =
+			    sceneObject == 1 && programState->PortalCulling
+				? stationCells.Filter(
+				      sceneBVH.Visibility(sceneObject))
+				: sceneBVH.Visibility(sceneObject);
+			switch (programState->OcclusionMode) {
+			case OCCLUSION_QUERIES:
+				object.visibility =
+				    occlusionCuller.Filter(sceneObject, inView);
+				break;
+			case OCCLUSION_SOFTWARE:
+				object.visibility = softwareOcclusion.Filter(
+				    sceneObject, inView,
+				    sceneBounds[sceneObject], modelMatrix);
+				break;
+			default:
+				object.visibility = inView.data();
+			}
+			return renderQueue.AddObject(object);
+		};
+		// on the indirect tier the queue draws what it leaves out, the
+		// blended meshes of the object queued before, in view as that
+		auto blendedOnly = [&](uint32_t queued, uint32_t sceneObject) {
+			RenderObject object = renderQueue.Object(queued);
+			const std::vector<uint8_t> &blended =
+			    blendedMeshes[sceneObject];
+			std::vector<uint8_t> &visible =
+			    blendedVisibility[sceneObject];
+			visible.assign(blended.size(), 0);
+			for (size_t i = 0; i < blended.size(); i++) {
+				visible[i] = blended[i] && object.visibility[i];
+			}
+			object.visibility = visible.data();
+			return renderQueue.AddObject(object);
+		};
+		const glm::vec3 spaceFog(0.0085f, 0.0085f, 0.0090f);
 		// render the loaded model
 		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::translate(
@@ -410,11 +650,8 @@ auto main() -> int
 			    ->backpackScale));	// it's a bit too big for our
 						// scene, so scale it down
 
-		planeShader.use();
-		planeShader.setMat4("model", model);
-
-		glStencilFunc(GL_ALWAYS, 1, 0xFF);
-		glStencilMask(0xFF);
+		glState.StencilFunc(GL_ALWAYS, 1, 0xFF);
+		glState.StencilMask(0xFF);
 
 		float rotationAngle =
 		    glm::radians(sin(progTime) * (12) * cos(progTime));
@@ -436,71 +673,179 @@ auto main() -> int
 		freighterRot = glm::translate(
 		    freighterRot, glm::vec3(cos(progTime / 4) * 50.0, 10.0f,
 					    sin(progTime / 4) * 50.0));
-		// starting to use the outline shader
-		outlineShader.use();
-		outlineShader.setMat4("projection", projection);
-		outlineShader.setMat4("view", view);
-		outlineShader.setMat4("model", freighterRot);
-		outlineShader.setFloat("outlining", 1.0);
-		freighterModel.Draw(outlineShader);
-
-		planeShader.use();
-		ourModel.Draw(planeShader);
-
-		planeShader.setMat4("model", freighterRot);
-		freighterModel.Draw(planeShader);
-
-		// enabling blending
-		glEnable(GL_BLEND);
-		treeShader.use();
-		treeShader.setVec3("pointLight.position", pointLight.position);
-		treeShader.setVec3("pointLight.ambient", pointLight.ambient);
-		treeShader.setVec3("pointLight.diffuse", pointLight.diffuse);
-		treeShader.setVec3("pointLight.specular", pointLight.specular);
-		treeShader.setFloat("pointLight.constant", pointLight.constant);
-		treeShader.setFloat("pointLight.linear", pointLight.linear);
-		treeShader.setFloat("pointLight.quadratic",
-				    pointLight.quadratic);
-		treeShader.setVec3("viewPosition",
-				   programState->camera.Position);
-		treeShader.setFloat("material.shininess", 32.0f);
-
-		treeShader.setMat4("projection", projection);
-		treeShader.setMat4("view", view);
 		glm::mat4 treeRot = glm::mat4(1.0f);
 		treeRot = glm::scale(
 		    treeRot, glm::vec3(programState->backpackScale / 100));
 		// treeRot = glm::rotate(treeRot, rotationAngle, rotationAxis);
 		treeRot =
 		    glm::translate(treeRot, glm::vec3(20.0f, 0.0f, 80.2f));
-		treeShader.setMat4("model", treeRot);
-
-		treeModel.Draw(treeShader);
-		glDisable(GL_BLEND);
-		// disabling blending
-
-		// rotation and translation for freigther
-		// START OF STENCIL SHADER
-		glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
-		glStencilMask(0x00);
-		glDisable(GL_DEPTH_TEST);
-
-		glStencilMask(0xff);
-		glStencilFunc(GL_ALWAYS, 0, 0xff);
-		glEnable(GL_DEPTH_TEST);
-		// END OF STENCIL SHADER
-
-		stationShader.use();
-		stationShader.setMat4("projection", projection);
-		stationShader.setMat4("view", view);
-		stationShader.setMat4(
-		    "model",
-		    glm::scale(model, glm::vec3(programState->backpackScale /
-						1000000)));
-		stationModel.Draw(stationShader);
+		glm::mat4 stationRot = glm::scale(
+		    model, glm::vec3(programState->backpackScale / 1000000));
+
+		// only the freighter moves, the hierarchy is refit around it.
+		// meshes that streamed in since the last frame rebuild it.
+		const glm::mat4 sceneTransforms[] = {model, stationRot,
+						     freighterRot, treeRot};
+		for (uint32_t i = 0; i < 4; i++) {
+			const Model &sceneModel = *sceneModels[i];
+			if (sceneBVH.MeshCount(i) != sceneModel.meshes.size()) {
+				std::vector<AABB> bounds;
+				for (const Mesh &mesh : sceneModel.meshes) {
+					bounds.push_back(mesh.bounds);
+				}
+				sceneBVH.SetBounds(i, bounds);
+				sceneBounds[i] = bounds;
+				if (sceneModels[i] == stationModel.get()) {
+					stationCells.AssignMeshes(bounds);
+				}
+				if (sceneModels[i] == freighterModel.get()) {
+					convoyCuller.SetInstances(
+					    convoyInstances(bounds));
+				}
+			}
+			sceneBVH.SetTransform(i, sceneTransforms[i]);
+		}
+		sceneBVH.Update();
+		sceneBVH.Cull(Frustum::FromMatrix(projection * view));
+		// the rooms seen from the camera's, through the doorways
+		stationCells.ResetStats();
+		stationCells.Update(
+		    projection * view, stationRot,
+		    glm::vec3(glm::inverse(stationRot) *
+			      glm::vec4(programState->camera.Position, 1.0f)));
+		// last frame's occlusion queries, if they are done
+		occlusionCuller.ResetStats();
+		if (programState->OcclusionMode == OCCLUSION_QUERIES) {
+			occlusionCuller.CollectResults();
+		}
+		// or this frame's occluders in view, tested before submission
+		softwareOcclusion.Begin(projection * view);
+		if (programState->OcclusionMode == OCCLUSION_SOFTWARE) {
+			for (uint32_t i = 0; i < 4; i++) {
+				const std::vector<uint8_t> &inFrustum =
+				    sceneBVH.Visibility(i);
+				for (const OccluderGeometry &occluder :
+				     sceneModels[i]->Occluders()) {
+					if (inFrustum[occluder.mesh]) {
+						softwareOcclusion.AddOccluder(
+						    occluder,
+						    sceneTransforms[i]);
+					}
+				}
+			}
+			softwareOcclusion.Rasterize();
+		}
+		// the convoy, on the GPU while the queue is filled below
+		convoyCuller.Cull(depthPyramid);
+		if (indirectDraws) {
+			for (uint32_t i = 0; i < 3; i++) {
+				indirectScene.SetObject(i, sceneTransforms[i],
+							1.0f, spaceFog);
+			}
+			indirectScene.Cull(depthPyramid);
+		}
+		meshesNearLight = 0;
+		sceneBVH.QuerySphere(pointLight.position,
+				     pointLightRange(pointLight),
+				     [&](uint32_t, uint32_t) {
+					     meshesNearLight++;
+				     });
+
+		// the outline shader draws the freighter's silhouette first
+		outlineShader.use();
+		outlineShader.set(UNIFORM("outlining"), 1.0f);
+		uint32_t freighterObject =
+		    addObject(freighterRot, 1.0f, spaceFog, 2);
+		freighterModel->Submit(renderQueue, freighterObject,
+				       outlineShader, RenderPass::Outline);
+
+		uint32_t grassObject = addObject(model, 1.0f, spaceFog, 0);
+		if (indirectDraws) {
+			grassObject = blendedOnly(grassObject, 0);
+			freighterObject = blendedOnly(freighterObject, 2);
+		}
+		ourModel->Submit(renderQueue, grassObject, litShaders,
+				 SHADER_FOG);
+		freighterModel->Submit(renderQueue, freighterObject, litShaders,
+				       SHADER_FOG);
+
+		// the trees are translucent and blended after the rest
+		treeModel->Submit(renderQueue,
+				  addObject(treeRot, 0.5f, glm::vec3(0.0f), 3),
+				  litShaders, SHADER_ALPHA_TEST | SHADER_FOG);
+
+		uint32_t stationObject =
+		    addObject(stationRot, 1.0f, spaceFog, 1);
+		if (indirectDraws) {
+			stationObject = blendedOnly(stationObject, 1);
+		}
+		stationModel->Submit(renderQueue, stationObject, litShaders,
+				     SHADER_FOG);
+
+		renderQueue.Draw(RenderPass::Outline, false);
+		renderQueue.Draw(RenderPass::Scene, false);
+		if (indirectDraws) {
+			indirectScene.Draw();
+		}
+		submitMilliseconds = (glfwGetTime() - submitStart) * 1000.0;
+
+		// the freighters of the convoy that survived culling, then the
+		// opaque depth for next frame's culling
+		litShaders.ForEach([&](Shader &shader, unsigned int features) {
+			if (features & SHADER_INSTANCED) {
+				shader.use();
+				shader.set(UNIFORM("opacity"), 1.0f);
+				shader.set(UNIFORM("fogColor"), spaceFog);
+			}
+		});
+		GLsizei convoyVisible = convoyCuller.Resolve();
+		freighterModel->DrawInstanced(litShaders, SHADER_FOG,
+					      convoyCuller.VAO<GpuVertex>(),
+					      convoyVisible);
+		if (programState->InstanceOcclusion) {
+			depthPyramid.Build(framebufferWidth, framebufferHeight,
+					   projection * view);
+		} else {
+			depthPyramid.Invalidate();
+		}
+
+		// the boxes of everything in view against the opaque depth,
+		// read back next frame
+		if (programState->OcclusionMode == OCCLUSION_QUERIES) {
+			placeholderShader.use();
+			OcclusionCuller::BeginQueries();
+			for (uint32_t i = 0; i < 4; i++) {
+				placeholderShader.set(UNIFORM("model"),
+						      sceneTransforms[i]);
+				occlusionCuller.IssueQueries(
+				    i, sceneBounds[i], sceneBVH.Visibility(i),
+				    sceneTransforms[i],
+				    programState->camera.Position, 0.1f,
+				    placeholderShader,
+				    modelLoader.PlaceholderVAO());
+			}
+			OcclusionCuller::EndQueries();
+		}
+
+		// proxies for the meshes that are still streaming in
+		if (!sceneResident) {
+			placeholderShader.use();
+			placeholderShader.set(UNIFORM("model"), model);
+			modelLoader.DrawPlaceholders(*ourModel,
+						     placeholderShader);
+			placeholderShader.set(UNIFORM("model"), freighterRot);
+			modelLoader.DrawPlaceholders(*freighterModel,
+						     placeholderShader);
+			placeholderShader.set(UNIFORM("model"), treeRot);
+			modelLoader.DrawPlaceholders(*treeModel,
+						     placeholderShader);
+			placeholderShader.set(UNIFORM("model"), stationRot);
+			modelLoader.DrawPlaceholders(*stationModel,
+						     placeholderShader);
+		}
 
 		// SKYBOX
-		glDepthFunc(GL_LEQUAL);
+		glState.DepthFunc(GL_LEQUAL);
 		skyboxShader.use();
 		glm::mat4 skyboxView = glm::mat4(1.0f);
 		glm::mat4 skyProjection = glm::mat4(1.0f);
@@ -512,24 +857,25 @@ auto main() -> int
 		skyProjection = glm::perspective(
 		    glm::radians(45.0f),
 		    static_cast<float>(SCR_WIDTH) / SCR_HEIGHT, 0.1f, 1000.0f);
-		glUniformMatrix4fv(
-		    glGetUniformLocation(skyboxShader.ID, "skyView"), 1,
-		    GL_FALSE, glm::value_ptr(skyboxView));
-		glUniformMatrix4fv(
-		    glGetUniformLocation(skyboxShader.ID, "skyProjection"), 1,
-		    GL_FALSE, glm::value_ptr(skyProjection));
-
-		glBindVertexArray(skyboxVAO);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+		skyboxShader.set(UNIFORM("skyView"), skyboxView);
+		skyboxShader.set(UNIFORM("skyProjection"), skyProjection);
+
+		glState.BindVertexArray(skyboxVAO);
+		glState.BindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTexture);
 		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr);
-		glBindVertexArray(0);
 		// END OF SKYBOX
 
-		glDepthFunc(GL_LESS);
+		glState.DepthFunc(GL_LESS);
 
+		// translucent surfaces over everything opaque, sky included
+		renderQueue.Draw(RenderPass::Scene, true);
+
+		// the ImGui backend saves and restores every binding and
+		// capability it touches, so the tracker stays valid
 		if (programState->ImGuiEnabled) {
-			DrawImGui(programState);
+			DrawImGui(programState, renderQueue, occlusionCuller,
+				  softwareOcclusion, stationCells,
+				  convoyCuller, indirectScene);
 		}
 
 		// glfw: swap buffers and poll IO events (keys pressed/released,
@@ -537,8 +883,84 @@ auto main() -> int
 		// -------------------------------------------------------------------------------
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		if (firstFrame) {
+			firstFrame = false;
+			std::cout << "First frame after "
+				  << glfwGetTime() * 1000.0 << "ms"
+				  << std::endl;
+		}
+	}
+	glState.DeleteTexture(texture);
+	glState.DeleteTexture(cubemapTexture);
+	glState.DeleteVertexArray(skyboxVAO);
+	glState.DeleteBuffer(skyboxVBO);
+	glState.DeleteBuffer(skyboxEBO);
+	// the models give their textures back to the registry, which needs
+	// the context to delete them
+	ourModel.reset();
+	stationModel.reset();
+	freighterModel.reset();
+	treeModel.reset();
+}
+
+auto main() -> int
+{
+	// glfw: initialize and configure
+	// ------------------------------
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+	// glfw window creation
+	// --------------------
+	GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT,
+					      "LearnOpenGL", nullptr, nullptr);
+	if (window == nullptr) {
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return -1;
 	}
-	glDeleteTextures(1, &texture);
+	glfwMakeContextCurrent(window);
+	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	glfwSetCursorPosCallback(window, mouse_callback);
+	glfwSetScrollCallback(window, scroll_callback);
+	glfwSetKeyCallback(window, key_callback);
+	// tell GLFW to capture our mouse
+	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+	if (!gladLoadGLLoader(
+		reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+	// newer entry points (program binaries for the shader cache, the
+	// multi-draw-indirect tier)
+	LoadGLExtensions(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+	std::cout << "OpenGL " << glGetString(GL_VERSION) << ", "
+		  << (IndirectRenderer::Supported() ? "multi-draw-indirect"
+						     : "GL 3.3")
+		  << " tier" << std::endl;
+
+	programState = new ProgramState;
+	programState->LoadFromFile("resources/program_state.txt");
+	if (programState->ImGuiEnabled) {
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+	}
+	// Init Imgui
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGuiIO &io = ImGui::GetIO();
+	(void)io;
+
+	ImGui_ImplGlfw_InitForOpenGL(window, true);
+	ImGui_ImplOpenGL3_Init("#version 330 core");
+
+	renderScene(window);
 
 	programState->SaveToFile("resources/program_state.txt");
 	delete programState;
@@ -614,7 +1036,12 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
 	programState->camera.ProcessMouseScroll(yoffset);
 }
 
-void DrawImGui(ProgramState *programState)
+void DrawImGui(ProgramState *programState, const RenderQueue &renderQueue,
+	       const OcclusionCuller &occlusionCuller,
+	       const SoftwareOcclusion &softwareOcclusion,
+	       const PortalVisibility &stationCells,
+	       const InstanceCuller &convoyCuller,
+	       const IndirectRenderer &indirectScene)
 {
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
@@ -643,6 +1070,74 @@ void DrawImGui(ProgramState *programState)
 		ImGui::DragFloat("pointLight.quadratic",
 				 &programState->pointLight.quadratic, 0.05, 0.0,
 				 1.0);
+		const UniformStats &uniformStats = UniformStats::Global();
+		ImGui::Text("Uniform uploads: %lu issued, %lu skipped",
+			    uniformStats.issued, uniformStats.skipped);
+		const SceneBVH::Stats &bvhStats = sceneBVH.GetStats();
+		ImGui::Text("BVH: %zu nodes, %lu tested, %zu meshes near "
+			    "the light",
+			    sceneBVH.NodeCount(), bvhStats.nodesTested,
+			    meshesNearLight);
+		ImGui::Checkbox("Portal culling", &programState->PortalCulling);
+		const PortalVisibility::Stats &portals =
+		    stationCells.GetStats();
+		ImGui::Text("Portals: camera in %s, %lu of %zu cells, "
+			    "%lu meshes skipped",
+			    stationCells.CameraCell().c_str(),
+			    portals.cellsVisible, stationCells.CellCount(),
+			    portals.skipped);
+		ImGui::Text("Occlusion culling:");
+		ImGui::RadioButton("Off", &programState->OcclusionMode,
+				   OCCLUSION_OFF);
+		ImGui::SameLine();
+		ImGui::RadioButton("GPU queries", &programState->OcclusionMode,
+				   OCCLUSION_QUERIES);
+		ImGui::SameLine();
+		ImGui::RadioButton("CPU raster", &programState->OcclusionMode,
+				   OCCLUSION_SOFTWARE);
+		const OcclusionCuller::Stats &occlusion =
+		    occlusionCuller.GetStats();
+		ImGui::Text("Occlusion: %lu queries, %lu meshes skipped",
+			    occlusion.queries, occlusion.skipped);
+		const SoftwareOcclusion::Stats &raster =
+		    softwareOcclusion.GetStats();
+		ImGui::Text("CPU raster: %lu triangles, %lu tested, "
+			    "%lu skipped",
+			    raster.triangles, raster.tested, raster.skipped);
+		const CullingStats &culling = CullingStats::Global();
+		ImGui::Text("Meshes: %lu visible, %lu culled", culling.visible,
+			    culling.tested - culling.visible);
+		ImGui::Checkbox("Meshlet culling",
+				&programState->MeshletCulling);
+		const MeshletStats &meshlets = MeshletStats::Global();
+		ImGui::Text("Meshlets: %lu of %lu culled, %lu of %lu "
+			    "triangles drawn",
+			    meshlets.culled, meshlets.tested,
+			    meshlets.triangles, meshlets.trianglesBefore);
+		ImGui::Checkbox("Instance occlusion (Hi-Z)",
+				&programState->InstanceOcclusion);
+		const InstanceCuller::Stats &convoy = convoyCuller.GetStats();
+		ImGui::Text("Convoy: %lu of %lu instances drawn%s",
+			    convoy.drawn, convoy.instances,
+			    convoy.late ? ", a frame late" : "");
+		if (IndirectRenderer::Supported()) {
+			ImGui::Checkbox("Multi-draw-indirect tier",
+					&programState->IndirectDraws);
+			const IndirectRenderer::Stats &indirect =
+			    indirectScene.GetStats();
+			ImGui::Text("Indirect: %lu meshes in %lu multi-draws",
+				    indirect.meshes, indirect.multiDraws);
+		}
+		ImGui::Text("Opaque submission: %.3f ms CPU",
+			    submitMilliseconds);
+		const RenderQueue::Stats &queueStats = renderQueue.GetStats();
+		ImGui::Text("Render queue: %lu draws, %lu programs, "
+			    "%lu materials",
+			    queueStats.items, queueStats.programs,
+			    queueStats.materials);
+		const GLState::Stats &glStats = GLState::Get().GetStats();
+		ImGui::Text("GL state calls: %lu issued, %lu skipped",
+			    glStats.issued, glStats.skipped);
 		ImGui::End();
 	}
 
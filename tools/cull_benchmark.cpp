@@ -0,0 +1,98 @@
+// cull_benchmark: times the frustum test of BoundingVolumes
+// (include/learnopengl/frustum.h) on random boxes, the SIMD path the renderer
+// uses against the scalar reference, and checks that both agree.
+//
+// usage: cull_benchmark [-n runs] [boxes]
+// the default is 100000 boxes scattered around a camera looking down -z, the
+// median of the runs is reported. the SIMD path is SSE, or AVX when built
+// with -DHANGAR_AVX=ON.
+
+#include <learnopengl/frustum.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static double medianMilliseconds(int runs, const std::function<void()> &cull)
+{
+	cull();
+	std::vector<double> times;
+	for (int i = 0; i < runs; i++) {
+		auto start = std::chrono::steady_clock::now();
+		cull();
+		std::chrono::duration<double, std::milli> elapsed =
+		    std::chrono::steady_clock::now() - start;
+		times.push_back(elapsed.count());
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+int main(int argc, char **argv)
+{
+	int runs = 100;
+	size_t boxes = 100000;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc) {
+			runs = std::max(1, atoi(argv[++i]));
+		} else {
+			boxes = std::max(1, atoi(argv[i]));
+		}
+	}
+
+	std::mt19937 random(5601);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.5f, 20.0f);
+	BoundingVolumes volumes;
+	for (size_t i = 0; i < boxes; i++) {
+		glm::vec3 center(position(random), position(random),
+				 position(random));
+		glm::vec3 extent(size(random), size(random), size(random));
+		volumes.Add(center - extent, center + extent,
+			    glm::length(extent));
+	}
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+						16.0f / 9.0f, 0.1f, 400.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+				     glm::vec3(0.0f, 1.0f, 0.0f));
+	Frustum frustum = Frustum::FromMatrix(projection * view);
+
+	std::vector<uint8_t> simd(volumes.PaddedSize());
+	std::vector<uint8_t> scalar(volumes.PaddedSize());
+	size_t visible = 0;
+	double simdTime = medianMilliseconds(
+	    runs, [&] { visible = volumes.Cull(frustum, simd.data()); });
+	double scalarTime = medianMilliseconds(
+	    runs, [&] { volumes.CullScalar(frustum, scalar.data()); });
+
+	size_t mismatches = 0;
+	for (size_t i = 0; i < boxes; i++) {
+		mismatches += simd[i] != scalar[i];
+	}
+#if defined(__AVX__)
+	const char *path = "AVX";
+#elif defined(HANGAR_CULL_SSE)
+	const char *path = "SSE";
+#else
+	const char *path = "scalar";
+#endif
+	std::cout << boxes << " boxes, " << visible << " visible" << std::endl;
+	std::cout << "scalar: " << scalarTime << " ms" << std::endl;
+	std::cout << path << ": " << simdTime << " ms, "
+		  << scalarTime / simdTime << "x" << std::endl;
+	if (mismatches) {
+		std::cout << "ERROR::CULL:: " << mismatches
+			  << " boxes differ from the scalar test" << std::endl;
+		return 1;
+	}
+	return 0;
+}
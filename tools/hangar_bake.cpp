@@ -0,0 +1,300 @@
+// hangar_bake: imports the scene models once and writes their meshes,
+// material texture references and pre-mipped textures into a single archive
+// that the runtime memory maps (see include/learnopengl/scene_archive.h).
+//
+// usage: hangar_bake [-o archive] [model ...]
+// without models the ones loaded by src/main.cpp are baked into
+// resources/hangar5601.pak. run it from the project root, model paths are
+// stored exactly as given.
+
+#include <learnopengl/image.h>
+#include <learnopengl/model.h>
+#include <learnopengl/scene_archive.h>
+#include <learnopengl/texture_compression.h>
+#include <learnopengl/texture_registry.h>
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+class ArchiveWriter
+{
+public:
+	bool Open(const std::string &path)
+	{
+		out.open(path, std::ios::binary | std::ios::trunc);
+		if (!out) {
+			return false;
+		}
+		// the header is rewritten once all tables are known
+		ArchiveHeader header = {};
+		write(&header, sizeof(header));
+		strings.push_back('\0');
+		return true;
+	}
+
+	bool AddModel(const std::string &path)
+	{
+		std::vector<MeshData> meshes;
+		if (!Model::Import(path, meshes, &importers)) {
+			return false;
+		}
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0) {
+			return false;
+		}
+		std::string directory = path.substr(0, path.find_last_of('/'));
+
+		ArchiveModel model = {};
+		model.path = addString(path);
+		model.firstMesh = archiveMeshes.size();
+		model.meshCount = meshes.size();
+		model.sourceSize = st.st_size;
+		model.sourceTime = st.st_mtime;
+
+		size_t vertexCount = 0;
+		for (const MeshData &data : meshes) {
+			ArchiveMesh mesh = {};
+			mesh.vertexCount = data.vertices.size();
+			mesh.indexCount = data.indices.size();
+			mesh.vertexOffset = writeBlob(data.vertices.data(),
+						      data.vertices.size() *
+							  sizeof(Vertex));
+			mesh.indexOffset = writeBlob(
+			    data.indices.data(),
+			    data.indices.size() * sizeof(unsigned int));
+			mesh.firstTextureRef = textureRefs.size();
+			mesh.textureRefCount = data.textures.size();
+			mesh.material = ToArchiveMaterial(data.material);
+			for (const Texture &texture : data.textures) {
+				ArchiveTextureRef ref;
+				TextureEncoding encoding =
+				    TextureEncodingFor(texture.type);
+				ref.texture = addTexture(
+				    directory + '/' + texture.path, encoding);
+				ref.type = static_cast<uint32_t>(texture.type);
+				textureRefs.push_back(ref);
+			}
+			archiveMeshes.push_back(mesh);
+			vertexCount += mesh.vertexCount;
+		}
+		models.push_back(model);
+		std::cout << "baked " << path << ": " << meshes.size()
+			  << " meshes, " << vertexCount << " vertices"
+			  << std::endl;
+		return true;
+	}
+
+	bool Finish()
+	{
+		ArchiveHeader header = {};
+		header.magic = ARCHIVE_MAGIC;
+		header.version = ARCHIVE_VERSION;
+		header.vertexStride = sizeof(Vertex);
+		header.indexSize = sizeof(unsigned int);
+		header.modelCount = models.size();
+		header.meshCount = archiveMeshes.size();
+		header.textureRefCount = textureRefs.size();
+		header.textureCount = textures.size();
+		header.levelCount = levels.size();
+		header.stringsSize = strings.size();
+		header.modelsOffset = writeTable(models);
+		header.meshesOffset = writeTable(archiveMeshes);
+		header.textureRefsOffset = writeTable(textureRefs);
+		header.texturesOffset = writeTable(textures);
+		header.levelsOffset = writeTable(levels);
+		header.stringsOffset =
+		    writeBlob(strings.data(), strings.size());
+		header.fileSize = position;
+
+		out.seekp(0);
+		out.write(reinterpret_cast<const char *>(&header),
+			  sizeof(header));
+		out.close();
+		return !out.fail();
+	}
+
+private:
+	std::ofstream out;
+	uint64_t position = 0;
+	std::vector<ArchiveModel> models;
+	std::vector<ArchiveMesh> archiveMeshes;
+	std::vector<ArchiveTextureRef> textureRefs;
+	std::vector<ArchiveTexture> textures;
+	std::vector<ArchiveLevel> levels;
+	std::string strings;
+	std::map<std::string, uint32_t> stringOffsets;
+	std::map<std::string, uint32_t> textureIndices;
+	std::map<std::string, uint32_t> contentIndices;
+	// the OBJ parser's workers
+	ThreadPool importers;
+
+	void write(const void *data, size_t size)
+	{
+		out.write(static_cast<const char *>(data), size);
+		position += size;
+	}
+
+	uint64_t writeBlob(const void *data, size_t size)
+	{
+		static const char padding[ARCHIVE_ALIGNMENT] = {};
+		write(padding,
+		      (ARCHIVE_ALIGNMENT - position % ARCHIVE_ALIGNMENT) %
+			  ARCHIVE_ALIGNMENT);
+		uint64_t offset = position;
+		write(data, size);
+		return offset;
+	}
+
+	template <typename T>
+	uint64_t writeTable(const std::vector<T> &table)
+	{
+		return writeBlob(table.data(), table.size() * sizeof(T));
+	}
+
+	uint32_t addString(const std::string &s)
+	{
+		auto it = stringOffsets.find(s);
+		if (it != stringOffsets.end()) {
+			return it->second;
+		}
+		uint32_t offset = strings.size();
+		strings.append(s);
+		strings.push_back('\0');
+		stringOffsets[s] = offset;
+		return offset;
+	}
+
+	// decodes the image once per encoding, no matter how many meshes or
+	// models use it or how many identical copies of the file exist, and
+	// stores its complete mip chain. block-compressed textures go through
+	// the same KTX cache the runtime uses.
+	uint32_t addTexture(const std::string &path, TextureEncoding encoding)
+	{
+		std::string key =
+		    path + '#' + std::to_string((int)encoding);
+		auto it = textureIndices.find(key);
+		if (it != textureIndices.end()) {
+			return it->second;
+		}
+		uint64_t hash;
+		std::string contentKey;
+		if (HashFileContents(path, hash)) {
+			contentKey = std::to_string(hash) + '#' +
+				     std::to_string((int)encoding);
+			auto same = contentIndices.find(contentKey);
+			if (same != contentIndices.end()) {
+				std::cout << path << " is identical to "
+					  << strings.c_str() +
+						 textures[same->second].path
+					  << std::endl;
+				textureIndices[key] = same->second;
+				return same->second;
+			}
+		}
+
+		ArchiveTexture texture = {};
+		texture.path = addString(path);
+		texture.firstLevel = levels.size();
+
+		Image image;
+		CompressedTexture compressed;
+		// same orientation the runtime loads model textures with
+		if (encoding != TextureEncoding::Raw &&
+		    LoadCompressedTexture(path, encoding, true, compressed)) {
+			texture.width = compressed.levels[0].width;
+			texture.height = compressed.levels[0].height;
+			texture.internalFormat = compressed.internalFormat;
+			texture.format = 0;
+			for (const CompressedLevel &mip : compressed.levels) {
+				ArchiveLevel level;
+				level.width = mip.width;
+				level.height = mip.height;
+				level.size = mip.data.size();
+				level.offset =
+				    writeBlob(mip.data.data(), mip.data.size());
+				levels.push_back(level);
+			}
+			texture.levelCount = levels.size() - texture.firstLevel;
+		} else if (encoding == TextureEncoding::Raw &&
+			   LoadImageFile(path, image, true)) {
+			GLenum format = GL_RGBA;
+			if (image.channels == 1) {
+				format = GL_RED;
+			} else if (image.channels == 2) {
+				format = GL_RG;
+			} else if (image.channels == 3) {
+				format = GL_RGB;
+			}
+			texture.width = image.width;
+			texture.height = image.height;
+			texture.internalFormat = format;
+			texture.format = format;
+			for (const Image &mip : BuildMipChain(image)) {
+				ArchiveLevel level;
+				level.width = mip.width;
+				level.height = mip.height;
+				level.size = mip.pixels.size();
+				level.offset = writeBlob(mip.pixels.data(),
+							 mip.pixels.size());
+				levels.push_back(level);
+			}
+			texture.levelCount = levels.size() - texture.firstLevel;
+		} else {
+			// stored without levels so the runtime ends up with the
+			// same empty texture a failed TextureFromFile gives
+			std::cout << "Texture failed to load at path: " << path
+				  << std::endl;
+		}
+
+		uint32_t index = textures.size();
+		textures.push_back(texture);
+		textureIndices[key] = index;
+		if (!contentKey.empty()) {
+			contentIndices[contentKey] = index;
+		}
+		return index;
+	}
+};
+
+auto main(int argc, char **argv) -> int
+{
+	std::string output = "resources/hangar5601.pak";
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-o" && i + 1 < argc) {
+			output = argv[++i];
+		} else {
+			paths.push_back(arg);
+		}
+	}
+	if (paths.empty()) {
+		paths = {
+		    "resources/objects/grass/grass.obj",
+		    "resources/objects/space_station/Space Station Scene.obj",
+		    "resources/objects/freighter/freighter.obj",
+		    "resources/objects/trees/trees9.obj",
+		};
+	}
+
+	ArchiveWriter writer;
+	if (!writer.Open(output)) {
+		std::cout << "Failed to create archive: " << output
+			  << std::endl;
+		return 1;
+	}
+	for (const std::string &path : paths) {
+		if (!writer.AddModel(path)) {
+			std::cout << "Skipping model: " << path << std::endl;
+		}
+	}
+	if (!writer.Finish()) {
+		std::cout << "Failed to write archive: " << output << std::endl;
+		return 1;
+	}
+	std::cout << "wrote " << output << std::endl;
+	return 0;
+}
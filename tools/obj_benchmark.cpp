@@ -0,0 +1,122 @@
+// obj_benchmark: times the native OBJ parser (include/learnopengl/obj_loader.h)
+// against Assimp::Importer::ReadFile with the post-processing Model::Import
+// asks for, on the same file.
+//
+// usage: obj_benchmark [-n runs] [file.obj]
+// the default is the space station scene. every variant is run once to warm
+// the page cache, then the median of the runs is reported.
+
+#include <learnopengl/obj_loader.h>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Counts {
+	size_t meshes = 0;
+	size_t vertices = 0;
+	size_t triangles = 0;
+};
+
+static double medianMilliseconds(int runs, const std::function<void()> &load)
+{
+	load();
+	std::vector<double> times;
+	for (int i = 0; i < runs; i++) {
+		auto start = std::chrono::steady_clock::now();
+		load();
+		std::chrono::duration<double, std::milli> elapsed =
+		    std::chrono::steady_clock::now() - start;
+		times.push_back(elapsed.count());
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+static void report(const std::string &name, double milliseconds,
+		   const Counts &counts, double baseline)
+{
+	std::cout << name << ": " << milliseconds << " ms (" << counts.meshes
+		  << " meshes, " << counts.vertices << " vertices, "
+		  << counts.triangles << " triangles)";
+	if (baseline > 0.0) {
+		std::cout << ", " << baseline / milliseconds << "x";
+	}
+	std::cout << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	int runs = 10;
+	std::string path = "resources/objects/space_station/"
+			   "Space Station Scene.obj";
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc) {
+			runs = std::max(1, atoi(argv[++i]));
+		} else {
+			path = arg;
+		}
+	}
+
+	Counts assimpCounts;
+	double assimpTime = medianMilliseconds(runs, [&] {
+		Assimp::Importer importer;
+		const aiScene *scene = importer.ReadFile(
+		    path, aiProcess_Triangulate | aiProcess_GenSmoothNormals |
+			      aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		assimpCounts = Counts();
+		if (!scene) {
+			return;
+		}
+		assimpCounts.meshes = scene->mNumMeshes;
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+			assimpCounts.vertices += scene->mMeshes[i]->mNumVertices;
+			assimpCounts.triangles += scene->mMeshes[i]->mNumFaces;
+		}
+	});
+	if (assimpCounts.meshes == 0) {
+		std::cout << "ERROR::ASSIMP:: cannot import " << path
+			  << std::endl;
+		return 1;
+	}
+	report("Assimp::Importer::ReadFile", assimpTime, assimpCounts, 0.0);
+
+	unsigned int hardwareThreads =
+	    std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> threadCounts = {1};
+	if (hardwareThreads > 1) {
+		threadCounts.push_back(hardwareThreads);
+	}
+	for (unsigned int threads : threadCounts) {
+		// the calling thread parses too
+		std::unique_ptr<ThreadPool> pool;
+		if (threads > 1) {
+			pool.reset(new ThreadPool(threads - 1));
+		}
+		Counts counts;
+		double time = medianMilliseconds(runs, [&] {
+			std::vector<MeshData> meshes;
+			LoadOBJ(path, meshes, pool.get());
+			counts = Counts();
+			counts.meshes = meshes.size();
+			for (const MeshData &mesh : meshes) {
+				counts.vertices += mesh.vertices.size();
+				counts.triangles += mesh.indices.size() / 3;
+			}
+		});
+		report("LoadOBJ, " + std::to_string(threads) + " threads", time,
+		       counts, assimpTime);
+	}
+	return 0;
+}
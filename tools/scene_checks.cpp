@@ -0,0 +1,106 @@
+// scene_checks: checks of the CPU side of the renderer that need no GL
+// context, run by ctest from the repository root. every failed check is
+// printed, and the exit status is the number of them.
+//
+// usage: scene_checks
+
+#include <learnopengl/portals.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/shader.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+
+static int failures = 0;
+
+static void check(bool passed, const char *what)
+{
+	if (!passed) {
+		std::cout << "FAILED: " << what << std::endl;
+		failures++;
+	}
+}
+
+// an item of each pass reaches the draw loop of its pass, and only that one
+static void checkRenderQueue()
+{
+	Shader shader;
+	RenderQueue queue;
+	queue.Begin(glm::mat4(1.0f), glm::mat4(1.0f));
+	RenderItem item;
+	item.shader = &shader;
+	item.object = queue.AddObject(RenderObject());
+	const glm::vec3 center(0.0f, 0.0f, -10.0f);
+	queue.AddDraw(3, nullptr, 0);
+	queue.Submit(RenderPass::Scene, false, 0, center, item);
+	queue.AddDraw(3, nullptr, 0);
+	queue.AddDraw(6, nullptr, 0);
+	queue.Submit(RenderPass::Scene, true, 1, center, item);
+	queue.AddDraw(3, nullptr, 0);
+	queue.Submit(RenderPass::Outline, false, 0, center, item);
+
+	auto count = [&](RenderPass pass, bool translucent) {
+		int items = 0;
+		queue.ForEachItem(pass, translucent,
+				  [&](const RenderItem &) { items++; });
+		return items;
+	};
+	check(count(RenderPass::Scene, false) == 1,
+	      "an opaque Scene item reaches Draw(Scene, false)");
+	check(count(RenderPass::Scene, true) == 1,
+	      "a translucent Scene item reaches Draw(Scene, true)");
+	check(count(RenderPass::Outline, false) == 1,
+	      "an Outline item reaches Draw(Outline, false)");
+	check(count(RenderPass::Outline, true) == 0,
+	      "Draw(Outline, true) has no items");
+	int draws = 0;
+	queue.ForEachItem(RenderPass::Scene, true, [&](const RenderItem &drawn) {
+		draws = drawn.drawCount;
+	});
+	check(draws == 2, "the translucent item keeps both of its draws");
+}
+
+// the station's cells seen from outside, beside the north corridor with the
+// window ring of the hall off-screen: the corridor's shell is seen from space,
+// what is inside the corridor is not
+static void checkPortals()
+{
+	PortalVisibility cells;
+	check(!cells.Load("resources/objects/space_station/missing.txt") &&
+		  cells.CellCount() == 1,
+	      "a cells file that fails to load leaves only the outside");
+	if (!cells.Load("resources/objects/space_station/cells.txt")) {
+		check(false, "the station's cells load");
+		return;
+	}
+	std::vector<AABB> meshes(2);
+	meshes[0].min = glm::vec3(-19.0f, -1.0f, 78.5f);
+	meshes[0].max = glm::vec3(19.0f, 16.0f, 207.5f);
+	meshes[1].min = glm::vec3(-5.0f, 0.0f, 145.0f);
+	meshes[1].max = glm::vec3(5.0f, 5.0f, 155.0f);
+	cells.AssignMeshes(meshes);
+
+	const glm::vec3 camera(100.0f, 7.0f, 150.0f);
+	glm::mat4 view = glm::lookAt(camera, glm::vec3(0.0f, 7.0f, 150.0f),
+				     glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection =
+	    glm::perspective(glm::radians(30.0f), 1.0f, 0.1f, 1000.0f);
+	cells.Update(projection * view, glm::mat4(1.0f), camera);
+	const std::vector<uint8_t> &visible =
+	    cells.Filter(std::vector<uint8_t>(meshes.size(), 1));
+	check(cells.CameraCell() == "outside", "the camera is outside");
+	check(visible[0] == 1, "the corridor's shell is seen from outside");
+	check(visible[1] == 0, "a mesh inside the corridor is hidden");
+}
+
+int main()
+{
+	checkRenderQueue();
+	checkPortals();
+	if (failures == 0) {
+		std::cout << "all checks passed" << std::endl;
+	}
+	return failures;
+}
@@ -0,0 +1,246 @@
+// submit_benchmark: times the CPU side of drawing the scene with the two
+// rendering tiers, the GL 3.3 render queue (frustum culling per mesh,
+// glMultiDrawElementsBaseVertex per material and object) against the GL 4.3
+// multi-draw-indirect tier (include/learnopengl/indirect_renderer.h: object
+// transforms uploaded, culling dispatched, a glMultiDrawElementsIndirect per
+// group). both draw every mesh: the tier leaves the blended ones to the
+// queue, as hangar5601 does, and those are submitted without a frustum test.
+//
+// usage: submit_benchmark [-n frames] [copies]
+// the station is drawn copies x copies times (8 x 8 by default) on a grid
+// around the camera, into a hidden window. each frame is timed from the first
+// call to the last draw, the GPU is waited for outside of that; the median of
+// the frames is reported. run from the repository root, like hangar5601.
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <learnopengl/depth_pyramid.h>
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/indirect_renderer.h>
+#include <learnopengl/model.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/shader_compiler.h>
+#include <learnopengl/shader_permutations.h>
+#include <learnopengl/uniform_buffers.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const int WIDTH = 1280, HEIGHT = 720;
+
+static double medianMilliseconds(int runs, const std::function<void()> &submit)
+{
+	submit();
+	glFinish();
+	std::vector<double> times;
+	for (int i = 0; i < runs; i++) {
+		auto start = std::chrono::steady_clock::now();
+		submit();
+		std::chrono::duration<double, std::milli> elapsed =
+		    std::chrono::steady_clock::now() - start;
+		times.push_back(elapsed.count());
+		// the next frame must not wait for this one's commands
+		glFinish();
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+// draws the scene with each tier, on the current context
+static void benchmark(int runs, int copies)
+{
+	bool indirect = IndirectRenderer::Supported();
+
+	GLState &state = GLState::Get();
+	state.Enable(GL_DEPTH_TEST);
+	state.Enable(GL_CULL_FACE);
+	state.CullFace(MODEL_CULLED_FACE);
+	UniformBuffer<FrameUniforms> frameUniforms("FrameData");
+	UniformBuffer<LightUniforms> lightUniforms("LightData");
+	lightUniforms.Update(LightUniforms());
+
+	ShaderCompiler compiler;
+	ShaderPermutations litShaders("resources/shaders/lit.vs",
+				      "resources/shaders/lit.fs",
+				      VERTEX_FORMAT_DEFINES);
+	ShaderPermutations litIndirectShaders(
+	    "resources/shaders/lit_indirect.vs", "resources/shaders/lit.fs",
+	    std::string(VERTEX_FORMAT_DEFINES) + "#define INDIRECT\n");
+	IndirectRenderer indirectScene;
+	DepthPyramid depthPyramid;
+	litShaders.Require(SHADER_FOG);
+	litShaders.Require(SHADER_FOG | SHADER_NORMAL_MAP);
+	litShaders.Submit(compiler);
+	if (indirect) {
+		litIndirectShaders.Require(SHADER_FOG);
+		litIndirectShaders.Require(SHADER_FOG | SHADER_NORMAL_MAP);
+		litIndirectShaders.Submit(compiler);
+		indirectScene.Submit(compiler);
+	}
+	compiler.FinishAll();
+
+	Model station(
+	    "resources/objects/space_station/Space Station Scene.obj");
+	station.SetShaderTextureNamePrefix("material.");
+
+	// the copies a station's width apart, the camera in the middle of them
+	AABB bounds =
+	    station.meshes.empty() ? AABB() : station.meshes[0].bounds;
+	for (const Mesh &mesh : station.meshes) {
+		bounds = MergeBounds(bounds, mesh.bounds);
+	}
+	float spacing = std::max(bounds.max.x - bounds.min.x,
+				 bounds.max.z - bounds.min.z) * 1.25f;
+	std::vector<glm::mat4> transforms;
+	for (int x = 0; x < copies; x++) {
+		for (int z = 0; z < copies; z++) {
+			float center = 0.5f * (copies - 1);
+			glm::vec3 offset((x - center) * spacing, 0.0f,
+					 (z - center) * spacing);
+			transforms.push_back(
+			    glm::translate(glm::mat4(1.0f), offset));
+		}
+	}
+	const glm::vec3 fog(0.0085f, 0.0085f, 0.0090f);
+	std::vector<uint8_t> blended;
+	for (const Mesh &mesh : station.meshes) {
+		blended.push_back(mesh.material.opacity < 1.0f);
+	}
+	if (indirect) {
+		for (size_t i = 0; i < transforms.size(); i++) {
+			uint32_t object = indirectScene.AddObject();
+			station.SubmitIndirect(indirectScene, object,
+					       litIndirectShaders,
+					       SHADER_FOG);
+		}
+		indirectScene.Upload();
+	}
+
+	glm::mat4 projection = glm::perspective(
+	    glm::radians(45.0f), static_cast<float>(WIDTH) / HEIGHT, 0.1f,
+	    100000.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 50.0f, 0.0f),
+				     glm::vec3(0.0f, 50.0f, -1.0f),
+				     glm::vec3(0.0f, 1.0f, 0.0f));
+	FrameUniforms frame = {};
+	frame.view = view;
+	frame.projection = projection;
+	frame.viewProjection = projection * view;
+	frame.viewPosition = glm::vec3(0.0f, 50.0f, 0.0f);
+	frameUniforms.Update(frame);
+
+	RenderQueue renderQueue;
+	double queueTime = medianMilliseconds(runs, [&] {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		renderQueue.Begin(view, projection);
+		for (const glm::mat4 &transform : transforms) {
+			RenderObject object;
+			object.model = transform;
+			object.fogColor = fog;
+			station.Submit(renderQueue,
+				       renderQueue.AddObject(object),
+				       litShaders, SHADER_FOG);
+		}
+		renderQueue.Draw(RenderPass::Scene, false);
+		renderQueue.Draw(RenderPass::Scene, true);
+	});
+	RenderQueue::Stats queueStats = renderQueue.GetStats();
+	std::cout << transforms.size() << " stations of "
+		  << station.meshes.size() << " meshes" << std::endl;
+	std::cout << "GL 3.3 render queue:  " << queueTime << " ms, "
+		  << queueStats.items << " draw calls of " << queueStats.draws
+		  << " meshes" << std::endl;
+
+	if (!indirect) {
+		std::cout << "no multi-draw-indirect tier, the driver lacks "
+			     "GL 4.3"
+			  << std::endl;
+	} else {
+		double indirectTime = medianMilliseconds(runs, [&] {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			for (size_t i = 0; i < transforms.size(); i++) {
+				indirectScene.SetObject(
+				    static_cast<uint32_t>(i), transforms[i],
+				    1.0f, fog);
+			}
+			indirectScene.Cull(depthPyramid);
+			indirectScene.Draw();
+			renderQueue.Begin(view, projection);
+			for (const glm::mat4 &transform : transforms) {
+				RenderObject object;
+				object.model = transform;
+				object.fogColor = fog;
+				object.visibility = blended.data();
+				station.Submit(renderQueue,
+					       renderQueue.AddObject(object),
+					       litShaders, SHADER_FOG);
+			}
+			renderQueue.Draw(RenderPass::Scene, true);
+		});
+		const IndirectRenderer::Stats &indirectStats =
+		    indirectScene.GetStats();
+		queueStats = renderQueue.GetStats();
+		std::cout << "GL 4.3 multi-draw:    " << indirectTime
+			  << " ms, " << indirectStats.multiDraws
+			  << " multi-draws of " << indirectStats.meshes
+			  << " meshes (culled on the GPU) and "
+			  << queueStats.items << " blended draw calls of "
+			  << queueStats.draws << " meshes"
+			  << (GLExt().MultiDrawElementsIndirectCount
+				  ? " (draw counts from the GPU)"
+				  : "")
+			  << std::endl;
+		std::cout << "speedup:              "
+			  << queueTime / indirectTime << "x" << std::endl;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int runs = 200;
+	int copies = 8;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc) {
+			runs = std::max(1, atoi(argv[++i]));
+		} else {
+			copies = std::max(1, atoi(argv[i]));
+		}
+	}
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "submit_benchmark",
+					      nullptr, nullptr);
+	if (window == nullptr) {
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0);
+	if (!gladLoadGLLoader(
+		reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return 1;
+	}
+	LoadGLExtensions(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+	std::cout << "OpenGL " << glGetString(GL_VERSION) << std::endl;
+	benchmark(runs, copies);
+	glfwTerminate();
+	return 0;
+}